@@ -0,0 +1,333 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+#include <util/base.h>
+
+#include "obs-stub.h"
+#include "obs-midi.h"
+#include "device-manager.h"
+#include "mapping-cache.h"
+
+/*
+ * mapping-cache-test
+ * The mapping cache against the JSON it is written with: a config saved through
+ * GetData(Builder), written and mapped again must give the same devices and hooks as its
+ * JSON, and a cache that is damaged, of another format or not made from that JSON must be
+ * refused, since the getters trust a file once it is open.
+ * Prints one line per check to stderr, exits with 1 if any failed.
+ */
+namespace {
+int failures = 0;
+
+void check(bool passed, const QString &what)
+{
+	if (!passed)
+		failures++;
+	fprintf(stderr, "%s %s\n", passed ? "PASS" : "FAIL", what.toUtf8().constData());
+}
+
+void log_handler(int level, const char *format, va_list args, void *)
+{
+	if (level > LOG_WARNING)
+		return;
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+obs_data_t *make_hook(int channel, const char *type, int norc, const char *action)
+{
+	obs_data_t *hook = obs_data_create();
+	obs_data_set_int(hook, "channel", channel);
+	obs_data_set_string(hook, "message_type", type);
+	obs_data_set_int(hook, "norc", norc);
+	obs_data_set_string(hook, "action", action);
+	return hook;
+}
+void add_device(obs_data_array_t *devices, const char *name, const std::function<void(obs_data_t *)> &settings,
+		const std::vector<obs_data_t *> &hooks)
+{
+	obs_data_t *device = obs_data_create();
+	obs_data_set_string(device, "name", name);
+	settings(device);
+	obs_data_array_t *hook_array = obs_data_array_create();
+	for (auto hook : hooks) {
+		obs_data_array_push_back(hook_array, hook);
+		obs_data_release(hook);
+	}
+	obs_data_set_array(device, "hooks", hook_array);
+	obs_data_array_release(hook_array);
+	obs_data_array_push_back(devices, device);
+	obs_data_release(device);
+}
+
+/*
+ * Every field a device or hook stores, set and unset, non ASCII and unknown action strings
+ */
+OBSData make_config()
+{
+	obs_data_array_t *devices = obs_data_array_create();
+
+	obs_data_t *volume = make_hook(1, "Control Change", 7, "Set_Volume");
+	obs_data_set_string(volume, "audio_source", "Mic/Aux");
+	obs_data_set_int(volume, "range_min", 10);
+	obs_data_set_int(volume, "range_max", 90);
+	obs_data_set_bool(volume, "coalesce", true);
+	obs_data_t *filter = make_hook(2, "Note On", 36, "Toggle_Source_Filter");
+	obs_data_set_string(filter, "source", "Caméra ✓");
+	obs_data_set_string(filter, "filter", "Couleur");
+	obs_data_set_string(filter, "scene", "Scène 1");
+	obs_data_t *value_filter = make_hook(16, "Control Change", 127, "Switch_Scene");
+	obs_data_set_string(value_filter, "scene", "Scène 1");
+	obs_data_set_bool(value_filter, "value_as_filter", true);
+	obs_data_set_int(value_filter, "value", 64);
+	obs_data_t *offset = make_hook(3, "Pitch Bend", 0, "Set_Sync_Offset");
+	obs_data_set_string(offset, "source", "Mic/Aux");
+	obs_data_set_int(offset, "range_min", -950);
+	obs_data_set_int(offset, "int_override", -20);
+	obs_data_set_bool(offset, "bool_override", true);
+	obs_data_set_int(offset, "duration", 1500);
+	obs_data_t *hotkey = make_hook(4, "Note Off", 60, "Trigger_Hotkey_By_Name");
+	obs_data_set_string(hotkey, "hotkey", "OBSBasic.StartStreaming");
+	obs_data_set_string(hotkey, "string_override", "x");
+	obs_data_set_string(hotkey, "scene_collection", "Untitled");
+	obs_data_set_string(hotkey, "profile", "Profile 2");
+	obs_data_set_string(hotkey, "media_source", "Intro");
+	obs_data_set_string(hotkey, "transition", "Fade");
+	obs_data_set_string(hotkey, "item", "Overlay");
+	// Kept as it is, written by a newer version
+	obs_data_t *unknown = make_hook(5, "Program Change", 0, "Future_Action");
+	obs_data_set_string(unknown, "source", "Mic/Aux");
+	add_device(
+		devices, "Controller Ä",
+		[](obs_data_t *device) {
+			obs_data_set_string(device, "outname", "Controller Ä Out");
+			obs_data_set_bool(device, "enabled", true);
+			obs_data_set_bool(device, "bidirectional", true);
+			obs_data_set_bool(device, "output_running_status", true);
+			obs_data_set_int(device, "output_bytes_per_second", 3125);
+			obs_data_set_int(device, "dispatch_cpu", 2);
+			obs_data_set_string(device, "reset_sysex", "F0 7E 7F 09 01 F7");
+		},
+		{volume, filter, value_filter, offset, hotkey, unknown});
+	add_device(
+		devices, "Empty", [](obs_data_t *device) { obs_data_set_bool(device, "realtime_dispatch", true); }, {});
+	add_device(
+		devices, "Second", [](obs_data_t *) {}, {make_hook(1, "Control Change", 1, "Toggle_Mute")});
+
+	obs_data_t *config = obs_data_create();
+	obs_data_set_array(config, "MidiDevices", devices);
+	obs_data_array_release(devices);
+	const OBSData result = config;
+	obs_data_release(config);
+	return result;
+}
+
+QStringList hook_differences(const MidiHook &json, const MidiHook &cached)
+{
+	QStringList differences;
+#define COMPARE(field)                     \
+	if (!(json.field == cached.field)) \
+		differences.append(#field);
+	COMPARE(channel)
+	COMPARE(message_type)
+	COMPARE(norc)
+	COMPARE(action)
+	COMPARE(action_string)
+	COMPARE(action_migrated)
+	COMPARE(scene)
+	COMPARE(source)
+	COMPARE(filter)
+	COMPARE(transition)
+	COMPARE(item)
+	COMPARE(hotkey)
+	COMPARE(audio_source)
+	COMPARE(media_source)
+	COMPARE(duration)
+	COMPARE(scene_collection)
+	COMPARE(profile)
+	COMPARE(string_override)
+	COMPARE(bool_override)
+	COMPARE(int_override)
+	COMPARE(range_min)
+	COMPARE(range_max)
+	COMPARE(value_as_filter)
+	COMPARE(value)
+	COMPARE(coalesce)
+#undef COMPARE
+	if ((json.actions == nullptr) != (cached.actions == nullptr))
+		differences.append("actions");
+	return differences;
+}
+
+/*
+ * The saved JSON and the cache written with it give the same devices and hooks
+ */
+void test_round_trip(const OBSData &saved, const QByteArray &json, const QString &path)
+{
+	MappingCache cache;
+	const bool opened = cache.open(path, json);
+	check(opened, "round trip: cache opens with its JSON");
+	if (!opened)
+		return;
+	obs_data_array_t *devices = obs_data_get_array(saved, "MidiDevices");
+	check(cache.get_device_count() == obs_data_array_count(devices), "round trip: device count");
+	for (uint32_t i = 0; i < cache.get_device_count() && i < obs_data_array_count(devices); i++) {
+		obs_data_t *device = obs_data_array_item(devices, i);
+		const MappingCache::Device &record = cache.get_device(i);
+		const QString name = obs_data_get_string(device, "name");
+		// The settings written back from the record, through the agent that reads them
+		auto agent = std::make_unique<MidiAgent>();
+		agent->load_settings(cache, record);
+		obs_data_t *from_cache = obs_data_create();
+		agent->GetData(from_cache);
+		for (const char *key : {"name", "outname", "reset_sysex"})
+			check(QString(obs_data_get_string(device, key)) == obs_data_get_string(from_cache, key),
+			      QString("round trip: %1 %2").arg(name, key));
+		for (const char *key : {"enabled", "bidirectional", "realtime_dispatch", "output_batching", "output_running_status"})
+			check(obs_data_get_bool(device, key) == obs_data_get_bool(from_cache, key), QString("round trip: %1 %2").arg(name, key));
+		for (const char *key : {"dispatch_cpu", "output_bytes_per_second"})
+			check(obs_data_get_int(device, key) == obs_data_get_int(from_cache, key), QString("round trip: %1 %2").arg(name, key));
+		obs_data_release(from_cache);
+
+		obs_data_array_t *hooks = obs_data_get_array(device, "hooks");
+		check(record.hook_count == obs_data_array_count(hooks), QString("round trip: %1 hook count").arg(name));
+		for (uint32_t h = 0; h < record.hook_count && h < obs_data_array_count(hooks); h++) {
+			obs_data_t *hook_data = obs_data_array_item(hooks, h);
+			const MidiHook json_hook(hook_data);
+			const MidiHook cached_hook(cache, cache.get_hook(record.first_hook + h));
+			const QStringList differences = hook_differences(json_hook, cached_hook);
+			check(differences.isEmpty(), QString("round trip: %1 hook %2 %3").arg(name).arg(h).arg(differences.join(", ")));
+			obs_data_release(hook_data);
+		}
+		obs_data_array_release(hooks);
+		obs_data_release(device);
+	}
+	obs_data_array_release(devices);
+}
+
+bool write_file(const QString &path, const QByteArray &bytes)
+{
+	QFile file(path);
+	return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+bool opens(const QString &path, const QByteArray &bytes, const QByteArray &json)
+{
+	if (!write_file(path, bytes)) {
+		check(false, "rejection: write " + path);
+		return false;
+	}
+	MappingCache cache;
+	return cache.open(path, json);
+}
+void set_u32(QByteArray &bytes, int offset, uint32_t value)
+{
+	std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+uint32_t get_u32(const QByteArray &bytes, int offset)
+{
+	uint32_t value;
+	std::memcpy(&value, bytes.constData() + offset, sizeof(value));
+	return value;
+}
+
+/*
+ * Damaged files and files of another format or JSON are refused
+ */
+void test_rejection(const QString &valid_path, const QByteArray &json, const QString &path)
+{
+	QFile valid(valid_path);
+	if (!valid.open(QIODevice::ReadOnly)) {
+		check(false, "rejection: read the written cache");
+		return;
+	}
+	const QByteArray image = valid.readAll();
+	// Header layout: magic[8], version, device_size, hook_size, then sizes and checksums, 64 bytes
+	const int version_offset = 8;
+	const int device_size_offset = 12;
+	const int hook_size_offset = 16;
+	const int header_size = 64;
+
+	check(opens(path, image, json), "rejection: an unchanged copy opens");
+	check(!opens(path, image.left(image.size() - 1), json), "rejection: truncated by one byte");
+	check(!opens(path, image.left(header_size / 2), json), "rejection: truncated inside the header");
+	check(!opens(path, QByteArray(), json), "rejection: empty file");
+	QByteArray longer = image;
+	longer.append('\0');
+	check(!opens(path, longer, json), "rejection: one byte too long");
+	for (int offset : {header_size, header_size + (image.size() - header_size) / 2, image.size() - 1}) {
+		QByteArray flipped = image;
+		flipped[offset] = (char)(flipped[offset] ^ 0x01);
+		check(!opens(path, flipped, json), QString("rejection: body byte %1 flipped").arg(offset));
+	}
+	QByteArray edited_json = json;
+	edited_json[edited_json.size() / 2] = (char)(edited_json[edited_json.size() / 2] ^ 0x01);
+	check(!opens(path, image, edited_json), "rejection: JSON of the same size edited");
+	check(!opens(path, image, json + " "), "rejection: JSON grown by a byte");
+	QByteArray version = image;
+	set_u32(version, version_offset, MappingCache::version + 1);
+	check(!opens(path, version, json), "rejection: newer version");
+	QByteArray device_size = image;
+	set_u32(device_size, device_size_offset, get_u32(image, device_size_offset) + 4);
+	check(!opens(path, device_size, json), "rejection: device record size");
+	QByteArray hook_size = image;
+	set_u32(hook_size, hook_size_offset, get_u32(image, hook_size_offset) - 4);
+	check(!opens(path, hook_size, json), "rejection: hook record size");
+	QByteArray magic = image;
+	magic[0] = 'X';
+	check(!opens(path, magic, json), "rejection: magic");
+	check(!MappingCache().open(QDir(path).filePath("missing"), json), "rejection: missing file");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	base_set_log_handler(log_handler, nullptr);
+	QTemporaryDir directory;
+	ObsStub::init(directory.path().toStdString());
+	LoadCore();
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_FINISHED_LOADING);
+	QCoreApplication::processEvents();
+
+	{
+		// Saved the way Config saves: the JSON and the cache records of the loaded devices
+		GetDeviceManager()->Unload();
+		GetDeviceManager()->Load(make_config());
+		const OBSData saved = GetDeviceManager()->GetData();
+		const QByteArray json = obs_data_get_json(saved);
+		MappingCache::Builder builder;
+		GetDeviceManager()->GetData(builder);
+		const QString path = QDir(directory.path()).filePath("test.cache");
+		check(MappingCache::write(builder.finish(false), json, path), "write");
+		test_round_trip(saved, json, path);
+		test_rejection(path, json, QDir(directory.path()).filePath("damaged.cache"));
+	}
+
+	GetDeviceManager()->Unload();
+	UnloadCore();
+	ObsStub::shutdown();
+	fprintf(stderr, "%d failed\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,448 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+
+#include <util/base.h>
+#include <util/platform.h>
+
+#include "obs-stub.h"
+#include "obs-midi.h"
+#include "device-manager.h"
+#include "mapping-cache.h"
+#include "latency-histogram.h"
+
+/*
+ * obs-midi-bench
+ * Microbenchmarks of the MIDI input and OBS event hot paths, run against the stub OBS with
+ * synthetic libremidi messages. MIDI clients use libremidi's dummy backend in headless builds,
+ * so no MIDI hardware or sequencer is needed. Every result is the time of one
+ * operation, taken from several timed batches: min, median and mean over the batches.
+ * OBS calls are the stub's, so actions and fan-out include its bookkeeping instead of libobs' work.
+ *
+ * Usage: obs-midi-bench [--quick] [--filter <part of a benchmark name>] [--output <file>]
+ * The results are written as JSON to stdout or the output file, logs go to stderr.
+ */
+namespace {
+struct Options {
+	bool quick = false;
+	QString filter;
+	QString output;
+};
+Options options;
+QJsonArray results;
+
+constexpr int audio_sources = 64;
+// (type, channel, number) keys the generated hooks use before they turn to value filters
+constexpr int unique_keys = 3 * 16 * 128;
+
+template<typename T> inline void keep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static const void *volatile sink;
+	sink = &value;
+#endif
+}
+
+void log_handler(int level, const char *format, va_list args, void *)
+{
+	if (level > LOG_WARNING)
+		return;
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+uint64_t stub_call_count()
+{
+	uint64_t count = 0;
+	for (const auto &entry : ObsStub::get_call_stats())
+		count += entry.second.count;
+	return count;
+}
+
+/*
+ * Times op(i) for i = 0, 1, 2... in batches grown until one takes the sample time, then
+ * records the time per operation of each batch
+ */
+void run(const QString &name, QJsonObject params, const std::function<void(size_t)> &op)
+{
+	if (!options.filter.isEmpty() && !name.contains(options.filter))
+		return;
+	const uint64_t sample_ns = options.quick ? 2000000 : 20000000;
+	const int samples = options.quick ? 3 : 9;
+	size_t i = 0;
+	size_t batch = 1;
+	while (true) {
+		const uint64_t start = os_gettime_ns();
+		for (size_t n = 0; n < batch; n++)
+			op(i++);
+		if (os_gettime_ns() - start >= sample_ns || batch >= (size_t(1) << 30))
+			break;
+		batch *= 2;
+	}
+	std::vector<double> times;
+	const uint64_t calls = stub_call_count();
+	for (int sample = 0; sample < samples; sample++) {
+		const uint64_t start = os_gettime_ns();
+		for (size_t n = 0; n < batch; n++)
+			op(i++);
+		times.push_back(double(os_gettime_ns() - start) / batch);
+	}
+	const double obs_calls = double(stub_call_count() - calls) / (double(batch) * samples);
+	std::sort(times.begin(), times.end());
+	double mean = 0;
+	for (double time : times)
+		mean += time / times.size();
+	QJsonObject result;
+	result["name"] = name;
+	result["params"] = params;
+	result["batch"] = (double)batch;
+	result["samples"] = samples;
+	result["ns_min"] = times.front();
+	result["ns_median"] = times[times.size() / 2];
+	result["ns_mean"] = mean;
+	result["obs_calls_per_op"] = obs_calls;
+	results.append(result);
+	fprintf(stderr, "%-24s %-40s %12.1f ns\n", name.toUtf8().constData(), QJsonDocument(params).toJson(QJsonDocument::Compact).constData(),
+		times[times.size() / 2]);
+}
+
+struct HookKey {
+	MidiMessageType type;
+	int channel;
+	int norc;
+	std::optional<int> value;
+};
+/* Every hook on a key of its own, value filters on the same keys past unique_keys */
+HookKey hook_key(int index)
+{
+	static const MidiMessageType types[] = {MidiMessageType::Control_Change, MidiMessageType::Note_On, MidiMessageType::Note_Off};
+	HookKey key{types[index % 3], (index / 3) % 16 + 1, (index / 48) % 128, std::nullopt};
+	if (index >= unique_keys)
+		key.value = index / unique_keys;
+	return key;
+}
+QString audio_source_name(int index)
+{
+	return QString("Audio %1").arg(index % audio_sources);
+}
+
+/*
+ * A config of devices devices with hooks hooks each, running action on the audio sources in turn.
+ * Devices are disabled, so loading it never opens a port.
+ */
+OBSData make_config(int devices, int hooks, const char *action)
+{
+	obs_data_t *config = obs_data_create();
+	obs_data_array_t *device_array = obs_data_array_create();
+	for (int d = 0; d < devices; d++) {
+		obs_data_t *device = obs_data_create();
+		obs_data_set_string(device, "name", QString("Bench %1").arg(d).toUtf8().constData());
+		obs_data_set_string(device, "outname", "");
+		obs_data_set_bool(device, "enabled", false);
+		obs_data_array_t *hook_array = obs_data_array_create();
+		for (int h = 0; h < hooks; h++) {
+			const HookKey key = hook_key(h);
+			const QByteArray source = audio_source_name(h).toUtf8();
+			obs_data_t *hook = obs_data_create();
+			obs_data_set_int(hook, "channel", key.channel);
+			obs_data_set_string(hook, "message_type", MidiMessage::message_type_to_string(key.type).toUtf8().constData());
+			obs_data_set_int(hook, "norc", key.norc);
+			obs_data_set_string(hook, "action", action);
+			obs_data_set_string(hook, "audio_source", source.constData());
+			obs_data_set_string(hook, "source", source.constData());
+			obs_data_set_bool(hook, "value_as_filter", key.value.has_value());
+			obs_data_set_int(hook, "value", key.value.value_or(0));
+			obs_data_array_push_back(hook_array, hook);
+			obs_data_release(hook);
+		}
+		obs_data_set_array(device, "hooks", hook_array);
+		obs_data_array_release(hook_array);
+		obs_data_array_push_back(device_array, device);
+		obs_data_release(device);
+	}
+	obs_data_set_array(config, "MidiDevices", device_array);
+	obs_data_array_release(device_array);
+	const OBSData result = config;
+	obs_data_release(config);
+	return result;
+}
+/* Replaces the devices with those of config and lets the events system pick up their feedback */
+QVector<MidiAgent *> load(const OBSData &config)
+{
+	GetDeviceManager()->Unload();
+	GetDeviceManager()->Load(config);
+	QCoreApplication::processEvents();
+	return GetDeviceManager()->get_active_midi_devices();
+}
+
+/* Synthetic input, the channel messages a controller sends */
+std::vector<libremidi::message> make_messages(size_t count)
+{
+	static const unsigned char statuses[] = {0x80, 0x90, 0xB0, 0xB0, 0xC0, 0xE0};
+	std::mt19937 random(1);
+	std::vector<libremidi::message> messages(count);
+	for (auto &message : messages) {
+		const unsigned char status = statuses[random() % sizeof(statuses)] | (random() % 16);
+		message.bytes.push_back(status);
+		message.bytes.push_back(random() % 128);
+		if ((status & 0xF0) != 0xC0)
+			message.bytes.push_back(random() % 128);
+	}
+	return messages;
+}
+
+void bench_decode()
+{
+	const std::vector<libremidi::message> messages = make_messages(4096);
+	run("midi.decode", {}, [&](size_t i) {
+		MidiMessage message;
+		message.set_message(messages[i % messages.size()]);
+		keep(message);
+	});
+}
+
+/* What the dispatcher adds per message to keep its latency histograms */
+void bench_latency()
+{
+	auto histogram = std::make_unique<LatencyHistogram>();
+	run("latency.record", {}, [&](size_t i) { histogram->record(os_gettime_ns() - (i & 0xFFFF)); });
+	run("latency.summary", {}, [&](size_t) { keep(histogram->summary()); });
+}
+
+void bench_hook_lookup()
+{
+	for (int hooks : {10, 100, 1000, 10000}) {
+		const auto agents = load(make_config(1, hooks, "Set_Sync_Offset"));
+		const MidiAgent *agent = agents.front();
+		std::mt19937 random(hooks);
+		std::vector<HookKey> hits(1024);
+		for (auto &key : hits)
+			key = hook_key(random() % hooks);
+		run("hook_lookup.hit", {{"hooks", hooks}}, [&](size_t i) {
+			const HookKey &key = hits[i % hits.size()];
+			keep(agent->find_midi_hook(key.type, key.channel, key.norc, key.value));
+		});
+		run("hook_lookup.miss", {{"hooks", hooks}}, [&](size_t i) {
+			const HookKey &key = hits[i % hits.size()];
+			keep(agent->find_midi_hook(MidiMessageType::Pitch_Bend, key.channel, key.norc));
+		});
+	}
+}
+
+/*
+ * Set_Sync_Offset raises no feedback, Set_Volume is fed back to the device that ran it
+ */
+void bench_actions()
+{
+	for (const char *action : {"Set_Sync_Offset", "Set_Volume"}) {
+		const auto agents = load(make_config(1, 1, action));
+		MidiHook *hook = agents.front()->GetMidiHooks().front();
+		run("action.execute", {{"action", action}}, [&](size_t i) {
+			hook->value.emplace((int)(i % 128));
+			hook->EXE();
+		});
+	}
+}
+
+/*
+ * One volume change raised by the source, through the events system to every agent with a
+ * Set_Volume hook on it
+ */
+void bench_fanout()
+{
+	obs_source_t *source = obs_get_source_by_name(audio_source_name(0).toUtf8().constData());
+	for (int agents : {1, 4, 16, 64}) {
+		load(make_config(agents, 1, "Set_Volume"));
+		run("events.fanout", {{"agents", agents}}, [&](size_t i) { obs_source_set_volume(source, (float)(i % 128) / 127.0f); });
+	}
+	obs_source_release(source);
+}
+
+/*
+ * handle_obs_event on one agent: an event its hooks are indexed under, one for a source no hook
+ * uses and one of a type none of them feeds back
+ */
+void bench_feedback()
+{
+	for (int hooks : {100, 1000, 10000}) {
+		MidiAgent *agent = load(make_config(1, hooks, "Set_Volume")).front();
+		std::vector<RpcEvent> matched;
+		for (int i = 0; i < audio_sources * 8; i++)
+			matched.emplace_back(RpcEvent::SourceVolumeChanged, RpcEvent::VolumePayload{audio_source_name(i), (i % 128) / 127.0});
+		const RpcEvent unmapped(RpcEvent::SourceVolumeChanged, RpcEvent::VolumePayload{"Unmapped", 0.5});
+		const RpcEvent unwanted(RpcEvent::SourceMuteStateChanged, RpcEvent::MutePayload{audio_source_name(0), true});
+		const int per_event = std::max(1, hooks / audio_sources);
+		run("feedback.match", {{"hooks", hooks}, {"hooks_per_event", per_event}},
+		    [&](size_t i) { agent->handle_obs_event(matched[i % matched.size()]); });
+		run("feedback.unmapped", {{"hooks", hooks}}, [&](size_t) { agent->handle_obs_event(unmapped); });
+		run("feedback.unwanted", {{"hooks", hooks}}, [&](size_t) { agent->handle_obs_event(unwanted); });
+	}
+}
+
+/*
+ * What every device adds to a load apart from its config: the MIDI clients, callbacks and
+ * the dispatcher and output writer threads, made and torn down again
+ */
+void bench_device_setup()
+{
+	run("device.setup", {}, [](size_t) {
+		auto *agent = new MidiAgent();
+		agent->set_callbacks();
+		delete agent;
+	});
+}
+
+/*
+ * Saving and loading the whole config: the obs_data tree and its JSON, the settings and hooks
+ * of its devices on their own, built and deleted again, and a full reload from the parsed JSON
+ * or from the mapping cache, which includes unloading the previous devices
+ */
+void bench_config(const QString &directory)
+{
+	for (int hooks : {1000, 10000}) {
+		const int devices = 8;
+		const OBSData config = make_config(devices, hooks / devices, "Set_Volume");
+		load(config);
+		const QJsonObject params{{"devices", devices}, {"hooks", hooks}};
+		run("config.get_data", params, [&](size_t) { keep(GetDeviceManager()->GetData()); });
+		const OBSData data = GetDeviceManager()->GetData();
+		run("config.to_json", params, [&](size_t) { keep(obs_data_get_json(data)); });
+		const QByteArray json = obs_data_get_json(data);
+		run("config.parse", params, [&](size_t) {
+			obs_data_t *parsed = obs_data_create_from_json(json.constData());
+			obs_data_release(parsed);
+		});
+		std::vector<OBSData> device_data;
+		obs_data_array_t *device_array = obs_data_get_array(data, "MidiDevices");
+		for (size_t i = 0; i < obs_data_array_count(device_array); i++) {
+			obs_data_t *device = obs_data_array_item(device_array, i);
+			device_data.emplace_back(device);
+			obs_data_release(device);
+		}
+		obs_data_array_release(device_array);
+		// Not a device of the manager, it only parses
+		auto scratch = std::make_unique<MidiAgent>();
+		run("config.load_settings", params, [&](size_t) {
+			for (const auto &device : device_data)
+				scratch->load_settings(device);
+		});
+		run("config.load_hooks", params, [&](size_t) {
+			for (const auto &device : device_data)
+				qDeleteAll(scratch->load_hooks(device));
+		});
+		run("config.reload", params, [&](size_t) {
+			GetDeviceManager()->Unload();
+			GetDeviceManager()->Load(data);
+		});
+		MappingCache::Builder builder;
+		GetDeviceManager()->GetData(builder);
+		const QString cache_path = QDir(directory).filePath("bench.cache");
+		if (!MappingCache::write(builder.finish(false), json, cache_path)) {
+			blog(LOG_WARNING, "Could not write %s", cache_path.qtocs());
+			continue;
+		}
+		MappingCache mapped;
+		if (mapped.open(cache_path, json)) {
+			run("config.load_hooks_cache", params, [&](size_t) {
+				for (uint32_t i = 0; i < mapped.get_device_count(); i++)
+					qDeleteAll(scratch->load_hooks(mapped, mapped.get_device(i)));
+			});
+		}
+		run("config.reload_cache", params, [&](size_t) {
+			MappingCache cache;
+			if (!cache.open(cache_path, json))
+				return;
+			GetDeviceManager()->Unload();
+			GetDeviceManager()->Load(cache);
+		});
+		QCoreApplication::processEvents();
+	}
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	const QStringList arguments = app.arguments();
+	for (int i = 1; i < arguments.size(); i++) {
+		if (arguments[i] == "--quick") {
+			options.quick = true;
+		} else if (arguments[i] == "--filter" && i + 1 < arguments.size()) {
+			options.filter = arguments[++i];
+		} else if (arguments[i] == "--output" && i + 1 < arguments.size()) {
+			options.output = arguments[++i];
+		} else {
+			fprintf(stderr, "Usage: obs-midi-bench [--quick] [--filter <name>] [--output <file>]\n");
+			return 2;
+		}
+	}
+	base_set_log_handler(log_handler, nullptr);
+
+	QTemporaryDir directory;
+	ObsStub::init(directory.path().toStdString());
+	obs_source_t *scene = ObsStub::add_scene("Bench Scene");
+	for (int i = 0; i < audio_sources; i++)
+		ObsStub::add_scene_item(scene, ObsStub::add_input(audio_source_name(i).toUtf8().constData()));
+	LoadCore();
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_FINISHED_LOADING);
+	QCoreApplication::processEvents();
+
+	bench_decode();
+	bench_latency();
+	bench_hook_lookup();
+	bench_actions();
+	bench_fanout();
+	bench_feedback();
+	bench_device_setup();
+	bench_config(directory.path());
+
+	GetDeviceManager()->Unload();
+	UnloadCore();
+	ObsStub::shutdown();
+
+	QJsonObject report;
+	report["version"] = OBS_MIDI_VERSION;
+	report["qt"] = qVersion();
+	report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+	report["quick"] = options.quick;
+	report["results"] = results;
+	const QByteArray json = QJsonDocument(report).toJson();
+	if (options.output.isEmpty()) {
+		fwrite(json.constData(), 1, json.size(), stdout);
+		return 0;
+	}
+	QFile file(options.output);
+	if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+		fprintf(stderr, "Could not write %s\n", options.output.toUtf8().constData());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,1138 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "obs-stub.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <obs-module.h>
+#include <graphics/vec2.h>
+#include <util/bmem.h>
+#include <util/calldata.h>
+#include <util/config-file.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+namespace {
+struct StubItem;
+struct StubSource {
+	std::atomic<long> refs{1};
+	bool destroyed = false;
+	bool removed = false;
+	std::string name;
+	std::string id;
+	obs_source_type type = OBS_SOURCE_TYPE_INPUT;
+	uint32_t output_flags = 0;
+	signal_handler_t *signals = nullptr;
+	obs_data_t *settings = nullptr;
+	obs_data_t *private_settings = nullptr;
+	float volume = 1.0f;
+	bool muted = false;
+	bool enabled = true;
+	int64_t sync_offset = 0;
+	std::vector<StubItem *> items;    // scenes and groups
+	std::vector<StubSource *> filters; // sources with filters
+	StubSource *parent = nullptr;      // filters
+	bool fixed = false;                // transitions
+};
+struct StubItem {
+	std::atomic<long> refs{1};
+	int64_t id = 0;
+	StubSource *scene = nullptr;
+	StubSource *source = nullptr;
+	bool visible = true;
+	bool locked = false;
+	vec2 pos{};
+	vec2 scale{};
+	vec2 bounds{};
+	float rot = 0.0f;
+	uint32_t alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
+	obs_bounds_type bounds_type = OBS_BOUNDS_NONE;
+	uint32_t bounds_alignment = 0;
+	obs_sceneitem_crop crop{};
+};
+
+const char *const core_signals[] = {"void source_create(ptr source)", "void source_destroy(ptr source)", "void source_remove(ptr source)",
+				    "void source_rename(ptr source, string new_name, string prev_name)", nullptr};
+const char *const source_signals[] = {"void destroy(ptr source)",
+				      "void remove(ptr source)",
+				      "void mute(ptr source, bool muted)",
+				      "void enable(ptr source, bool enabled)",
+				      "void rename(ptr source, string new_name, string prev_name)",
+				      "void volume(ptr source, in out float volume)",
+				      "void audio_sync(ptr source, int out int offset)",
+				      "void audio_mixers(ptr source, in out int mixers)",
+				      "void filter_add(ptr source, ptr filter)",
+				      "void filter_remove(ptr source, ptr filter)",
+				      "void reorder_filters(ptr source)",
+				      "void transition_start(ptr source)",
+				      "void transition_video_stop(ptr source)",
+				      "void transition_stop(ptr source)",
+				      nullptr};
+const char *const scene_signals[] = {"void item_add(ptr scene, ptr item)",
+				     "void item_remove(ptr scene, ptr item)",
+				     "void reorder(ptr scene)",
+				     "void item_visible(ptr scene, ptr item, bool visible)",
+				     "void item_select(ptr scene, ptr item)",
+				     "void item_deselect(ptr scene, ptr item)",
+				     "void item_transform(ptr scene, ptr item)",
+				     "void item_locked(ptr scene, ptr item, bool locked)",
+				     nullptr};
+
+// Guards the model, never held while signals or frontend callbacks run
+std::recursive_mutex model_mutex;
+std::vector<std::unique_ptr<StubSource>> sources;
+std::vector<std::unique_ptr<StubItem>> items;
+int64_t next_item_id = 1;
+signal_handler_t *core_signal_handler = nullptr;
+config_t *profile_config = nullptr;
+std::string config_dir;
+std::vector<std::pair<obs_frontend_event_cb, void *>> frontend_callbacks;
+StubSource *current_scene = nullptr;
+StubSource *preview_scene = nullptr;
+StubSource *current_transition = nullptr;
+StubSource *previous_scene = nullptr;
+int transition_duration = 300;
+bool streaming = false;
+bool recording = false;
+bool recording_paused = false;
+bool replay_buffer = false;
+bool studio_mode = false;
+bool preview_enabled = true;
+std::string profile = "Stub";
+std::string scene_collection = "Stub";
+
+std::mutex calls_mutex;
+std::unordered_map<const char *, ObsStub::CallStats> call_stats;
+std::deque<const char *> call_log;
+
+/*
+ * Counts and times a stubbed call, keyed by __func__ which is one array per function
+ */
+class CallTimer {
+public:
+	explicit CallTimer(const char *function) : function(function), start(os_gettime_ns()) {}
+	~CallTimer()
+	{
+		const uint64_t duration = os_gettime_ns() - start;
+		std::lock_guard<std::mutex> lock(calls_mutex);
+		ObsStub::CallStats &stats = call_stats[function];
+		stats.count++;
+		stats.total_ns += duration;
+		stats.max_ns = std::max(stats.max_ns, duration);
+		call_log.push_back(function);
+		if (call_log.size() > ObsStub::max_call_log)
+			call_log.pop_front();
+	}
+
+private:
+	const char *function;
+	uint64_t start;
+};
+#define STUB_CALL() const CallTimer call_timer(__func__)
+
+StubSource *stub(const obs_source_t *source)
+{
+	return reinterpret_cast<StubSource *>(const_cast<obs_source_t *>(source));
+}
+StubSource *stub(const obs_scene_t *scene)
+{
+	return reinterpret_cast<StubSource *>(const_cast<obs_scene_t *>(scene));
+}
+StubSource *stub(obs_weak_source_t *weak)
+{
+	return reinterpret_cast<StubSource *>(weak);
+}
+StubItem *stub(const obs_sceneitem_t *item)
+{
+	return reinterpret_cast<StubItem *>(const_cast<obs_sceneitem_t *>(item));
+}
+obs_source_t *source_of(StubSource *source)
+{
+	return reinterpret_cast<obs_source_t *>(source);
+}
+obs_scene_t *scene_of(StubSource *source)
+{
+	return reinterpret_cast<obs_scene_t *>(source);
+}
+obs_sceneitem_t *item_of(StubItem *item)
+{
+	return reinterpret_cast<obs_sceneitem_t *>(item);
+}
+obs_source_t *get_ref(StubSource *source)
+{
+	if (!source)
+		return nullptr;
+	source->refs++;
+	return source_of(source);
+}
+
+void signal_source(StubSource *source, const char *signal)
+{
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", source);
+	signal_handler_signal(source->signals, signal, &data);
+	calldata_free(&data);
+}
+void signal_core(const char *signal, StubSource *source)
+{
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", source);
+	signal_handler_signal(core_signal_handler, signal, &data);
+	calldata_free(&data);
+}
+void signal_item(StubItem *item, const char *signal)
+{
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "scene", item->scene);
+	calldata_set_ptr(&data, "item", item);
+	calldata_set_bool(&data, "visible", item->visible);
+	calldata_set_bool(&data, "locked", item->locked);
+	signal_handler_signal(item->scene->signals, signal, &data);
+	calldata_free(&data);
+}
+void signal_filter(StubSource *source, StubSource *filter, const char *signal)
+{
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", source);
+	calldata_set_ptr(&data, "filter", filter);
+	signal_handler_signal(source->signals, signal, &data);
+	calldata_free(&data);
+}
+
+StubSource *create_source(const char *name, const char *id, obs_source_type type, uint32_t output_flags, bool announce)
+{
+	StubSource *source;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		sources.push_back(std::make_unique<StubSource>());
+		source = sources.back().get();
+	}
+	source->name = name ? name : "";
+	source->id = id ? id : "";
+	source->type = type;
+	source->output_flags = output_flags;
+	source->signals = signal_handler_create();
+	signal_handler_add_array(source->signals, source_signals);
+	if (type == OBS_SOURCE_TYPE_SCENE)
+		signal_handler_add_array(source->signals, scene_signals);
+	source->settings = obs_data_create();
+	source->private_settings = obs_data_create();
+	if (announce)
+		signal_core("source_create", source);
+	return source;
+}
+StubSource *find_source(const char *name)
+{
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	for (const auto &source : sources) {
+		if (!source->removed && !source->destroyed && source->type != OBS_SOURCE_TYPE_FILTER && source->name == name)
+			return source.get();
+	}
+	return nullptr;
+}
+void release(StubSource *source)
+{
+	if (!source || --source->refs > 0)
+		return;
+	source->destroyed = true;
+	signal_core("source_destroy", source);
+	signal_source(source, "destroy");
+}
+void set_scene(StubSource *scene)
+{
+	StubSource *transition;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		previous_scene = current_scene;
+		current_scene = scene;
+		transition = current_transition;
+	}
+	if (transition)
+		signal_source(transition, "transition_start");
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_SCENE_CHANGED);
+	if (transition) {
+		signal_source(transition, "transition_video_stop");
+		signal_source(transition, "transition_stop");
+	}
+}
+void get_list(obs_frontend_source_list *list, obs_source_type type)
+{
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	for (const auto &source : sources) {
+		if (source->type != type || source->removed || source->destroyed)
+			continue;
+		obs_source_t *ref = get_ref(source.get());
+		da_push_back(list->sources, &ref);
+	}
+}
+bool enum_items(StubSource *scene, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	std::vector<StubItem *> scene_items;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		scene_items = scene->items;
+	}
+	for (auto item : scene_items) {
+		if (!callback(scene_of(scene), item_of(item), param))
+			return false;
+	}
+	return true;
+}
+} // namespace
+
+namespace ObsStub {
+void init(const std::string &directory)
+{
+	config_dir = directory;
+	os_mkdirs(config_dir.c_str());
+	core_signal_handler = signal_handler_create();
+	signal_handler_add_array(core_signal_handler, core_signals);
+	config_open_string(&profile_config, "");
+}
+void shutdown()
+{
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	for (const auto &source : sources) {
+		signal_handler_destroy(source->signals);
+		obs_data_release(source->settings);
+		obs_data_release(source->private_settings);
+	}
+	sources.clear();
+	items.clear();
+	frontend_callbacks.clear();
+	current_scene = preview_scene = current_transition = previous_scene = nullptr;
+	signal_handler_destroy(core_signal_handler);
+	core_signal_handler = nullptr;
+	config_close(profile_config);
+	profile_config = nullptr;
+}
+obs_source_t *add_input(const char *name, bool audio)
+{
+	return source_of(create_source(name, audio ? "wasapi_input_capture" : "image_source", OBS_SOURCE_TYPE_INPUT,
+				       audio ? OBS_SOURCE_AUDIO : OBS_SOURCE_VIDEO, true));
+}
+obs_source_t *add_scene(const char *name)
+{
+	StubSource *scene = create_source(name, "scene", OBS_SOURCE_TYPE_SCENE, OBS_SOURCE_VIDEO, true);
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	if (!current_scene)
+		current_scene = scene;
+	return source_of(scene);
+}
+obs_sceneitem_t *add_scene_item(obs_source_t *scene, obs_source_t *source)
+{
+	StubItem *item;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		items.push_back(std::make_unique<StubItem>());
+		item = items.back().get();
+		item->id = next_item_id++;
+		item->scene = stub(scene);
+		item->source = stub(source);
+		vec2_set(&item->scale, 1.0f, 1.0f);
+		item->scene->items.push_back(item);
+	}
+	signal_item(item, "item_add");
+	return item_of(item);
+}
+obs_source_t *add_transition(const char *name, bool fixed)
+{
+	StubSource *transition = create_source(name, fixed ? "cut_transition" : "fade_transition", OBS_SOURCE_TYPE_TRANSITION, OBS_SOURCE_VIDEO, true);
+	transition->fixed = fixed;
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	if (!current_transition)
+		current_transition = transition;
+	return source_of(transition);
+}
+obs_source_t *add_filter(obs_source_t *source, const char *name)
+{
+	StubSource *filter = create_source(name, "color_filter", OBS_SOURCE_TYPE_FILTER, OBS_SOURCE_VIDEO, false);
+	obs_source_filter_add(source, source_of(filter));
+	return source_of(filter);
+}
+void remove_source(obs_source_t *source)
+{
+	StubSource *removed = stub(source);
+	removed->removed = true;
+	signal_core("source_remove", removed);
+	signal_source(removed, "remove");
+	// The reference the model held since the source was added
+	release(removed);
+}
+void frontend_event(enum obs_frontend_event event)
+{
+	std::vector<std::pair<obs_frontend_event_cb, void *>> callbacks;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		callbacks = frontend_callbacks;
+	}
+	for (const auto &callback : callbacks)
+		callback.first(event, callback.second);
+}
+std::map<std::string, CallStats> get_call_stats()
+{
+	std::lock_guard<std::mutex> lock(calls_mutex);
+	std::map<std::string, CallStats> stats;
+	for (const auto &entry : call_stats)
+		stats[entry.first] = entry.second;
+	return stats;
+}
+std::vector<std::string> get_call_log()
+{
+	std::lock_guard<std::mutex> lock(calls_mutex);
+	return std::vector<std::string>(call_log.begin(), call_log.end());
+}
+void clear_calls()
+{
+	std::lock_guard<std::mutex> lock(calls_mutex);
+	call_stats.clear();
+	call_log.clear();
+}
+} // namespace ObsStub
+
+///////////////////
+// MODULE LOOKUP //
+///////////////////
+obs_module_t *obs_current_module(void)
+{
+	return nullptr;
+}
+const char *obs_module_text(const char *lookup_string)
+{
+	return lookup_string;
+}
+char *obs_module_get_config_path(obs_module_t *, const char *file)
+{
+	return bstrdup((config_dir + "/" + file).c_str());
+}
+
+//////////
+// CORE //
+//////////
+signal_handler_t *obs_get_signal_handler(void)
+{
+	return core_signal_handler;
+}
+obs_source_t *obs_get_source_by_name(const char *name)
+{
+	STUB_CALL();
+	return get_ref(find_source(name));
+}
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+	STUB_CALL();
+	std::vector<StubSource *> inputs;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		for (const auto &source : sources) {
+			if (source->type == OBS_SOURCE_TYPE_INPUT && !source->removed && !source->destroyed)
+				inputs.push_back(source.get());
+		}
+	}
+	for (auto source : inputs) {
+		if (!enum_proc(param, source_of(source)))
+			break;
+	}
+}
+void obs_queue_task(enum obs_task_type, obs_task_t task, void *param, bool)
+{
+	STUB_CALL();
+	task(param);
+}
+video_t *obs_get_video(void)
+{
+	return nullptr;
+}
+double obs_get_active_fps(void)
+{
+	return 0.0;
+}
+uint64_t obs_get_average_frame_time_ns(void)
+{
+	return 0;
+}
+uint32_t obs_get_total_frames(void)
+{
+	return 0;
+}
+uint32_t obs_get_lagged_frames(void)
+{
+	return 0;
+}
+
+/////////////
+// SOURCES //
+/////////////
+void obs_source_addref(obs_source_t *source)
+{
+	if (source)
+		stub(source)->refs++;
+}
+void obs_source_release(obs_source_t *source)
+{
+	release(stub(source));
+}
+obs_weak_source_t *obs_source_get_weak_source(obs_source_t *source)
+{
+	return reinterpret_cast<obs_weak_source_t *>(source);
+}
+obs_source_t *obs_weak_source_get_source(obs_weak_source_t *weak)
+{
+	StubSource *source = stub(weak);
+	return (source && !source->destroyed) ? get_ref(source) : nullptr;
+}
+void obs_weak_source_addref(obs_weak_source_t *) {}
+void obs_weak_source_release(obs_weak_source_t *) {}
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? stub(source)->name.c_str() : nullptr;
+}
+const char *obs_source_get_id(const obs_source_t *source)
+{
+	return source ? stub(source)->id.c_str() : nullptr;
+}
+const char *obs_source_get_display_name(const char *id)
+{
+	return id;
+}
+enum obs_source_type obs_source_get_type(const obs_source_t *source)
+{
+	return source ? stub(source)->type : OBS_SOURCE_TYPE_INPUT;
+}
+uint32_t obs_source_get_output_flags(const obs_source_t *source)
+{
+	return source ? stub(source)->output_flags : 0;
+}
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
+{
+	return source ? stub(source)->signals : nullptr;
+}
+bool obs_source_removed(const obs_source_t *source)
+{
+	return source && stub(source)->removed;
+}
+uint32_t obs_source_get_width(obs_source_t *source)
+{
+	return (source && (stub(source)->output_flags & OBS_SOURCE_VIDEO)) ? 1920 : 0;
+}
+uint32_t obs_source_get_height(obs_source_t *source)
+{
+	return (source && (stub(source)->output_flags & OBS_SOURCE_VIDEO)) ? 1080 : 0;
+}
+void obs_source_set_volume(obs_source_t *source, float volume)
+{
+	STUB_CALL();
+	if (!source)
+		return;
+	StubSource *target = stub(source);
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", target);
+	calldata_set_float(&data, "volume", volume);
+	signal_handler_signal(target->signals, "volume", &data);
+	target->volume = (float)calldata_float(&data, "volume");
+	calldata_free(&data);
+}
+float obs_source_get_volume(const obs_source_t *source)
+{
+	STUB_CALL();
+	return source ? stub(source)->volume : 0.0f;
+}
+void obs_source_set_muted(obs_source_t *source, bool muted)
+{
+	STUB_CALL();
+	if (!source)
+		return;
+	StubSource *target = stub(source);
+	target->muted = muted;
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", target);
+	calldata_set_bool(&data, "muted", muted);
+	signal_handler_signal(target->signals, "mute", &data);
+	calldata_free(&data);
+}
+bool obs_source_muted(const obs_source_t *source)
+{
+	STUB_CALL();
+	return source && stub(source)->muted;
+}
+void obs_source_set_enabled(obs_source_t *source, bool enabled)
+{
+	STUB_CALL();
+	if (!source)
+		return;
+	StubSource *target = stub(source);
+	target->enabled = enabled;
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", target);
+	calldata_set_bool(&data, "enabled", enabled);
+	signal_handler_signal(target->signals, "enable", &data);
+	calldata_free(&data);
+}
+bool obs_source_enabled(const obs_source_t *source)
+{
+	STUB_CALL();
+	return source && stub(source)->enabled;
+}
+void obs_source_set_sync_offset(obs_source_t *source, int64_t offset)
+{
+	STUB_CALL();
+	if (!source)
+		return;
+	StubSource *target = stub(source);
+	target->sync_offset = offset;
+	calldata_t data;
+	calldata_init(&data);
+	calldata_set_ptr(&data, "source", target);
+	calldata_set_int(&data, "offset", offset);
+	signal_handler_signal(target->signals, "audio_sync", &data);
+	calldata_free(&data);
+}
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+	STUB_CALL();
+	if (!source)
+		return nullptr;
+	obs_data_addref(stub(source)->settings);
+	return stub(source)->settings;
+}
+obs_data_t *obs_source_get_private_settings(obs_source_t *source)
+{
+	STUB_CALL();
+	if (!source)
+		return nullptr;
+	obs_data_addref(stub(source)->private_settings);
+	return stub(source)->private_settings;
+}
+void obs_source_update(obs_source_t *source, obs_data_t *settings)
+{
+	STUB_CALL();
+	if (source && settings)
+		obs_data_apply(stub(source)->settings, settings);
+}
+obs_properties_t *obs_source_properties(const obs_source_t *)
+{
+	STUB_CALL();
+	return nullptr;
+}
+obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings)
+{
+	STUB_CALL();
+	StubSource *source = create_source(name, id, OBS_SOURCE_TYPE_INPUT, OBS_SOURCE_VIDEO, false);
+	if (settings)
+		obs_data_apply(source->settings, settings);
+	return source_of(source);
+}
+void obs_source_enum_filters(obs_source_t *source, obs_source_enum_proc_t callback, void *param)
+{
+	STUB_CALL();
+	if (!source)
+		return;
+	std::vector<StubSource *> filters;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		filters = stub(source)->filters;
+	}
+	for (auto filter : filters)
+		callback(source, source_of(filter), param);
+}
+obs_source_t *obs_source_get_filter_by_name(obs_source_t *source, const char *name)
+{
+	STUB_CALL();
+	if (!source || !name)
+		return nullptr;
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	for (auto filter : stub(source)->filters) {
+		if (filter->name == name)
+			return get_ref(filter);
+	}
+	return nullptr;
+}
+void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
+{
+	STUB_CALL();
+	if (!source || !filter)
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		stub(source)->filters.push_back(stub(filter));
+		stub(filter)->parent = stub(source);
+	}
+	stub(filter)->refs++;
+	signal_filter(stub(source), stub(filter), "filter_add");
+}
+void obs_source_filter_remove(obs_source_t *source, obs_source_t *filter)
+{
+	STUB_CALL();
+	if (!source || !filter)
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		auto &filters = stub(source)->filters;
+		const auto it = std::find(filters.begin(), filters.end(), stub(filter));
+		if (it == filters.end())
+			return;
+		filters.erase(it);
+		stub(filter)->parent = nullptr;
+	}
+	signal_filter(stub(source), stub(filter), "filter_remove");
+	release(stub(filter));
+}
+obs_source_t *obs_filter_get_parent(const obs_source_t *filter)
+{
+	return filter ? source_of(stub(filter)->parent) : nullptr;
+}
+void obs_source_media_play_pause(obs_source_t *, bool)
+{
+	STUB_CALL();
+}
+void obs_source_media_restart(obs_source_t *)
+{
+	STUB_CALL();
+}
+void obs_source_media_stop(obs_source_t *)
+{
+	STUB_CALL();
+}
+void obs_source_media_next(obs_source_t *)
+{
+	STUB_CALL();
+}
+void obs_source_media_previous(obs_source_t *)
+{
+	STUB_CALL();
+}
+enum obs_media_state obs_source_media_get_state(obs_source_t *)
+{
+	STUB_CALL();
+	return OBS_MEDIA_STATE_NONE;
+}
+
+////////////
+// SCENES //
+////////////
+obs_scene_t *obs_scene_from_source(const obs_source_t *source)
+{
+	return (source && stub(source)->type == OBS_SOURCE_TYPE_SCENE) ? scene_of(stub(source)) : nullptr;
+}
+obs_source_t *obs_scene_get_source(const obs_scene_t *scene)
+{
+	return scene ? source_of(stub(scene)) : nullptr;
+}
+void obs_scene_enum_items(obs_scene_t *scene, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	STUB_CALL();
+	if (scene)
+		enum_items(stub(scene), callback, param);
+}
+void obs_sceneitem_addref(obs_sceneitem_t *item)
+{
+	if (item)
+		stub(item)->refs++;
+}
+void obs_sceneitem_release(obs_sceneitem_t *item)
+{
+	if (item)
+		stub(item)->refs--;
+}
+obs_source_t *obs_sceneitem_get_source(const obs_sceneitem_t *item)
+{
+	return item ? source_of(stub(item)->source) : nullptr;
+}
+obs_scene_t *obs_sceneitem_get_scene(const obs_sceneitem_t *item)
+{
+	return item ? scene_of(stub(item)->scene) : nullptr;
+}
+int64_t obs_sceneitem_get_id(const obs_sceneitem_t *item)
+{
+	return item ? stub(item)->id : 0;
+}
+bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
+{
+	STUB_CALL();
+	if (!item)
+		return false;
+	stub(item)->visible = visible;
+	signal_item(stub(item), "item_visible");
+	return true;
+}
+bool obs_sceneitem_visible(const obs_sceneitem_t *item)
+{
+	STUB_CALL();
+	return item && stub(item)->visible;
+}
+bool obs_sceneitem_locked(const obs_sceneitem_t *item)
+{
+	return item && stub(item)->locked;
+}
+bool obs_sceneitem_is_group(obs_sceneitem_t *item)
+{
+	return item && stub(item)->source->id == "group";
+}
+void obs_sceneitem_group_enum_items(obs_sceneitem_t *group, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	STUB_CALL();
+	if (obs_sceneitem_is_group(group))
+		enum_items(stub(group)->source, callback, param);
+}
+void obs_sceneitem_get_pos(const obs_sceneitem_t *item, struct vec2 *pos)
+{
+	if (item)
+		*pos = stub(item)->pos;
+}
+void obs_sceneitem_get_scale(const obs_sceneitem_t *item, struct vec2 *scale)
+{
+	if (item)
+		*scale = stub(item)->scale;
+}
+void obs_sceneitem_set_scale(obs_sceneitem_t *item, const struct vec2 *scale)
+{
+	STUB_CALL();
+	if (!item)
+		return;
+	stub(item)->scale = *scale;
+	signal_item(stub(item), "item_transform");
+}
+float obs_sceneitem_get_rot(const obs_sceneitem_t *item)
+{
+	return item ? stub(item)->rot : 0.0f;
+}
+void obs_sceneitem_set_rot(obs_sceneitem_t *item, float rot_deg)
+{
+	STUB_CALL();
+	if (!item)
+		return;
+	stub(item)->rot = rot_deg;
+	signal_item(stub(item), "item_transform");
+}
+uint32_t obs_sceneitem_get_alignment(const obs_sceneitem_t *item)
+{
+	return item ? stub(item)->alignment : 0;
+}
+void obs_sceneitem_set_alignment(obs_sceneitem_t *item, uint32_t alignment)
+{
+	STUB_CALL();
+	if (item)
+		stub(item)->alignment = alignment;
+}
+enum obs_bounds_type obs_sceneitem_get_bounds_type(const obs_sceneitem_t *item)
+{
+	return item ? stub(item)->bounds_type : OBS_BOUNDS_NONE;
+}
+void obs_sceneitem_set_bounds_type(obs_sceneitem_t *item, enum obs_bounds_type type)
+{
+	STUB_CALL();
+	if (item)
+		stub(item)->bounds_type = type;
+}
+uint32_t obs_sceneitem_get_bounds_alignment(const obs_sceneitem_t *item)
+{
+	return item ? stub(item)->bounds_alignment : 0;
+}
+void obs_sceneitem_get_bounds(const obs_sceneitem_t *item, struct vec2 *bounds)
+{
+	if (item)
+		*bounds = stub(item)->bounds;
+}
+void obs_sceneitem_get_crop(const obs_sceneitem_t *item, struct obs_sceneitem_crop *crop)
+{
+	if (item)
+		*crop = stub(item)->crop;
+}
+
+/////////////////
+// TRANSITIONS //
+/////////////////
+obs_source_t *obs_transition_get_active_source(obs_source_t *)
+{
+	STUB_CALL();
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	return get_ref(current_scene);
+}
+obs_source_t *obs_transition_get_source(obs_source_t *, enum obs_transition_target target)
+{
+	STUB_CALL();
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	return get_ref(target == OBS_TRANSITION_SOURCE_A ? previous_scene : current_scene);
+}
+bool obs_transition_fixed(obs_source_t *transition)
+{
+	return transition && stub(transition)->fixed;
+}
+
+//////////////
+// FRONTEND //
+//////////////
+void obs_frontend_add_event_callback(obs_frontend_event_cb callback, void *private_data)
+{
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	frontend_callbacks.emplace_back(callback, private_data);
+}
+void obs_frontend_remove_event_callback(obs_frontend_event_cb callback, void *private_data)
+{
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	const auto it = std::find(frontend_callbacks.begin(), frontend_callbacks.end(), std::make_pair(callback, private_data));
+	if (it != frontend_callbacks.end())
+		frontend_callbacks.erase(it);
+}
+void *obs_frontend_get_main_window(void)
+{
+	return nullptr;
+}
+config_t *obs_frontend_get_profile_config(void)
+{
+	return profile_config;
+}
+void obs_frontend_get_scenes(struct obs_frontend_source_list *sources)
+{
+	STUB_CALL();
+	get_list(sources, OBS_SOURCE_TYPE_SCENE);
+}
+obs_source_t *obs_frontend_get_current_scene(void)
+{
+	STUB_CALL();
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	return get_ref(current_scene);
+}
+void obs_frontend_set_current_scene(obs_source_t *scene)
+{
+	STUB_CALL();
+	if (scene)
+		set_scene(stub(scene));
+}
+obs_source_t *obs_frontend_get_current_preview_scene(void)
+{
+	STUB_CALL();
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	return studio_mode ? get_ref(preview_scene) : nullptr;
+}
+void obs_frontend_set_current_preview_scene(obs_source_t *scene)
+{
+	STUB_CALL();
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		if (!studio_mode)
+			return;
+		preview_scene = stub(scene);
+	}
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED);
+}
+void obs_frontend_get_transitions(struct obs_frontend_source_list *sources)
+{
+	STUB_CALL();
+	get_list(sources, OBS_SOURCE_TYPE_TRANSITION);
+}
+obs_source_t *obs_frontend_get_current_transition(void)
+{
+	STUB_CALL();
+	std::lock_guard<std::recursive_mutex> lock(model_mutex);
+	return get_ref(current_transition);
+}
+void obs_frontend_set_current_transition(obs_source_t *transition)
+{
+	STUB_CALL();
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		current_transition = stub(transition);
+	}
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_TRANSITION_CHANGED);
+}
+int obs_frontend_get_transition_duration(void)
+{
+	return transition_duration;
+}
+void obs_frontend_set_transition_duration(int duration)
+{
+	STUB_CALL();
+	transition_duration = duration;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_TRANSITION_DURATION_CHANGED);
+}
+void obs_frontend_set_tbar_position(int)
+{
+	STUB_CALL();
+}
+void obs_frontend_release_tbar(void)
+{
+	STUB_CALL();
+}
+bool obs_frontend_preview_program_mode_active(void)
+{
+	return studio_mode;
+}
+void obs_frontend_set_preview_program_mode(bool enable)
+{
+	STUB_CALL();
+	if (studio_mode == enable)
+		return;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		studio_mode = enable;
+		preview_scene = enable ? current_scene : nullptr;
+	}
+	ObsStub::frontend_event(enable ? OBS_FRONTEND_EVENT_STUDIO_MODE_ENABLED : OBS_FRONTEND_EVENT_STUDIO_MODE_DISABLED);
+}
+void obs_frontend_preview_program_trigger_transition(void)
+{
+	STUB_CALL();
+	StubSource *scene;
+	{
+		std::lock_guard<std::recursive_mutex> lock(model_mutex);
+		if (!studio_mode || !preview_scene)
+			return;
+		scene = preview_scene;
+	}
+	set_scene(scene);
+}
+bool obs_frontend_preview_enabled(void)
+{
+	return preview_enabled;
+}
+void obs_frontend_set_preview_enabled(bool enable)
+{
+	STUB_CALL();
+	preview_enabled = enable;
+}
+void obs_frontend_streaming_start(void)
+{
+	STUB_CALL();
+	if (streaming)
+		return;
+	streaming = true;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_STREAMING_STARTING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_STREAMING_STARTED);
+}
+void obs_frontend_streaming_stop(void)
+{
+	STUB_CALL();
+	if (!streaming)
+		return;
+	streaming = false;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_STREAMING_STOPPING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_STREAMING_STOPPED);
+}
+bool obs_frontend_streaming_active(void)
+{
+	return streaming;
+}
+void obs_frontend_recording_start(void)
+{
+	STUB_CALL();
+	if (recording)
+		return;
+	recording = true;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_RECORDING_STARTING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_RECORDING_STARTED);
+}
+void obs_frontend_recording_stop(void)
+{
+	STUB_CALL();
+	if (!recording)
+		return;
+	recording = false;
+	recording_paused = false;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_RECORDING_STOPPING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_RECORDING_STOPPED);
+}
+bool obs_frontend_recording_active(void)
+{
+	return recording;
+}
+void obs_frontend_recording_pause(bool pause)
+{
+	STUB_CALL();
+	if (!recording || recording_paused == pause)
+		return;
+	recording_paused = pause;
+	ObsStub::frontend_event(pause ? OBS_FRONTEND_EVENT_RECORDING_PAUSED : OBS_FRONTEND_EVENT_RECORDING_UNPAUSED);
+}
+bool obs_frontend_recording_paused(void)
+{
+	return recording_paused;
+}
+void obs_frontend_replay_buffer_start(void)
+{
+	STUB_CALL();
+	if (replay_buffer)
+		return;
+	replay_buffer = true;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTED);
+}
+void obs_frontend_replay_buffer_stop(void)
+{
+	STUB_CALL();
+	if (!replay_buffer)
+		return;
+	replay_buffer = false;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPING);
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPED);
+}
+bool obs_frontend_replay_buffer_active(void)
+{
+	return replay_buffer;
+}
+// No outputs, the core treats them like outputs that never ran
+obs_output_t *obs_frontend_get_streaming_output(void)
+{
+	return nullptr;
+}
+obs_output_t *obs_frontend_get_recording_output(void)
+{
+	return nullptr;
+}
+obs_output_t *obs_frontend_get_replay_buffer_output(void)
+{
+	return nullptr;
+}
+char *obs_frontend_get_current_profile(void)
+{
+	return bstrdup(profile.c_str());
+}
+void obs_frontend_set_current_profile(const char *name)
+{
+	STUB_CALL();
+	profile = name;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_PROFILE_CHANGED);
+}
+char *obs_frontend_get_current_scene_collection(void)
+{
+	return bstrdup(scene_collection.c_str());
+}
+void obs_frontend_set_current_scene_collection(const char *collection)
+{
+	STUB_CALL();
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP);
+	scene_collection = collection;
+	ObsStub::frontend_event(OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED);
+}
+void obs_frontend_take_screenshot(void)
+{
+	STUB_CALL();
+}
+void obs_frontend_take_source_screenshot(obs_source_t *)
+{
+	STUB_CALL();
+}
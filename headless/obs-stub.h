@@ -0,0 +1,67 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <obs.h>
+#if __has_include(<obs-frontend-api.h>)
+#include <obs-frontend-api.h>
+#else
+#include <obs-frontend-api/obs-frontend-api.h>
+#endif
+
+/*
+ * Stub OBS
+ * Stands in for the parts of libobs and the frontend API the obs-midi core needs a running OBS for:
+ * sources, volumes and mutes, scenes and scene items, filters, transitions, outputs and frontend events.
+ * It is linked into headless executables together with the real libobs, whose obs_data, calldata,
+ * signal handler and platform functions are used as they are. The stub's definitions take precedence
+ * over libobs' own by ELF symbol interposition, so headless builds are for ELF platforms only (CMake
+ * refuses them elsewhere). The frontend API library is not linked at all.
+ * Sources raise the same signals with the same calldata as in OBS, so the core's Events see them as usual.
+ * Every stubbed call is counted and timed, the time includes the signal handlers and frontend callbacks it ran.
+ * Stub objects live until shutdown(), releasing the last reference only marks them destroyed.
+ */
+namespace ObsStub {
+struct CallStats {
+	uint64_t count = 0;
+	uint64_t total_ns = 0;
+	uint64_t max_ns = 0;
+};
+
+// config_dir receives what the core saves with obs_module_config_path
+void init(const std::string &config_dir);
+void shutdown();
+
+// The model, sources are announced with source_create like OBS does
+obs_source_t *add_input(const char *name, bool audio = true);
+obs_source_t *add_scene(const char *name);
+obs_sceneitem_t *add_scene_item(obs_source_t *scene, obs_source_t *source);
+obs_source_t *add_transition(const char *name, bool fixed = false);
+obs_source_t *add_filter(obs_source_t *source, const char *name);
+void remove_source(obs_source_t *source);
+
+// Calls the frontend event callbacks, on this thread
+void frontend_event(enum obs_frontend_event event);
+
+std::map<std::string, CallStats> get_call_stats();
+// Stubbed calls in the order they were made, the oldest are dropped past max_call_log
+static constexpr size_t max_call_log = 100000;
+std::vector<std::string> get_call_log();
+void clear_calls();
+} // namespace ObsStub
@@ -2,13 +2,15 @@
 #include "Midi_hook.h"
 
 MidiHook::MidiHook(){};
-MidiHook::MidiHook(const QString &json_string)
+MidiHook::MidiHook(obs_data_t *data)
 {
-	const auto data = obs_data_create_from_json(json_string.qtocs());
 	channel = obs_data_get_int(data, "channel");
-	message_type = obs_data_get_string(data, "message_type");
+	message_type = MidiMessage::string_to_message_type(obs_data_get_string(data, "message_type"));
 	norc = obs_data_get_int(data, "norc");
-	action = obs_data_get_string(data, "action");
+	action_string = obs_data_get_string(data, "action");
+	action = Utils::action_from_string(action_string, &action_migrated);
+	if (action_unresolved())
+		blog(LOG_WARNING, "Unknown action %s in mapping, it is kept but does nothing", action_string.qtocs());
 	scene = obs_data_get_string(data, "scene");
 	source = obs_data_get_string(data, "source");
 	filter = obs_data_get_string(data, "filter");
@@ -23,142 +25,189 @@ MidiHook::MidiHook(const QString &json_string)
 	string_override = obs_data_get_string(data, "string_override");
 	bool_override.emplace(obs_data_get_bool(data, "bool_override"));
 	int_override.emplace(obs_data_get_int(data, "int_override"));
-	int_override.emplace(obs_data_get_int(data, "range_min"));
-	int_override.emplace(obs_data_get_int(data, "range_max"));
+	if (obs_data_has_user_value(data, "range_min"))
+		range_min.emplace(obs_data_get_int(data, "range_min"));
+	if (obs_data_has_user_value(data, "range_max"))
+		range_max.emplace(obs_data_get_int(data, "range_max"));
 	value_as_filter = obs_data_get_bool(data, "value_as_filter");
 	value.emplace(obs_data_get_int(data, "value"));
 	set_obs_action();
-	obs_data_release(data);
+	obs_data_set_default_bool(data, "coalesce", actions && actions->is_continuous());
+	coalesce = obs_data_get_bool(data, "coalesce") && coalescing_allowed();
 }
-MidiMessage *MidiHook::get_message_from_hook()
+/*
+ * Same fields and defaults as the obs_data constructor, without parsing anything
+ */
+MidiHook::MidiHook(const MappingCache &cache, const MappingCache::Hook &record)
 {
-	auto *message = new MidiMessage();
-	message->channel = this->channel;
-	message->message_type = this->message_type;
-	message->NORC = this->norc;
-	message->value = *this->value;
-	return std::move(message);
+	channel = record.channel;
+	message_type = (MidiMessageType)record.message_type;
+	norc = record.norc;
+	action_string = cache.get_string(record.action);
+	action = Utils::action_from_string(action_string, &action_migrated);
+	if (action_unresolved())
+		blog(LOG_WARNING, "Unknown action %s in mapping, it is kept but does nothing", action_string.qtocs());
+	scene = cache.get_string(record.scene);
+	source = cache.get_string(record.source);
+	filter = cache.get_string(record.filter);
+	transition = cache.get_string(record.transition);
+	item = cache.get_string(record.item);
+	hotkey = cache.get_string(record.hotkey);
+	audio_source = cache.get_string(record.audio_source);
+	media_source = cache.get_string(record.media_source);
+	duration.emplace(record.duration);
+	scene_collection = cache.get_string(record.scene_collection);
+	profile = cache.get_string(record.profile);
+	string_override = cache.get_string(record.string_override);
+	bool_override.emplace(record.flags & MappingCache::BoolOverride);
+	int_override.emplace(record.int_override);
+	if (record.flags & MappingCache::HasRangeMin)
+		range_min.emplace(record.range_min);
+	if (record.flags & MappingCache::HasRangeMax)
+		range_max.emplace(record.range_max);
+	value_as_filter = record.flags & MappingCache::ValueAsFilter;
+	value.emplace(record.value);
+	set_obs_action();
+	coalesce = (record.flags & MappingCache::Coalesce) && coalescing_allowed();
+}
+MidiMessage MidiHook::get_message_from_hook() const
+{
+	MidiMessage message;
+	message.channel = this->channel;
+	message.message_type = this->message_type;
+	message.NORC = this->norc;
+	message.value = this->value.value_or(0);
+	return message;
 }
-void MidiHook::get_scene(obs_data_t *data)
+void MidiHook::get_scene(obs_data_t *data) const
 {
 	if (scene.isEmpty() || scene.isNull())
 		return;
 	obs_data_set_string(data, "scene", scene.qtocs());
 }
-void MidiHook::get_source(obs_data_t *data)
+void MidiHook::get_source(obs_data_t *data) const
 {
 	if (source.isEmpty())
 		return;
 	obs_data_set_string(data, "source", source.qtocs());
 }
-void MidiHook::get_filter(obs_data_t *data)
+void MidiHook::get_filter(obs_data_t *data) const
 {
 	if (filter.isEmpty())
 		return;
 	obs_data_set_string(data, "filter", filter.qtocs());
 }
-void MidiHook::get_transition(obs_data_t *data)
+void MidiHook::get_transition(obs_data_t *data) const
 {
 	if (transition.isEmpty())
 		return;
 	obs_data_set_string(data, "transition", transition.qtocs());
 }
-void MidiHook::get_item(obs_data_t *data)
+void MidiHook::get_item(obs_data_t *data) const
 {
 	if (item.isEmpty())
 		return;
 	obs_data_set_string(data, "item", item.qtocs());
 }
-void MidiHook::get_hotkey(obs_data_t *data)
+void MidiHook::get_hotkey(obs_data_t *data) const
 {
 	if (hotkey.isEmpty())
 		return;
 	obs_data_set_string(data, "hotkey", hotkey.qtocs());
 }
-void MidiHook::get_audio_source(obs_data_t *data)
+void MidiHook::get_audio_source(obs_data_t *data) const
 {
 	if (audio_source.isEmpty())
 		return;
 	obs_data_set_string(data, "audio_source", audio_source.qtocs());
 }
-void MidiHook::get_media_source(obs_data_t *data)
+void MidiHook::get_media_source(obs_data_t *data) const
 {
 	if (media_source.isEmpty())
 		return;
 	obs_data_set_string(data, "media_source", media_source.qtocs());
 }
-void MidiHook::get_duration(obs_data_t *data)
+void MidiHook::get_duration(obs_data_t *data) const
 {
 	if (duration)
 		obs_data_set_int(data, "duration", *duration);
 }
-void MidiHook::get_scene_collection(obs_data_t *data)
+void MidiHook::get_scene_collection(obs_data_t *data) const
 {
 	if (scene_collection.isEmpty())
 		return;
 	obs_data_set_string(data, "scene_collection", scene_collection.qtocs());
 }
-void MidiHook::get_profile(obs_data_t *data)
+void MidiHook::get_profile(obs_data_t *data) const
 {
 	if (profile.isEmpty())
 		return;
 	obs_data_set_string(data, "profile", profile.qtocs());
 }
-void MidiHook::get_string_override(obs_data_t *data)
+void MidiHook::get_string_override(obs_data_t *data) const
 {
 	if (string_override.isEmpty())
 		return;
 	obs_data_set_string(data, "string_override", string_override.qtocs());
 }
-void MidiHook::get_bool_override(obs_data_t *data)
+void MidiHook::get_bool_override(obs_data_t *data) const
 {
 	if (bool_override)
 		obs_data_set_bool(data, "bool_override", *bool_override);
 }
-void MidiHook::get_int_override(obs_data_t *data)
+void MidiHook::get_int_override(obs_data_t *data) const
 {
 	if (int_override)
 		obs_data_set_int(data, "int_override", *int_override);
 }
-void MidiHook::get_range_min(obs_data_t *data)
+void MidiHook::get_range_min(obs_data_t *data) const
 {
 	if (range_min)
 		obs_data_set_int(data, "range_min", *range_min);
 }
-void MidiHook::get_range_max(obs_data_t *data)
+void MidiHook::get_range_max(obs_data_t *data) const
 {
 	if (range_max)
 		obs_data_set_int(data, "range_max", *range_max);
 }
-void MidiHook::get_value(obs_data_t *data)
+void MidiHook::get_coalesce(obs_data_t *data) const
+{
+	obs_data_set_bool(data, "coalesce", coalesce);
+}
+void MidiHook::get_value(obs_data_t *data) const
 {
 	obs_data_set_bool(data, "value_as_filter", value_as_filter);
 	if (value_as_filter)
 		obs_data_set_int(data, "value", *value);
 }
-void MidiHook::get_channel(obs_data_t *data)
+void MidiHook::get_channel(obs_data_t *data) const
 {
 	obs_data_set_int(data, "channel", channel);
 }
 
-void MidiHook::get_message(obs_data_t *data)
+void MidiHook::get_message(obs_data_t *data) const
 {
-	obs_data_set_string(data, "message_type", message_type.qtocs());
+	obs_data_set_string(data, "message_type", MidiMessage::message_type_to_string(message_type).qtocs());
 }
 
-void MidiHook::get_norc(obs_data_t *data)
+void MidiHook::get_norc(obs_data_t *data) const
 {
 	obs_data_set_int(data, "norc", norc);
 }
 
-void MidiHook::get_action(obs_data_t *data)
+void MidiHook::get_action(obs_data_t *data) const
 {
-	obs_data_set_string(data, "action", action.qtocs());
+	if (action)
+		obs_data_set_string(data, "action", ActionsClass::action_to_string(*action).qtocs());
+	else if (!action_string.isEmpty())
+		obs_data_set_string(data, "action", action_string.qtocs());
 }
 
-QString MidiHook::GetData()
+/*
+ * Writes the hook into data, its entry in the config
+ */
+void MidiHook::GetData(obs_data_t *data) const
 {
-	obs_data_t *data = obs_data_create();
 	get_channel(data);
 	get_message(data);
 	get_norc(data);
@@ -180,18 +229,63 @@ QString MidiHook::GetData()
 	get_range_min(data);
 	get_range_max(data);
 	get_value(data);
-	QString hook_data(obs_data_get_json(data));
-	obs_data_release(data);
-	return hook_data;
+	get_coalesce(data);
 }
+/*
+ * Writes the hook as a mapping cache record
+ */
+void MidiHook::GetData(MappingCache::Builder &cache) const
+{
+	MappingCache::Hook record{};
+	record.channel = channel;
+	record.message_type = (int32_t)message_type;
+	record.norc = norc;
+	record.action = cache.intern(action ? ActionsClass::action_to_string(*action) : action_string);
+	record.scene = cache.intern(scene);
+	record.source = cache.intern(source);
+	record.filter = cache.intern(filter);
+	record.transition = cache.intern(transition);
+	record.item = cache.intern(item);
+	record.hotkey = cache.intern(hotkey);
+	record.audio_source = cache.intern(audio_source);
+	record.media_source = cache.intern(media_source);
+	record.scene_collection = cache.intern(scene_collection);
+	record.profile = cache.intern(profile);
+	record.string_override = cache.intern(string_override);
+	record.duration = duration.value_or(0);
+	record.int_override = int_override.value_or(0);
+	record.range_min = range_min.value_or(0);
+	record.range_max = range_max.value_or(0);
+	// Like the JSON, value only counts for value filters
+	record.value = value_as_filter ? value.value_or(0) : 0;
+	record.flags = (bool_override.value_or(false) ? MappingCache::BoolOverride : 0) | (range_min ? MappingCache::HasRangeMin : 0) |
+		       (range_max ? MappingCache::HasRangeMax : 0) | (value_as_filter ? MappingCache::ValueAsFilter : 0) |
+		       (coalesce ? MappingCache::Coalesce : 0);
+	cache.add_hook(record);
+}
+/*
+ * Builds this hook's own executor from the current hook fields.
+ * Call again after editing a hook, but only before it is handed to a MidiAgent.
+ */
 void MidiHook::set_obs_action()
 {
-	if (action.isEmpty() || action.isNull())
+	delete actions;
+	actions = nullptr;
+	if (!action)
 		return;
-	Actions AC(this);
-	actions = AC.make_action(action, this);
+	actions = Actions::make_action(*action, this);
+	if (actions)
+		actions->setParent(this);
 }
 void MidiHook::EXE()
 {
-	actions->execute();
+	if (actions)
+		actions->execute();
+}
+/*
+ * Buttons, notes and value filter hooks always get every message
+ */
+bool MidiHook::coalescing_allowed() const
+{
+	return !value_as_filter && message_type != MidiMessageType::Note_On && message_type != MidiMessageType::Note_Off;
 }
@@ -3,6 +3,7 @@
 #include <optional>
 #include "utils.h"
 #include "Midi_message.h"
+#include "mapping-cache.h"
 class Actions;
 /*
  * Midi Hook Class
@@ -11,15 +12,25 @@ class MidiHook : public QObject {
 	Q_OBJECT
 public:
 	MidiHook();
-	MidiHook(const QString &json_string);
-	MidiMessage *get_message_from_hook();
-	QString GetData();
+	// Reads a hook from its entry in the config, the tree is not kept
+	explicit MidiHook(obs_data_t *data);
+	// Reads a hook from its record in the mapping cache
+	MidiHook(const MappingCache &cache, const MappingCache::Hook &record);
+	MidiMessage get_message_from_hook() const;
+	void GetData(obs_data_t *data) const;
+	void GetData(MappingCache::Builder &cache) const;
 	void set_obs_action();
 	void EXE();
+	bool coalescing_allowed() const;
 	int channel = -1;     // midi channel
-	QString message_type; // Message Type
+	MidiMessageType message_type = MidiMessageType::None; // Message Type
 	int norc = -1;        // Note or Control
-	QString action;
+	std::optional<ActionsClass::Actions> action; // resolved once, translated only for display
+	bool action_migrated = false; // loaded from a translated label, written back as the enum name on save
+	// The action as loaded, written back unchanged while it does not resolve: a label in another
+	// UI language or an action of a newer obs-midi
+	QString action_string;
+	bool action_unresolved() const { return !action && !action_string.isEmpty(); }
 	QString scene;
 	QString source;
 	QString filter;
@@ -38,7 +49,8 @@ public:
 	std::optional<int> range_max;
 	bool value_as_filter = false;
 	std::optional<int> value;
-	Actions *actions;
+	bool coalesce = false; // only run the newest value when messages arrive faster than the action runs
+	Actions *actions = nullptr;
 
 private:
 	/// <summary>
@@ -47,26 +59,27 @@ private:
 	
 
 	//get Midi data from hook data
-	void get_channel(obs_data_t *data);
-	void get_message(obs_data_t *data);
-	void get_norc(obs_data_t *data);
-	void get_value(obs_data_t *data);
+	void get_channel(obs_data_t *data) const;
+	void get_message(obs_data_t *data) const;
+	void get_norc(obs_data_t *data) const;
+	void get_value(obs_data_t *data) const;
 	// get sction data from hook data
-	void get_action(obs_data_t *data);
-	void get_scene(obs_data_t *data);
-	void get_source(obs_data_t *data);
-	void get_filter(obs_data_t *data);
-	void get_transition(obs_data_t *data);
-	void get_item(obs_data_t *data);
-	void get_hotkey(obs_data_t *data);
-	void get_audio_source(obs_data_t *data);
-	void get_media_source(obs_data_t *data);
-	void get_duration(obs_data_t *data);
-	void get_scene_collection(obs_data_t *data);
-	void get_profile(obs_data_t *data);
-	void get_string_override(obs_data_t *data);
-	void get_bool_override(obs_data_t *data);
-	void get_int_override(obs_data_t *data);
-	void get_range_min(obs_data_t *data);
-	void get_range_max(obs_data_t *data);
+	void get_action(obs_data_t *data) const;
+	void get_scene(obs_data_t *data) const;
+	void get_source(obs_data_t *data) const;
+	void get_filter(obs_data_t *data) const;
+	void get_transition(obs_data_t *data) const;
+	void get_item(obs_data_t *data) const;
+	void get_hotkey(obs_data_t *data) const;
+	void get_audio_source(obs_data_t *data) const;
+	void get_media_source(obs_data_t *data) const;
+	void get_duration(obs_data_t *data) const;
+	void get_scene_collection(obs_data_t *data) const;
+	void get_profile(obs_data_t *data) const;
+	void get_string_override(obs_data_t *data) const;
+	void get_bool_override(obs_data_t *data) const;
+	void get_int_override(obs_data_t *data) const;
+	void get_range_min(obs_data_t *data) const;
+	void get_range_max(obs_data_t *data) const;
+	void get_coalesce(obs_data_t *data) const;
 };
@@ -1,29 +1,67 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <type_traits>
 #include <QObject>
 #include "utils.h"
 #include "libremidi/message.hpp"
+/*
+ * Channel message types handled by obs-midi.
+ * Values are the status nibble, so a status byte maps with (status >> 4).
+ */
+enum class MidiMessageType : uint8_t {
+	None = 0x0,
+	Note_Off = 0x8,
+	Note_On = 0x9,
+	Control_Change = 0xB,
+	Program_Change = 0xC,
+	Pitch_Bend = 0xE,
+};
+/*
+ * Layout of a channel message, indexed by status nibble.
+ * A byte index of -1 means the message does not carry that part.
+ */
+struct MidiMessageLayout {
+	MidiMessageType type;
+	int8_t norc_byte;
+	int8_t value_byte;
+};
+constexpr std::array<MidiMessageLayout, 16> midi_message_layouts{{
+	{MidiMessageType::None, -1, -1},           {MidiMessageType::None, -1, -1},
+	{MidiMessageType::None, -1, -1},           {MidiMessageType::None, -1, -1},
+	{MidiMessageType::None, -1, -1},           {MidiMessageType::None, -1, -1},
+	{MidiMessageType::None, -1, -1},           {MidiMessageType::None, -1, -1},
+	{MidiMessageType::Note_Off, 1, 2},         {MidiMessageType::Note_On, 1, 2},
+	{MidiMessageType::None, -1, -1},           {MidiMessageType::Control_Change, 1, 2},
+	{MidiMessageType::Program_Change, -1, 1}, {MidiMessageType::None, -1, -1},
+	{MidiMessageType::Pitch_Bend, 0, 2},       {MidiMessageType::None, -1, -1},
+}};
 /*Midi Message Structure*/
 typedef struct MidiMessage {
 public:
 	MidiMessage() = default;
-	void set_message(const libremidi::message &message)
+	void set_message(const libremidi::message &message) { set_message(message.bytes.data(), message.bytes.size()); }
+	void set_message(const unsigned char *bytes, size_t size)
 	{
-		this->channel = message.get_channel();
-		this->message_type = get_midi_message_type(message);
-		this->NORC = get_midi_note_or_control(message);
-		this->value = get_midi_value(message);
+		if (size == 0)
+			return;
+		const MidiMessageLayout &layout = midi_message_layouts[bytes[0] >> 4];
+		this->message_type = layout.type;
+		this->channel = (bytes[0] & 0x0F) + 1;
+		this->NORC = (layout.norc_byte >= 0 && (size_t)layout.norc_byte < size) ? bytes[layout.norc_byte] : 0;
+		this->value = (layout.value_byte >= 0 && (size_t)layout.value_byte < size) ? bytes[layout.value_byte] : 0;
 	}
-	QString device_name;
-	QString message_type = "none";
-	int channel = 0;
-	int NORC = 0;
-	int value = 0;
-	inline bool isNote() const { return (message_type == "Note On" || message_type == "Note Off"); };
-	MidiMessage get() const { return (MidiMessage) * this; }
-	static QString get_midi_message_type(const libremidi::message &message);
-	static QString mtype_to_string(libremidi::message_type);
-	static int get_midi_note_or_control(const libremidi::message &mess);
-	static int get_midi_value(const libremidi::message &mess);
+	MidiMessageType message_type = MidiMessageType::None;
+	uint8_t channel = 0;
+	uint8_t NORC = 0;
+	uint8_t value = 0;
+	uint16_t device_id = 0;
+	uint64_t received_ns = 0; // os_gettime_ns() in the MIDI input callback, 0 for messages that did not come from a device
+	inline bool isNote() const { return (message_type == MidiMessageType::Note_On || message_type == MidiMessageType::Note_Off); };
+	// Display and config strings, keep these out of the MIDI input path
+	static QString message_type_to_string(MidiMessageType type);
+	static MidiMessageType string_to_message_type(const QString &type);
 
 } MidiMessage;
+static_assert(std::is_trivially_copyable_v<MidiMessage>, "MidiMessage is copied across threads by value");
 Q_DECLARE_METATYPE(MidiMessage);
@@ -18,7 +18,14 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #include "config.h"
 
+#include <memory>
+
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
 #include "obs-module.h"
+#include "events.h"
+#include "mapping-cache.h"
 
 #define PARAM_DEVICES "MidiDevices"
 
@@ -28,35 +35,231 @@ using namespace std;
 
 Config::Config()
 {
+	loader.setMaxThreadCount(1);
+	save_timer.setSingleShot(true);
+	save_timer.setInterval(save_delay_ms);
+	connect(&save_timer, &QTimer::timeout, this, &Config::write_snapshot);
+	writer = std::thread(&Config::write_loop, this);
 	Load();
-	connect(GetDeviceManager().get(), SIGNAL(reload_config()), this, SLOT(Load()));
+	connect(GetEventsSystem().get(), &Events::obsEvent, this, &Config::handle_obs_event);
 }
 
-Config::~Config() {}
+/* Writes what is still queued, changes not snapshotted yet are lost: flush() before the devices go
+ */
+Config::~Config()
+{
+	loader.waitForDone();
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		running = false;
+	}
+	write_wake.notify_all();
+	writer.join();
+}
 
 /* Load the configuration from the OBS Config Store
  */
 void Config::Load()
 {
-	auto deviceManager = GetDeviceManager();
-	deviceManager->Load(GetConfigStore());
-	blog(LOG_DEBUG, "Config::Load");
+	// Anything switching was waiting for is replaced by this
+	switch_generation++;
+	const QString file_name = get_file_name();
+	apply_config(prepare_config(file_name, tables_file));
 }
 
-/* Save the configuration to the OBS Config Store
+/* Switches to the config of the new profile or scene collection.
+ * The current tables keep running, ports open, while the new ones are read on the loader thread,
+ * then each device swaps its hook table in one step.
+ */
+void Config::switch_config()
+{
+	const QString file_name = get_file_name();
+	// The current tables go to their own file before anything else
+	flush();
+	const uint64_t generation = ++switch_generation;
+	// Switched back before the other config was ready
+	if (file_name == tables_file)
+		return;
+	const QString previous_file = tables_file;
+	loader.start(new FunctionTask([this, file_name, previous_file, generation]() {
+		auto config = std::make_shared<DeviceManager::PreparedConfig>(prepare_config(file_name, previous_file));
+		QMetaObject::invokeMethod(
+			this,
+			[this, config, generation]() {
+				// A later switch or load won
+				if (generation != switch_generation)
+					return;
+				apply_config(*config);
+			},
+			Qt::QueuedConnection);
+	}));
+}
+
+/* Reads and parses a config, or maps its mapping cache if it matches. Runs on any thread.
+ * previous_file is the config the current tables came from, its checksum marks them for reuse.
+ */
+DeviceManager::PreparedConfig Config::prepare_config(const QString &file_name, const QString &previous_file)
+{
+	const uint64_t start = os_gettime_ns();
+	DeviceManager::PreparedConfig config;
+	config.file_name = file_name;
+	const QByteArray json = read_config_file(file_name);
+	config.json_checksum = MappingCache::checksum(json.constData(), (size_t)json.size());
+	auto cache = std::make_shared<MappingCache>();
+	const auto cache_path = obs_module_config_path(get_cache_file_name(file_name).toStdString().c_str());
+	const bool cached = cache->open(QString::fromUtf8(cache_path), json);
+	bfree(cache_path);
+	if (cached) {
+		config.cache = cache;
+		config.debug_mode = cache->get_debug_mode();
+	} else {
+		// A UTF-8 BOM is only skipped for parsing, the checksum covers the file as it is
+		const char *text = json.startsWith("\xEF\xBB\xBF") ? json.constData() + 3 : json.constData();
+		obs_data_t *data = obs_data_create_from_json(text);
+		if (!data)
+			data = obs_data_create();
+		config.debug_mode = obs_data_get_bool(data, "debug_mode");
+		config.data = data;
+		obs_data_release(data);
+	}
+	if (!previous_file.isEmpty() && previous_file != file_name) {
+		const QByteArray previous_json = read_config_file(previous_file);
+		config.previous_file = previous_file;
+		config.previous_checksum = MappingCache::checksum(previous_json.constData(), (size_t)previous_json.size());
+	}
+	blog(LOG_INFO, "Config %s read from %s in %.2f ms", file_name.qtocs(), cached ? "mapping cache" : "JSON", (os_gettime_ns() - start) / 1000000.0);
+	return config;
+}
+
+/* Loads a prepared config into the device manager, on the UI thread
+ */
+void Config::apply_config(DeviceManager::PreparedConfig config)
+{
+	// Changes made while it was being read belong to the config the tables came from
+	const bool edited = dirty;
+	flush();
+	// Its checksum was read before them, so the outgoing tables are not kept for reuse
+	if (edited)
+		config.previous_file.clear();
+	const uint64_t start = os_gettime_ns();
+	DebugMode = config.debug_mode;
+	tables_file = config.file_name;
+	const bool migrated = GetDeviceManager()->Load(config);
+	blog(LOG_INFO, "Config %s loaded in %.2f ms", config.file_name.qtocs(), (os_gettime_ns() - start) / 1000000.0);
+	if (migrated)
+		blog(LOG_INFO, "Migrating mappings saved with translated action names");
+	// The file stays as the user left it while it has actions this version cannot read
+	if (GetDeviceManager()->has_unresolved_actions()) {
+		blog(LOG_WARNING, "Config %s has unknown actions, it is not rewritten on load", config.file_name.qtocs());
+		return;
+	}
+	// Writes the mapping cache for the next start, with the JSON in the current format
+	if (!config.cache)
+		Save();
+}
+
+/* Save the configuration to the OBS Config Store, once nothing changed for save_delay_ms
  */
 void Config::Save()
 {
-	blog(LOG_DEBUG, "Config save");
+	if (QThread::currentThread() != thread()) {
+		QMetaObject::invokeMethod(this, "Save", Qt::QueuedConnection);
+		return;
+	}
+	// Changes go to the config the tables came from, which is not OBS' current one while switching
+	if (!dirty) {
+		dirty = true;
+		dirty_file = tables_file;
+	}
+	// Every change restarts the quiet period
+	save_timer.start();
+}
+
+/* Writes pending changes now and waits for the file to be written
+ */
+void Config::flush()
+{
+	write_snapshot();
+	std::unique_lock<std::mutex> lock(write_mutex);
+	write_wake.wait(lock, [this] { return !pending && !writing; });
+}
+
+/* Snapshots the device and hook tables on the UI thread and hands them to the writer thread
+ */
+void Config::write_snapshot()
+{
+	save_timer.stop();
 	auto deviceManager = GetDeviceManager();
-	obs_data_t *newmidi = obs_data_create_from_json(deviceManager->GetData().toStdString().c_str());
-	obs_data_set_bool(newmidi, "debug_mode", DebugMode);
-	const auto path = obs_module_config_path(get_file_name().toStdString().c_str());
-	obs_data_save_json_safe(newmidi, path, ".tmp", ".bkp");
+	if (!dirty || !deviceManager)
+		return;
+	dirty = false;
+	Snapshot snapshot;
+	const auto path = obs_module_config_path(dirty_file.toStdString().c_str());
+	snapshot.path = path;
 	bfree(path);
+	snapshot.data = deviceManager->GetData();
+	snapshot.debug_mode = DebugMode;
+	const auto cache_path = obs_module_config_path(get_cache_file_name(dirty_file).toStdString().c_str());
+	snapshot.cache_path = QString::fromUtf8(cache_path);
+	bfree(cache_path);
+	MappingCache::Builder cache;
+	deviceManager->GetData(cache);
+	snapshot.cache = cache.finish(DebugMode);
+	{
+		// A snapshot the writer has not picked up yet is older, this one replaces it
+		std::lock_guard<std::mutex> lock(write_mutex);
+		pending = std::move(snapshot);
+	}
+	write_wake.notify_all();
+}
 
-	obs_data_release(newmidi);
-	blog(LOG_DEBUG, "Config::Save");
+void Config::write_loop()
+{
+	std::unique_lock<std::mutex> lock(write_mutex);
+	while (true) {
+		write_wake.wait(lock, [this] { return pending || !running; });
+		if (!pending)
+			return;
+		const Snapshot snapshot = std::move(*pending);
+		pending.reset();
+		writing = true;
+		lock.unlock();
+		write_file(snapshot);
+		lock.lock();
+		writing = false;
+		write_wake.notify_all();
+	}
+}
+
+void Config::write_file(const Snapshot &snapshot)
+{
+	const uint64_t start = os_gettime_ns();
+	// The writer owns the snapshot tree now, nothing else refers to it
+	obs_data_set_bool(snapshot.data, "debug_mode", snapshot.debug_mode);
+	if (!obs_data_save_json_safe(snapshot.data, snapshot.path.constData(), ".tmp", ".bkp")) {
+		blog(LOG_WARNING, "Could not save %s", snapshot.path.constData());
+		return;
+	}
+	// The cache goes with the JSON exactly as it was written
+	QFile json_file(QString::fromUtf8(snapshot.path));
+	if (!json_file.open(QIODevice::ReadOnly) || !MappingCache::write(snapshot.cache, json_file.readAll(), snapshot.cache_path))
+		blog(LOG_WARNING, "Could not write mapping cache %s", snapshot.cache_path.qtocs());
+	blog(LOG_DEBUG, "Config::Save %s in %.1f ms", snapshot.path.constData(), (os_gettime_ns() - start) / 1000000.0);
+}
+
+void Config::handle_obs_event(const RpcEvent &event)
+{
+	switch (event.type()) {
+	case RpcEvent::Exiting:
+		flush();
+		break;
+	case RpcEvent::ProfileChanged:
+	case RpcEvent::SceneCollectionChanged:
+		switch_config();
+		break;
+	default:
+		break;
+	}
 }
 QString Config::get_file_name(std::optional<QString> prepend)
 {
@@ -71,21 +274,36 @@ QString Config::get_file_name(std::optional<QString> prepend)
 	bfree(current_sc);
 	return file;
 }
-QString Config::GetConfigStore(std::optional<QString> prepend)
+/* Mapping cache next to a config file
+ */
+QString Config::get_cache_file_name(const QString &file_name)
+{
+	QString cache_file = file_name;
+	if (cache_file.endsWith(".json"))
+		cache_file.chop(5);
+	return cache_file + ".cache";
+}
+/* Raw contents of the config file, created empty if there is none
+ */
+QByteArray Config::GetConfigStore(std::optional<QString> prepend)
+{
+	return read_config_file(get_file_name(prepend));
+}
+QByteArray Config::read_config_file(const QString &file_name)
 {
 	const auto path = obs_module_config_path(NULL);
 	os_mkdirs(path);
 	bfree(path);
 
-	const auto filepath = (prepend) ? obs_module_config_path(get_file_name(prepend).toStdString().c_str())
-					: obs_module_config_path(get_file_name().toStdString().c_str());
-	obs_data_t *midiConfig = os_file_exists(filepath) ? obs_data_create_from_json_file(filepath) : obs_data_create();
+	const auto filepath = obs_module_config_path(file_name.toStdString().c_str());
 	if (!os_file_exists(filepath)) {
+		obs_data_t *midiConfig = obs_data_create();
 		obs_data_save_json_safe(midiConfig, filepath, ".tmp", ".bkp");
+		obs_data_release(midiConfig);
 	}
-	DebugMode = obs_data_get_bool(midiConfig, "debug_mode");
+	QFile file(QString::fromUtf8(filepath));
 	bfree(filepath);
-	QString conf(obs_data_get_json(midiConfig));
-	obs_data_release(midiConfig);
-	return conf;
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	return file.readAll();
 }
@@ -17,22 +17,76 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
 #pragma once
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include "obs-data.h"
 #include <util/config-file.h>
 #include <util/util.hpp>
 #include <util/platform.h>
 #include <qobject.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 #include "device-manager.h"
 
+/*
+ * Saving only marks the config dirty. Once nothing changed for save_delay_ms the device
+ * and hook tables are snapshotted on the UI thread and written by a background thread,
+ * so a burst of edits (a rename touching many hooks, a scene collection being cleared)
+ * costs one write. flush() writes at once and waits, it runs on Exiting, before a
+ * profile or scene collection reload and on unload.
+ * Every write also refreshes the mapping cache next to the file, which Load() uses instead
+ * of parsing the JSON when it still matches it.
+ * A profile or scene collection change reads the new config on the loader thread while
+ * the current hook tables keep running, then the devices swap tables without closing ports.
+ */
 class Config : QObject {
 	Q_OBJECT
 public:
 	Config();
 	~Config() override;
 	QString get_file_name(std::optional<QString> prepend = std::nullopt);
-	QString GetConfigStore(std::optional<QString> prepend = std::nullopt);
+	static QString get_cache_file_name(const QString &file_name);
+	QByteArray GetConfigStore(std::optional<QString> prepend = std::nullopt);
+	static QByteArray read_config_file(const QString &file_name);
+	void flush();
 	bool DebugMode;
 public slots:
 	void Load();
 	void Save();
+private slots:
+	void write_snapshot();
+	void handle_obs_event(const RpcEvent &event);
+
+private:
+	static constexpr int save_delay_ms = 500;
+	struct Snapshot {
+		QByteArray path;
+		OBSData data;
+		bool debug_mode;
+		QString cache_path;
+		QByteArray cache;
+	};
+	void switch_config();
+	static DeviceManager::PreparedConfig prepare_config(const QString &file_name, const QString &previous_file);
+	void apply_config(DeviceManager::PreparedConfig config);
+	// Config the running hook tables came from
+	QString tables_file;
+	uint64_t switch_generation = 0;
+	QThreadPool loader;
+	void write_loop();
+	static void write_file(const Snapshot &snapshot);
+	QTimer save_timer;
+	bool dirty = false;
+	// Config the changed tables came from
+	QString dirty_file;
+	std::mutex write_mutex;
+	std::condition_variable write_wake;
+	std::optional<Snapshot> pending;
+	bool writing = false;
+	bool running = true;
+	std::thread writer;
 };
@@ -12,33 +12,273 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #include "device-manager.h"
-#include "forms/settings-dialog.h"
-DeviceManager::DeviceManager() {}
+
+#include <vector>
+
+#include <QtCore/QThread>
+#include <util/platform.h>
+
+#include "events.h"
+DeviceManager::DeviceManager()
+{
+	// Enumerating can take a while with many ports, the config is read and its hooks built meanwhile
+	auto enumerated = std::make_shared<std::promise<void>>();
+	initial_ports = enumerated->get_future().share();
+	QThreadPool::globalInstance()->start(new FunctionTask([this, enumerated]() {
+		const uint64_t start = os_gettime_ns();
+		refresh_ports();
+		blog(LOG_INFO, "Startup: enumerated MIDI ports in %.2f ms", (os_gettime_ns() - start) / 1000000.0);
+		enumerated->set_value();
+	}));
+	libremidi::observer::callbacks callbacks;
+	const auto changed = [this](int, const std::string &) { refresh_ports(); };
+	callbacks.input_added = changed;
+	callbacks.input_removed = changed;
+	callbacks.output_added = changed;
+	callbacks.output_removed = changed;
+	try {
+		port_observer = std::make_unique<libremidi::observer>(midi_api, std::move(callbacks));
+	} catch (const std::exception &error) {
+		blog(LOG_WARNING, "MIDI port changes will be polled for, no observer: %s", error.what());
+	}
+	device_watcher = std::make_unique<DeviceWatcher>(this);
+	connect(GetEventsSystem().get(), &Events::obsEvent, this, &DeviceManager::handle_obs_event);
+}
 DeviceManager::~DeviceManager()
 {
+	// No refresh may run once this starts going away
+	wait_for_ports();
+	port_observer.reset();
+	device_watcher.reset();
 	Unload();
 }
-/* Load the Device Manager from saved Config Store data.
- * This method is called from Config. Should only be called once on runtime
+/* Load the Device Manager from saved Config Store data, creating and starting its devices.
+ * Called through Load(PreparedConfig), after Unload, when a loaded or switched to config has other devices.
+ * Returns true if the loaded config needs to be written back in the current format
  */
-void DeviceManager::Load(QString datastring)
+bool DeviceManager::Load(obs_data_t *incoming_data)
 {
-	obs_data_t *incoming_data = obs_data_create_from_json(datastring.qtocs());
+	std::vector<OBSData> devices;
 	obs_data_array_t *data = obs_data_get_array(incoming_data, "MidiDevices");
 	const size_t deviceCount = obs_data_array_count(data);
 	for (size_t i = 0; i < deviceCount; i++) {
 		obs_data_t *madata = obs_data_array_item(data, i);
-		auto *device = new MidiAgent(obs_data_get_json(madata));
-		obs_data_release(madata);
+		auto *device = new MidiAgent();
+		device->load_settings(madata);
 		midiAgents.push_back(device);
+		devices.emplace_back(madata);
+		obs_data_release(madata);
 	}
 	obs_data_array_release(data);
-	obs_data_release(incoming_data);
+	const bool migrated = start_devices([&devices](MidiAgent *device, int i) { return device->load_hooks(devices[i]); });
 	blog(LOG_DEBUG, "DM::Load");
+	return migrated;
+}
+/*
+ * Loads a prepared config. With the same devices as now, each agent swaps its settings and
+ * hook table in place and keeps its ports open, otherwise the devices are loaded anew.
+ * Returns true if the config needs to be written back in the current format.
+ */
+bool DeviceManager::Load(const PreparedConfig &config)
+{
+	const QStringList names = device_names(config);
+	if (!has_same_devices(names)) {
+		Unload();
+		if (config.cache) {
+			Load(*config.cache);
+			return false;
+		}
+		return Load(config.data);
+	}
+	WarmTables warm;
+	for (int i = 0; i < warm_tables.size(); i++) {
+		if (warm_tables.at(i).file_name == config.file_name) {
+			warm = warm_tables.takeAt(i);
+			break;
+		}
+	}
+	if (warm.json_checksum != config.json_checksum)
+		release_warm_tables(warm);
+	const auto warm_hooks = [&warm](const QString &name) -> std::optional<QVector<MidiHook *>> {
+		if (!warm.hooks.contains(name))
+			return std::nullopt;
+		return warm.hooks.take(name);
+	};
+	WarmTables outgoing{config.previous_file, config.previous_checksum, {}};
+	bool migrated = false;
+	if (config.cache) {
+		for (uint32_t i = 0; i < config.cache->get_device_count(); i++) {
+			const MappingCache::Device &device = config.cache->get_device(i);
+			MidiAgent *agent = get_midi_device(config.cache->get_string(device.name));
+			outgoing.hooks.insert(agent->get_midi_input_name(), agent->swap_config(*config.cache, device, warm_hooks(agent->get_midi_input_name())));
+		}
+	} else {
+		obs_data_array_t *data = obs_data_get_array(config.data, "MidiDevices");
+		const size_t deviceCount = obs_data_array_count(data);
+		for (size_t i = 0; i < deviceCount; i++) {
+			obs_data_t *madata = obs_data_array_item(data, i);
+			MidiAgent *agent = get_midi_device(obs_data_get_string(madata, "name"));
+			const auto hooks = warm_hooks(agent->get_midi_input_name());
+			outgoing.hooks.insert(agent->get_midi_input_name(), agent->swap_config(madata, hooks));
+			migrated |= !hooks && agent->has_migrated_hooks();
+			obs_data_release(madata);
+		}
+		obs_data_array_release(data);
+	}
+	release_warm_tables(warm);
+	if (outgoing.file_name.isEmpty() || outgoing.file_name == config.file_name) {
+		release_warm_tables(outgoing);
+	} else {
+		warm_tables.prepend(std::move(outgoing));
+		while (warm_tables.size() > max_warm_tables) {
+			WarmTables oldest = warm_tables.takeLast();
+			release_warm_tables(oldest);
+		}
+	}
+	blog(LOG_DEBUG, "DM::Load swapped the hook tables of %d devices", names.size());
+	return migrated;
+}
+/*
+ * Input names of the devices in a prepared config
+ */
+QStringList DeviceManager::device_names(const PreparedConfig &config)
+{
+	QStringList names;
+	if (config.cache) {
+		for (uint32_t i = 0; i < config.cache->get_device_count(); i++)
+			names.append(config.cache->get_string(config.cache->get_device(i).name));
+		return names;
+	}
+	obs_data_array_t *data = obs_data_get_array(config.data, "MidiDevices");
+	const size_t deviceCount = obs_data_array_count(data);
+	for (size_t i = 0; i < deviceCount; i++) {
+		obs_data_t *madata = obs_data_array_item(data, i);
+		names.append(obs_data_get_string(madata, "name"));
+		obs_data_release(madata);
+	}
+	obs_data_array_release(data);
+	return names;
+}
+/*
+ * True if names are exactly the current devices, each once
+ */
+bool DeviceManager::has_same_devices(const QStringList &names) const
+{
+	if (names.size() != midiAgents.size())
+		return false;
+	QSet<QString> current;
+	for (auto midiAgent : midiAgents)
+		current.insert(midiAgent->get_midi_input_name());
+	QSet<QString> wanted;
+	for (const QString &name : names)
+		wanted.insert(name);
+	return wanted.size() == names.size() && wanted == current;
+}
+/*
+ * Deletes warm hooks, through their device's agent if it still exists since its dispatcher may have run them
+ */
+void DeviceManager::release_warm_tables(WarmTables &tables)
+{
+	for (auto it = tables.hooks.begin(); it != tables.hooks.end(); ++it) {
+		MidiAgent *agent = get_midi_device(it.key());
+		if (agent) {
+			agent->retire_midi_hooks(it.value());
+		} else {
+			qDeleteAll(it.value());
+		}
+	}
+	tables.hooks.clear();
+}
+/*
+ * Loads the devices straight from the records of a mapping cache that matches the config
+ */
+void DeviceManager::Load(const MappingCache &cache)
+{
+	for (uint32_t i = 0; i < cache.get_device_count(); i++) {
+		auto *device = new MidiAgent();
+		device->load_settings(cache, cache.get_device(i));
+		midiAgents.push_back(device);
+	}
+	start_devices([&cache](MidiAgent *device, int i) { return device->load_hooks(cache, cache.get_device((uint32_t)i)); });
+	blog(LOG_DEBUG, "DM::Load from mapping cache");
+}
+/*
+ * Stages of a full load after the devices' settings are parsed:
+ * builds each device's hooks on a pool thread of its own, resolves the ports once the first
+ * enumeration is done and sets the callbacks. Ports are opened right away if OBS has finished
+ * loading, at LoadingFinished otherwise.
+ * Returns true if hooks need to be written back in the current format.
+ */
+bool DeviceManager::start_devices(const std::function<QVector<MidiHook *>(MidiAgent *, int)> &load_hooks)
+{
+	uint64_t start = os_gettime_ns();
+	Actions::prepare_factories();
+	std::vector<QVector<MidiHook *>> hooks(midiAgents.size());
+	QThread *ui_thread = thread();
+	for (int i = 0; i < midiAgents.size(); i++) {
+		MidiAgent *device = midiAgents.at(i);
+		QVector<MidiHook *> &device_hooks = hooks[i];
+		startup_pool.start(new FunctionTask([&load_hooks, device, i, &device_hooks, ui_thread]() {
+			device_hooks = load_hooks(device, i);
+			// Hooks are run, edited and deleted from the UI thread
+			for (auto hook : device_hooks)
+				hook->moveToThread(ui_thread);
+		}));
+	}
+	startup_pool.waitForDone();
+	bool migrated = false;
+	int hook_count = 0;
+	for (int i = 0; i < midiAgents.size(); i++) {
+		hook_count += hooks[i].size();
+		midiAgents.at(i)->set_midi_hooks(hooks[i]);
+		migrated |= midiAgents.at(i)->has_migrated_hooks();
+	}
+	blog(LOG_INFO, "Startup: built %d hooks of %d devices in %.2f ms", hook_count, midiAgents.size(), (os_gettime_ns() - start) / 1000000.0);
+	start = os_gettime_ns();
+	wait_for_ports();
+	for (auto midiAgent : midiAgents)
+		midiAgent->resolve_ports();
+	blog(LOG_INFO, "Startup: resolved MIDI ports in %.2f ms", (os_gettime_ns() - start) / 1000000.0);
+	// Agents for absent devices still follow OBS, the device watcher opens their ports when they show up
+	for (auto midiAgent : midiAgents)
+		midiAgent->set_callbacks();
+	if (GetEventsSystem()->is_started())
+		open_ports();
+	return migrated;
+}
+/*
+ * Opens the ports every device wants and has, as one timed stage
+ */
+void DeviceManager::open_ports()
+{
+	const uint64_t start = os_gettime_ns();
+	for (auto midiAgent : midiAgents)
+		midiAgent->reconnect();
+	blog(LOG_INFO, "Startup: opened the ports of %d devices in %.2f ms", midiAgents.size(), (os_gettime_ns() - start) / 1000000.0);
+}
+/*
+ * The last startup stages, once OBS has finished loading: the ports are opened and then
+ * synced with the current OBS state
+ */
+void DeviceManager::handle_obs_event(const RpcEvent &event)
+{
+	if (event.type() != RpcEvent::LoadingFinished)
+		return;
+	open_ports();
+	const uint64_t start = os_gettime_ns();
+	for (auto midiAgent : midiAgents)
+		midiAgent->startup();
+	blog(LOG_INFO, "Startup: initial feedback sync of %d devices in %.2f ms", midiAgents.size(), (os_gettime_ns() - start) / 1000000.0);
 }
 void DeviceManager::Unload()
 {
 	blog(LOG_INFO, "UNLOADING DEVICE MANAGER");
+	// Hooks of agents about to go, no dispatcher will run them again
+	for (auto &tables : warm_tables) {
+		for (const auto &hooks : tables.hooks)
+			qDeleteAll(hooks);
+	}
+	warm_tables.clear();
 	for (auto &midiAgent : midiAgents) {
 		blog(LOG_DEBUG, "Unloading Midi Device %s", midiAgent->get_midi_input_name().qtocs());
 		midiAgent->clear_MidiHooks();
@@ -48,41 +288,76 @@ void DeviceManager::Unload()
 	blog(LOG_DEBUG, "DM::Unload");
 }
 /*
- * Returns QStringList of Port Names
+ * Enumerates the ports again and swaps the snapshot in, emits ports_changed if it differs.
+ * Called by the port observer on its own thread, or by the device watcher poller where there is none.
  */
-QStringList DeviceManager::get_input_ports_list()
+void DeviceManager::refresh_ports()
 {
-	QStringList ports;
-	const unsigned int portCount = libremidi::midi_in().get_port_count();
-	for (unsigned int i = 0; i < portCount; ++i) {
-		ports.append(QString::fromStdString(libremidi::midi_in().get_port_name(i)));
+	PortSnapshot snapshot;
+	{
+		std::lock_guard<std::mutex> lock(enumerate_mutex);
+		const unsigned int input_count = port_enumerator_in.get_port_count();
+		for (unsigned int i = 0; i < input_count; ++i)
+			snapshot.inputs.append(QString::fromStdString(port_enumerator_in.get_port_name(i)));
+		const unsigned int output_count = port_enumerator_out.get_port_count();
+		for (unsigned int i = 0; i < output_count; ++i)
+			snapshot.outputs.append(QString::fromStdString(port_enumerator_out.get_port_name(i)));
+	}
+	// Same answer as indexOf when two ports share a name: the first one
+	for (int i = snapshot.inputs.size() - 1; i >= 0; --i)
+		snapshot.input_ports.insert(snapshot.inputs.at(i), i);
+	for (int i = snapshot.outputs.size() - 1; i >= 0; --i)
+		snapshot.output_ports.insert(snapshot.outputs.at(i), i);
+	bool changed;
+	{
+		std::lock_guard<std::mutex> lock(ports_mutex);
+		changed = snapshot.inputs != ports.inputs || snapshot.outputs != ports.outputs;
+		ports = std::move(snapshot);
+	}
+	if (changed) {
+		blog(LOG_DEBUG, "MIDI ports changed");
+		emit ports_changed();
 	}
-	return ports;
+}
+/*
+ * Blocks until the first enumeration, started when the Device Manager was made, is done
+ */
+void DeviceManager::wait_for_ports() const
+{
+	if (initial_ports.valid())
+		initial_ports.wait();
+}
+/*
+ * False if the backend has no port observer, the snapshot then only changes on refresh_ports()
+ */
+bool DeviceManager::is_observing_ports() const
+{
+	return port_observer != nullptr;
+}
+/*
+ * Returns QStringList of Port Names
+ */
+QStringList DeviceManager::get_input_ports_list() const
+{
+	std::lock_guard<std::mutex> lock(ports_mutex);
+	return ports.inputs;
 }
 /*
  * Returns QStringList of Output  Port Names
  */
-QStringList DeviceManager::get_output_ports_list()
+QStringList DeviceManager::get_output_ports_list() const
 {
-	QStringList outports;
-	const unsigned int portCount = libremidi::midi_out().get_port_count();
-	for (unsigned int i = 0; i < portCount; ++i) {
-		outports.append(QString::fromStdString(libremidi::midi_out().get_port_name(i)));
-	}
-	return outports;
+	std::lock_guard<std::mutex> lock(ports_mutex);
+	return ports.outputs;
 }
 /*
  * Returns the port number of the specified device.
  * If the device isn't found (possibly due to being disconnected), returns -1
  */
-int DeviceManager::get_input_port_number(const QString &deviceName)
+int DeviceManager::get_input_port_number(const QString &deviceName) const
 {
-	const QStringList portsList = get_input_ports_list();
-	if (portsList.contains(deviceName)) {
-		return portsList.indexOf(deviceName);
-	} else {
-		return -1;
-	}
+	std::lock_guard<std::mutex> lock(ports_mutex);
+	return ports.input_ports.value(deviceName, -1);
 }
 /**
  *
@@ -95,14 +370,10 @@ int DeviceManager::get_input_port_number(const QString &deviceName)
  * @returns  Device Output Port
  * @rtype int
  */
-int DeviceManager::get_output_port_number(const QString &deviceName)
+int DeviceManager::get_output_port_number(const QString &deviceName) const
 {
-	const QStringList portsList = get_output_ports_list();
-	if (portsList.contains(deviceName)) {
-		return portsList.indexOf(deviceName);
-	} else {
-		return -1;
-	}
+	std::lock_guard<std::mutex> lock(ports_mutex);
+	return ports.output_ports.value(deviceName, -1);
 }
 QVector<MidiAgent *> DeviceManager::get_active_midi_devices() const
 {
@@ -119,6 +390,14 @@ MidiAgent *DeviceManager::get_midi_device(const QString &deviceName)
 	}
 	return returndevice;
 }
+MidiAgent *DeviceManager::get_midi_device_by_id(uint16_t device_id) const
+{
+	for (auto midiAgent : midiAgents) {
+		if (midiAgent->get_device_id() == device_id)
+			return midiAgent;
+	}
+	return nullptr;
+}
 QVector<MidiHook *> DeviceManager::get_midi_hooks(const QString &deviceName)
 {
 	if (deviceName != QString("No Devices Available")) {
@@ -143,28 +422,42 @@ MidiAgent *DeviceManager::register_midi_device(const int &port, std::optional<in
 }
 /* Get this Device Manager state as OBS Data. (includes devices and their midi hooks)
  * This is needed to Serialize the state in the config.
+ * The whole tree is built in one pass, it is only turned into JSON when the file is written.
  * https://obsproject.com/docs/reference-settings.html
  */
-QString DeviceManager::GetData()
+OBSData DeviceManager::GetData() const
 {
 	obs_data_t *return_data = obs_data_create();
 	obs_data_array_t *data = obs_data_array_create();
 	for (auto midiAgent : midiAgents) {
-		obs_data_t *adata = obs_data_create_from_json(midiAgent->GetData().qtocs());
+		obs_data_t *adata = obs_data_create();
+		midiAgent->GetData(adata);
 		obs_data_array_push_back(data, adata);
 		obs_data_release(adata);
 	}
 	obs_data_set_array(return_data, "MidiDevices", data);
-	QString rdata(obs_data_get_json(return_data));
 	obs_data_array_release(data);
+	const OBSData rdata = return_data;
 	obs_data_release(return_data);
 	return rdata;
 }
-/**
- * Reload configuration -- for use with switching scene collecitons or profiles
+/* The same state as mapping cache records
+ */
+void DeviceManager::GetData(MappingCache::Builder &cache) const
+{
+	for (auto midiAgent : midiAgents)
+		midiAgent->GetData(cache);
+}
+/*
+ * True if a hook holds an action this version does not know, saving then only keeps it as it was
  */
-void DeviceManager::reload()
+bool DeviceManager::has_unresolved_actions() const
 {
-	this->Unload();
-	emit reload_config();
+	for (auto midiAgent : midiAgents) {
+		for (auto hook : midiAgent->GetMidiHooks()) {
+			if (hook->action_unresolved())
+				return true;
+		}
+	}
+	return false;
 }
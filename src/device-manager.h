@@ -18,6 +18,10 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #pragma once
 
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -25,6 +29,10 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
 #include <QtCore/QVariantHash>
 #include <QtCore/QThreadPool>
 
@@ -38,6 +46,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "rpc/RpcEvent.h"
 #include "midi-agent.h"
 #include "obs-controller.h"
+#include "device-watcher.h"
 
 class DeviceManager : public QObject {
 	Q_OBJECT
@@ -45,25 +54,81 @@ public:
 	DeviceManager();
 	~DeviceManager() override;
 
-	void Load(QString datastring);
+	/*
+	 * A profile and scene collection config, read and parsed off the UI thread
+	 */
+	struct PreparedConfig {
+		QString file_name;
+		uint64_t json_checksum = 0;
+		std::shared_ptr<MappingCache> cache; // its records, when the cache matched the JSON
+		OBSData data;                        // the parsed JSON otherwise
+		bool debug_mode = false;
+		// Config the current tables came from, as saved when switching away from it
+		QString previous_file;
+		uint64_t previous_checksum = 0;
+	};
+	bool Load(const PreparedConfig &config);
+	bool Load(obs_data_t *data);
+	void Load(const MappingCache &cache);
 	void Unload();
 
-	QStringList get_input_ports_list();
-	int get_input_port_number(const QString &deviceName);
-	QStringList get_output_ports_list();
-	int get_output_port_number(const QString &deviceName);
+	// Port lookups read a snapshot that is only refreshed when the backend reports a change
+	QStringList get_input_ports_list() const;
+	int get_input_port_number(const QString &deviceName) const;
+	QStringList get_output_ports_list() const;
+	int get_output_port_number(const QString &deviceName) const;
+	void refresh_ports();
+	bool is_observing_ports() const;
+	void wait_for_ports() const;
 
 	QVector<MidiAgent *> get_active_midi_devices() const;
 	MidiAgent *get_midi_device(const QString &deviceName);
+	MidiAgent *get_midi_device_by_id(uint16_t device_id) const;
 	QVector<MidiHook *> get_midi_hooks(const QString &deviceName);
 	MidiAgent *register_midi_device(const int &port, std::optional<int> outport = std::nullopt);
 
-	QString GetData();
-	void reload();
+	bool has_unresolved_actions() const;
+	OBSData GetData() const;
+	void GetData(MappingCache::Builder &cache) const;
+public slots:
+	void handle_obs_event(const RpcEvent &event);
 signals:
-	void reload_config();
 	void obsEvent(const RpcEvent &event);
+	// Emitted from the backend (or poller) thread when the snapshot changed
+	void ports_changed();
 
 private:
 	QVector<MidiAgent *> midiAgents;
+	struct PortSnapshot {
+		QStringList inputs;
+		QStringList outputs;
+		QHash<QString, int> input_ports;
+		QHash<QString, int> output_ports;
+	};
+	mutable std::mutex ports_mutex;
+	PortSnapshot ports;
+	// One backend client for enumeration, reused for every refresh
+	std::mutex enumerate_mutex;
+	libremidi::midi_in port_enumerator_in{midi_api};
+	libremidi::midi_out port_enumerator_out{midi_api};
+	std::unique_ptr<libremidi::observer> port_observer;
+	// First enumeration, it runs on a pool thread while the config is read
+	std::shared_future<void> initial_ports;
+	// Made last, it checks is_observing_ports() when it starts
+	std::unique_ptr<DeviceWatcher> device_watcher;
+	// Hook tables of recently left configs, by device name, reused when switching back to one unchanged
+	struct WarmTables {
+		QString file_name;
+		uint64_t json_checksum = 0;
+		QHash<QString, QVector<MidiHook *>> hooks;
+	};
+	static constexpr int max_warm_tables = 3;
+	QList<WarmTables> warm_tables;
+	// Startup stages of a full load, each one is timed in the log
+	QThreadPool startup_pool;
+	bool start_devices(const std::function<QVector<MidiHook *>(MidiAgent *, int)> &load_hooks);
+	void open_ports();
+	static QStringList device_names(const PreparedConfig &config);
+	bool has_same_devices(const QStringList &names) const;
+	void release_warm_tables(WarmTables &tables);
 };
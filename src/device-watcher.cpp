@@ -0,0 +1,101 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "device-watcher.h"
+
+#include <algorithm>
+
+#include <QtCore/QTimer>
+
+#include "device-manager.h"
+
+DeviceWatcher::DeviceWatcher(DeviceManager *device_manager) : manager(device_manager)
+{
+	connect(manager, &DeviceManager::ports_changed, this, &DeviceWatcher::check_devices, Qt::QueuedConnection);
+	if (!manager->is_observing_ports()) {
+		polling = true;
+		poller = std::thread(&DeviceWatcher::poll_loop, this);
+	}
+}
+DeviceWatcher::~DeviceWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(poll_mutex);
+		polling = false;
+	}
+	poll_wake.notify_one();
+	if (poller.joinable())
+		poller.join();
+}
+/*
+ * Runs after every port change: closes what went away and reopens what came back
+ */
+void DeviceWatcher::check_devices()
+{
+	for (auto agent : manager->get_active_midi_devices()) {
+		// Ports of agents still loading are opened at LoadingFinished
+		if (!agent->update_ports() || agent->is_loading() || attempts.contains(agent->get_device_id()))
+			continue;
+		if (agent->reconnect()) {
+			blog(LOG_INFO, "MIDI device reconnected: %s", agent->get_midi_input_name().qtocs());
+			continue;
+		}
+		attempts.insert(agent->get_device_id(), 1);
+		schedule_retry(agent->get_device_id());
+	}
+}
+void DeviceWatcher::schedule_retry(uint16_t device_id)
+{
+	const int attempt = attempts.value(device_id, 1);
+	const int delay = std::min(first_retry_ms << std::min(attempt - 1, 16), max_retry_ms);
+	QTimer::singleShot(delay, this, [this, device_id]() { retry(device_id); });
+}
+/*
+ * Looked up by id, the agent may have been unloaded by a reload while the retry was waiting
+ */
+void DeviceWatcher::retry(uint16_t device_id)
+{
+	if (!attempts.contains(device_id))
+		return;
+	MidiAgent *agent = manager->get_midi_device_by_id(device_id);
+	if (!agent || !agent->update_ports()) {
+		attempts.remove(device_id);
+		return;
+	}
+	if (agent->reconnect()) {
+		blog(LOG_INFO, "MIDI device reconnected: %s", agent->get_midi_input_name().qtocs());
+		attempts.remove(device_id);
+		return;
+	}
+	const int attempt = attempts.value(device_id) + 1;
+	if (attempt > max_attempts) {
+		// The next port change starts over
+		blog(LOG_WARNING, "Giving up reconnecting MIDI device %s after %d attempts", agent->get_midi_input_name().qtocs(), max_attempts);
+		attempts.remove(device_id);
+		return;
+	}
+	attempts.insert(device_id, attempt);
+	schedule_retry(device_id);
+}
+/*
+ * Fallback for backends without a port observer, refresh_ports() emits ports_changed as needed
+ */
+void DeviceWatcher::poll_loop()
+{
+	std::unique_lock<std::mutex> lock(poll_mutex);
+	while (!poll_wake.wait_for(lock, poll_interval, [this] { return !polling; })) {
+		lock.unlock();
+		manager->refresh_ports();
+		lock.lock();
+	}
+}
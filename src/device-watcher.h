@@ -0,0 +1,58 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+
+class DeviceManager;
+
+/*
+ * Device Watcher
+ * Reconnects MIDI devices that are unplugged and plugged back in while OBS runs.
+ * On every port change the agents look their devices up again, ports of devices that went
+ * away are closed (feedback for them is held back), and devices that are back are reopened,
+ * retrying with a growing delay for drivers that list a port before it can be opened.
+ * Lives on the UI thread. Without a port observer the ports are enumerated on a thread of
+ * its own every few seconds, so the UI never waits on the driver.
+ */
+class DeviceWatcher : public QObject {
+	Q_OBJECT
+public:
+	explicit DeviceWatcher(DeviceManager *manager);
+	~DeviceWatcher() override;
+public slots:
+	void check_devices();
+
+private:
+	static constexpr int first_retry_ms = 250;
+	static constexpr int max_retry_ms = 8000;
+	static constexpr int max_attempts = 8;
+	static constexpr std::chrono::seconds poll_interval{2};
+	void schedule_retry(uint16_t device_id);
+	void retry(uint16_t device_id);
+	void poll_loop();
+	DeviceManager *manager;
+	// Devices waiting for a reconnect, by device id, with the attempts made so far
+	QHash<uint16_t, int> attempts;
+	std::thread poller;
+	std::mutex poll_mutex;
+	std::condition_variable poll_wake;
+	bool polling = false;
+};
@@ -27,25 +27,20 @@
 #include "obs-midi.h"
 #include "config.h"
 #include "utils.h"
-#include "forms/settings-dialog.h"
 #include "macro-helpers.h"
 #define STATUS_INTERVAL 2000
 
-const char *sourceTypeToString(obs_source_type type)
-{
-	switch (type) {
-	case OBS_SOURCE_TYPE_INPUT:
-		return "input";
-	case OBS_SOURCE_TYPE_SCENE:
-		return "scene";
-	case OBS_SOURCE_TYPE_TRANSITION:
-		return "transition";
-	case OBS_SOURCE_TYPE_FILTER:
-		return "filter";
-	default:
-		return "unknown";
-	}
-}
+static_assert(RpcEvent::BroadcastCustomMessage < 64, "RpcEvent::Type no longer fits the active event mask");
+// Events whose only producer is a per source signal, changing one of them means reconnecting
+static const uint64_t source_signal_events = (uint64_t(1) << RpcEvent::SourceVolumeChanged) | (uint64_t(1) << RpcEvent::SourceMuteStateChanged) |
+					     (uint64_t(1) << RpcEvent::SourceAudioSyncOffsetChanged) | (uint64_t(1) << RpcEvent::SourceAudioMixersChanged) |
+					     (uint64_t(1) << RpcEvent::SourceFiltersReordered) | (uint64_t(1) << RpcEvent::SourceFilterVisibilityChanged) |
+					     (uint64_t(1) << RpcEvent::SourceOrderChanged) | (uint64_t(1) << RpcEvent::SceneItemAdded) |
+					     (uint64_t(1) << RpcEvent::SceneItemRemoved) | (uint64_t(1) << RpcEvent::SceneItemVisibilityChanged) |
+					     (uint64_t(1) << RpcEvent::SceneItemLockChanged) | (uint64_t(1) << RpcEvent::SceneItemTransformChanged) |
+					     (uint64_t(1) << RpcEvent::SceneItemSelected) | (uint64_t(1) << RpcEvent::SceneItemDeselected) |
+					     (uint64_t(1) << RpcEvent::TransitionBegin) | (uint64_t(1) << RpcEvent::TransitionVideoEnd);
+
 template<typename T> T *calldata_get_pointer(const calldata_t *data, const char *name)
 {
 	void *ptr = nullptr;
@@ -58,32 +53,26 @@ const char *calldata_get_string(const calldata_t *data, const char *name)
 	calldata_get_string(data, name, &value);
 	return value;
 }
-Events::Events() : _streamStarttime(0), _lastBytesSent(0), _lastBytesSentTime(0), HeartbeatIsActive(false), pulse(false)
+Events::Events()
+	: _streamStarttime(0), _lastBytesSent(0), _lastBytesSentTime(0), HeartbeatIsActive(false), pulse(false), active_events(required_events())
 {
 	obs_frontend_add_event_callback(Events::FrontendEventHandler, this);
-	this->setParent(plugin_window);
 }
 Events::~Events() {}
 void Events::startup()
 {
-
+	signals_connected = true;
 	// Connect to signals of all existing sources
-	obs_enum_sources(
-		[](void *param, obs_source_t *source) {
-			auto self = reinterpret_cast<Events *>(param);
-			self->connectSourceSignals(source);
-			return true;
-		},
-		this);
+	connect_all_source_signals();
 	signal_handler_t *coreSignalHandler = obs_get_signal_handler();
 	if (coreSignalHandler) {
 		signal_handler_connect(coreSignalHandler, "source_create", OnSourceCreate, this);
 		signal_handler_connect(coreSignalHandler, "source_destroy", OnSourceDestroy, this);
 	}
-	hookTransitionPlaybackEvents();
 }
 void Events::shutdown()
 {
+	signals_connected = false;
 	signal_handler_t *coreSignalHandler = obs_get_signal_handler();
 	if (coreSignalHandler) {
 		signal_handler_disconnect(coreSignalHandler, "source_destroy", OnSourceDestroy, this);
@@ -139,8 +128,10 @@ void Events::FrontendEventHandler(enum obs_frontend_event event, void *private_d
 		owner->OnStreamStarting();
 		break;
 	case OBS_FRONTEND_EVENT_STREAMING_STARTED:
-		owner->streamStatusTimer.start(STATUS_INTERVAL);
-		owner->StreamStatus();
+		if (owner->wants(RpcEvent::StreamStatus)) {
+			owner->streamStatusTimer.start(STATUS_INTERVAL);
+			owner->StreamStatus();
+		}
 		owner->OnStreamStarted();
 		break;
 	case OBS_FRONTEND_EVENT_STREAMING_STOPPING:
@@ -207,29 +198,21 @@ void Events::FrontendEventHandler(enum obs_frontend_event event, void *private_d
 		break;
 	}
 }
-QString Events::event_to_string(const event_type &enumval)
-{
-	return QVariant::fromValue(enumval).toString();
-}
-Events::event_type Events::string_to_event(const QString &action)
+/*
+ * Emits an event that keeps its obs_data fields, the event holds a reference
+ * so the caller can release its own right after
+ */
+void Events::broadcastUpdate(RpcEvent::Type type, obs_data_t *additionalFields)
 {
-	return QVariant(action).value<event_type>();
+	if (!wants(type))
+		return;
+	emit this->obsEvent(RpcEvent(type, additionalFields));
 }
-void Events::broadcastUpdate(const char *updateType, obs_data_t *additionalFields = nullptr)
+void Events::broadcastUpdate(RpcEvent::Type type, RpcEvent::Payload payload)
 {
-	std::optional<uint64_t> streamTime;
-	if (obs_frontend_streaming_active()) {
-		streamTime = std::make_optional(getStreamingTime());
-	}
-	std::optional<uint64_t> recordingTime;
-	if (obs_frontend_recording_active()) {
-		recordingTime = std::make_optional(getRecordingTime());
-	}
-	{
-		auto *event = new RpcEvent(QString(updateType), streamTime, recordingTime, additionalFields);
-		emit this->obsEvent((RpcEvent)*event);
-		delete (event);
-	}
+	if (!wants(type))
+		return;
+	emit this->obsEvent(RpcEvent(type, std::move(payload)));
 }
 void Events::connectSourceSignals(obs_source_t *source)
 {
@@ -240,24 +223,50 @@ void Events::connectSourceSignals(obs_source_t *source)
 	disconnectSourceSignals(source);
 	const obs_source_type sourceType = obs_source_get_type(source);
 	signal_handler_t *sh = obs_source_get_signal_handler(source);
+	// The plugin always follows these, they keep hooks and caches in step with the sources
 	signal_handler_connect(sh, "remove", OnSourceRemoved, this);
 	signal_handler_connect(sh, "rename", OnSourceRename, this);
-	signal_handler_connect(sh, "mute", OnSourceMuteStateChange, this);
-	signal_handler_connect(sh, "volume", OnSourceVolumeChange, this);
-	signal_handler_connect(sh, "audio_sync", OnSourceAudioSyncOffsetChanged, this);
-	signal_handler_connect(sh, "audio_mixers", OnSourceAudioMixersChanged, this);
 	signal_handler_connect(sh, "filter_add", OnSourceFilterAdded, this);
 	signal_handler_connect(sh, "filter_remove", OnSourceFilterRemoved, this);
-	signal_handler_connect(sh, "reorder_filters", OnSourceFilterOrderChanged, this);
+	// The rest only when something reacts to them, see update_subscriptions()
+	if (wants(RpcEvent::SourceMuteStateChanged))
+		signal_handler_connect(sh, "mute", OnSourceMuteStateChange, this);
+	if (wants(RpcEvent::SourceVolumeChanged))
+		signal_handler_connect(sh, "volume", OnSourceVolumeChange, this);
+	if (wants(RpcEvent::SourceAudioSyncOffsetChanged))
+		signal_handler_connect(sh, "audio_sync", OnSourceAudioSyncOffsetChanged, this);
+	if (wants(RpcEvent::SourceAudioMixersChanged))
+		signal_handler_connect(sh, "audio_mixers", OnSourceAudioMixersChanged, this);
+	if (wants(RpcEvent::SourceFiltersReordered))
+		signal_handler_connect(sh, "reorder_filters", OnSourceFilterOrderChanged, this);
+	obs_source_enum_filters(
+		source,
+		[](obs_source_t *parent, obs_source_t *filter, void *param) {
+			auto self = reinterpret_cast<Events *>(param);
+			if (self->wants(RpcEvent::SourceFilterVisibilityChanged))
+				self->connectFilterSignals(filter);
+			else
+				self->disconnectFilterSignals(filter);
+			UNUSED_PARAMETER(parent);
+		},
+		this);
 	if (sourceType == OBS_SOURCE_TYPE_SCENE) {
-		signal_handler_connect(sh, "reorder", OnSceneReordered, this);
-		signal_handler_connect(sh, "item_add", OnSceneItemAdd, this);
-		signal_handler_connect(sh, "item_remove", OnSceneItemDelete, this);
-		signal_handler_connect(sh, "item_visible", OnSceneItemVisibilityChanged, this);
-		signal_handler_connect(sh, "item_locked", OnSceneItemLockChanged, this);
-		signal_handler_connect(sh, "item_transform", OnSceneItemTransform, this);
-		signal_handler_connect(sh, "item_select", OnSceneItemSelected, this);
-		signal_handler_connect(sh, "item_deselect", OnSceneItemDeselected, this);
+		if (wants(RpcEvent::SourceOrderChanged))
+			signal_handler_connect(sh, "reorder", OnSceneReordered, this);
+		if (wants(RpcEvent::SceneItemAdded))
+			signal_handler_connect(sh, "item_add", OnSceneItemAdd, this);
+		if (wants(RpcEvent::SceneItemRemoved))
+			signal_handler_connect(sh, "item_remove", OnSceneItemDelete, this);
+		if (wants(RpcEvent::SceneItemVisibilityChanged))
+			signal_handler_connect(sh, "item_visible", OnSceneItemVisibilityChanged, this);
+		if (wants(RpcEvent::SceneItemLockChanged))
+			signal_handler_connect(sh, "item_locked", OnSceneItemLockChanged, this);
+		if (wants(RpcEvent::SceneItemTransformChanged))
+			signal_handler_connect(sh, "item_transform", OnSceneItemTransform, this);
+		if (wants(RpcEvent::SceneItemSelected))
+			signal_handler_connect(sh, "item_select", OnSceneItemSelected, this);
+		if (wants(RpcEvent::SceneItemDeselected))
+			signal_handler_connect(sh, "item_deselect", OnSceneItemDeselected, this);
 	}
 }
 void Events::disconnectSourceSignals(obs_source_t *source)
@@ -293,6 +302,7 @@ void Events::connectFilterSignals(obs_source_t *filter)
 		return;
 	}
 	signal_handler_t *sh = obs_source_get_signal_handler(filter);
+	signal_handler_disconnect(sh, "enable", OnSourceFilterVisibilityChanged, this);
 	signal_handler_connect(sh, "enable", OnSourceFilterVisibilityChanged, this);
 }
 void Events::disconnectFilterSignals(obs_source_t *filter)
@@ -311,11 +321,14 @@ void Events::hookTransitionPlaybackEvents()
 		obs_source_t *transition = transitions.sources.array[i];
 		signal_handler_t *sh = obs_source_get_signal_handler(transition);
 		signal_handler_disconnect(sh, "transition_start", OnTransitionBegin, this);
-		signal_handler_connect(sh, "transition_start", OnTransitionBegin, this);
+		if (wants(RpcEvent::TransitionBegin))
+			signal_handler_connect(sh, "transition_start", OnTransitionBegin, this);
+		// Always connected, the end of a transition restores the one an action switched from
 		signal_handler_disconnect(sh, "transition_stop", OnTransitionEnd, this);
 		signal_handler_connect(sh, "transition_stop", OnTransitionEnd, this);
 		signal_handler_disconnect(sh, "transition_video_stop", OnTransitionVideoEnd, this);
-		signal_handler_connect(sh, "transition_video_stop", OnTransitionVideoEnd, this);
+		if (wants(RpcEvent::TransitionVideoEnd))
+			signal_handler_connect(sh, "transition_video_stop", OnTransitionVideoEnd, this);
 	}
 	obs_frontend_source_list_free(&transitions);
 }
@@ -332,6 +345,82 @@ void Events::unhookTransitionPlaybackEvents()
 	}
 	obs_frontend_source_list_free(&transitions);
 }
+/*
+ * Events the plugin needs whatever the hooks are: the agents follow loading, exit,
+ * reloads and source removal/renames, the source cache follows the source lifecycle.
+ */
+uint64_t Events::required_events()
+{
+	uint64_t events = 0;
+	for (auto type : {RpcEvent::LoadingFinished, RpcEvent::Exiting, RpcEvent::ProfileChanged, RpcEvent::SceneCollectionChanged, RpcEvent::SourceCreated,
+			  RpcEvent::SourceDestroyed, RpcEvent::SourceRemoved, RpcEvent::SourceRenamed, RpcEvent::SourceFilterAdded, RpcEvent::SourceFilterRemoved,
+			  RpcEvent::TransitionListChanged})
+		events |= event_bit(type);
+	return events;
+}
+/*
+ * Asks for the active events to be recomputed on the UI thread,
+ * any number of calls before it runs end up in a single update
+ */
+void Events::request_subscription_update()
+{
+	if (subscription_update_pending.exchange(true))
+		return;
+	QMetaObject::invokeMethod(
+		this, [this]() { update_subscriptions(); }, Qt::QueuedConnection);
+}
+/*
+ * Recomputes the active events from the feedback bindings of every device, and
+ * reconnects the source signals if one they produce was turned on or off.
+ * In debug mode every event is active so that all of them get logged.
+ */
+void Events::update_subscriptions()
+{
+	subscription_update_pending = false;
+	uint64_t events = required_events();
+	const auto config = GetConfig();
+	const auto device_manager = GetDeviceManager();
+	if (config && config->DebugMode) {
+		events = ~uint64_t(0);
+	} else if (device_manager) {
+		for (auto device : device_manager->get_active_midi_devices())
+			for (auto type : device->get_feedback_events())
+				events |= event_bit(type);
+	}
+	const uint64_t previous = active_events.exchange(events);
+	if (previous == events)
+		return;
+	blog(LOG_INFO, "Active OBS events: %s", get_active_events().join(", ").qtocs());
+	if (wants(RpcEvent::StreamStatus) && obs_frontend_streaming_active()) {
+		if (!streamStatusTimer.isActive())
+			streamStatusTimer.start(STATUS_INTERVAL);
+	} else {
+		streamStatusTimer.stop();
+	}
+	if (signals_connected && ((previous ^ events) & source_signal_events))
+		connect_all_source_signals();
+}
+void Events::connect_all_source_signals()
+{
+	obs_enum_sources(
+		[](void *param, obs_source_t *source) {
+			auto self = reinterpret_cast<Events *>(param);
+			self->connectSourceSignals(source);
+			return true;
+		},
+		this);
+	hookTransitionPlaybackEvents();
+}
+QStringList Events::get_active_events() const
+{
+	QStringList names;
+	const uint64_t events = active_events.load(std::memory_order_relaxed);
+	for (int type = RpcEvent::None + 1; type <= RpcEvent::BroadcastCustomMessage; type++) {
+		if (events & event_bit((RpcEvent::Type)type))
+			names.append(RpcEvent::type_to_string((RpcEvent::Type)type));
+	}
+	return names;
+}
 uint64_t getOutputRunningTime(obs_output_t *output)
 {
 	if (!output || !obs_output_active(output)) {
@@ -365,6 +454,7 @@ QString Events::getRecordingTimecode()
  *
  * @return {String} `scene-name` The new scene.
  * @return {Array<SceneItem>} `sources` List of scene items in the new scene. Same specification as [`GetCurrentScene`](#getcurrentscene).
+ *                                       Only built when read, see RpcEvent::sceneItems().
  *
  * @api events
  * @name SwitchScenes
@@ -374,25 +464,14 @@ QString Events::getRecordingTimecode()
 void Events::OnSceneChange()
 {
 	const OBSSourceAutoRelease currentScene = obs_frontend_get_current_scene();
-	obs_data_t *idata = obs_data_create_from_json(Utils::GetSceneItems(currentScene).qtocs());
-	const OBSDataArrayAutoRelease sceneItems = obs_data_get_array(idata, "array");
-	obs_data_release(idata);
-	obs_data_t *data = obs_data_create();
-	obs_data_set_string(data, "scene-name", obs_source_get_name(currentScene));
-	obs_data_set_array(data, "sources", sceneItems);
-
-	// we __can__ release data after broadcastUpdate(), because inside this function
-	// data will be copyed (int RcpEvent constructor)
-	broadcastUpdate("SwitchScenes", data);
-	obs_data_release(data);
+	// The item list is only built if a receiver asks for it, see RpcEvent::sceneItems()
+	broadcastUpdate(RpcEvent::SwitchScenes, RpcEvent::ScenePayload{obs_source_get_name(currentScene), OBSGetWeakRef(currentScene)});
 }
 void Events::FinishedLoading()
 {
-	hookTransitionPlaybackEvents();
 	startup();
-	started = true;
 	Utils::build_hotkey_map();
-	broadcastUpdate("LoadingFinished");
+	broadcastUpdate(RpcEvent::LoadingFinished);
 }
 /**
  * The scene list has been modified.
@@ -405,7 +484,7 @@ void Events::FinishedLoading()
  */
 void Events::OnSceneListChange()
 {
-	broadcastUpdate("ScenesChanged");
+	broadcastUpdate(RpcEvent::ScenesChanged);
 }
 /**
  * Triggered when switching to another scene collection or when renaming the current scene collection.
@@ -417,7 +496,7 @@ void Events::OnSceneListChange()
  */
 void Events::OnSceneCollectionChange()
 {
-	broadcastUpdate("SceneCollectionChanged");
+	broadcastUpdate(RpcEvent::SceneCollectionChanged);
 	OnTransitionListChange();
 	OnTransitionChange();
 	OnSceneListChange();
@@ -433,7 +512,7 @@ void Events::OnSceneCollectionChange()
  */
 void Events::OnSceneCollectionListChange()
 {
-	broadcastUpdate("SceneCollectionListChanged");
+	broadcastUpdate(RpcEvent::SceneCollectionListChanged);
 }
 /**
  * The active transition has been changed.
@@ -448,10 +527,7 @@ void Events::OnSceneCollectionListChange()
 void Events::OnTransitionChange()
 {
 	const OBSSourceAutoRelease currentTransition = obs_frontend_get_current_transition();
-	obs_data_t *data = obs_data_create();
-	obs_data_set_string(data, "transition-name", obs_source_get_name(currentTransition));
-	broadcastUpdate("SwitchTransition", data);
-	obs_data_release(data);
+	broadcastUpdate(RpcEvent::SwitchTransition, RpcEvent::TransitionPayload{obs_source_get_name(currentTransition)});
 }
 /**
  * The list of available transitions has been modified.
@@ -464,7 +540,7 @@ void Events::OnTransitionChange()
  */
 void Events::OnTransitionListChange()
 {
-	broadcastUpdate("TransitionListChanged");
+	broadcastUpdate(RpcEvent::TransitionListChanged);
 }
 /**
  * Triggered when switching to another profile or when renaming the current profile.
@@ -476,7 +552,7 @@ void Events::OnTransitionListChange()
  */
 void Events::OnProfileChange()
 {
-	broadcastUpdate("ProfileChanged");
+	broadcastUpdate(RpcEvent::ProfileChanged);
 }
 /**
  * Triggered when a profile is created, added, renamed, or removed.
@@ -488,7 +564,7 @@ void Events::OnProfileChange()
  */
 void Events::OnProfileListChange()
 {
-	broadcastUpdate("ProfileListChanged");
+	broadcastUpdate(RpcEvent::ProfileListChanged);
 }
 /**
  * A request to start streaming has been issued.
@@ -504,7 +580,7 @@ void Events::OnStreamStarting()
 {
 	obs_data_t *data = obs_data_create();
 	obs_data_set_bool(data, "preview-only", false);
-	broadcastUpdate("StreamStarting", data);
+	broadcastUpdate(RpcEvent::StreamStarting, data);
 	obs_data_release(data);
 }
 /**
@@ -519,7 +595,7 @@ void Events::OnStreamStarted()
 {
 	_streamStarttime = os_gettime_ns();
 	_lastBytesSent = 0;
-	broadcastUpdate("StreamStarted");
+	broadcastUpdate(RpcEvent::StreamStarted);
 }
 /**
  * A request to stop streaming has been issued.
@@ -535,7 +611,7 @@ void Events::OnStreamStopping()
 {
 	obs_data_t *data = obs_data_create();
 	obs_data_set_bool(data, "preview-only", false);
-	broadcastUpdate("StreamStopping", data);
+	broadcastUpdate(RpcEvent::StreamStopping, data);
 	obs_data_release(data);
 }
 /**
@@ -549,7 +625,7 @@ void Events::OnStreamStopping()
 void Events::OnStreamStopped()
 {
 	_streamStarttime = 0;
-	broadcastUpdate("StreamStopped");
+	broadcastUpdate(RpcEvent::StreamStopped);
 }
 /**
  * A request to start recording has been issued.
@@ -561,7 +637,7 @@ void Events::OnStreamStopped()
  */
 void Events::OnRecordingStarting()
 {
-	broadcastUpdate("RecordingStarting");
+	broadcastUpdate(RpcEvent::RecordingStarting);
 }
 /**
  * Recording started successfully.
@@ -573,7 +649,7 @@ void Events::OnRecordingStarting()
  */
 void Events::OnRecordingStarted()
 {
-	broadcastUpdate("RecordingStarted");
+	broadcastUpdate(RpcEvent::RecordingStarted);
 }
 /**
  * A request to stop recording has been issued.
@@ -585,7 +661,7 @@ void Events::OnRecordingStarted()
  */
 void Events::OnRecordingStopping()
 {
-	broadcastUpdate("RecordingStopping");
+	broadcastUpdate(RpcEvent::RecordingStopping);
 }
 /**
  * Recording stopped successfully.
@@ -597,7 +673,7 @@ void Events::OnRecordingStopping()
  */
 void Events::OnRecordingStopped()
 {
-	broadcastUpdate("RecordingStopped");
+	broadcastUpdate(RpcEvent::RecordingStopped);
 }
 /**
  * Current recording paused
@@ -609,7 +685,7 @@ void Events::OnRecordingStopped()
  */
 void Events::OnRecordingPaused()
 {
-	broadcastUpdate("RecordingPaused");
+	broadcastUpdate(RpcEvent::RecordingPaused);
 }
 /**
  * Current recording resumed
@@ -621,7 +697,7 @@ void Events::OnRecordingPaused()
  */
 void Events::OnRecordingResumed()
 {
-	broadcastUpdate("RecordingResumed");
+	broadcastUpdate(RpcEvent::RecordingResumed);
 }
 /**
  * A request to start the replay buffer has been issued.
@@ -633,7 +709,7 @@ void Events::OnRecordingResumed()
  */
 void Events::OnReplayStarting()
 {
-	broadcastUpdate("ReplayStarting");
+	broadcastUpdate(RpcEvent::ReplayStarting);
 }
 /**
  * Replay Buffer started successfully
@@ -645,7 +721,7 @@ void Events::OnReplayStarting()
  */
 void Events::OnReplayStarted()
 {
-	broadcastUpdate("ReplayStarted");
+	broadcastUpdate(RpcEvent::ReplayStarted);
 }
 /**
  * A request to stop the replay buffer has been issued.
@@ -657,7 +733,7 @@ void Events::OnReplayStarted()
  */
 void Events::OnReplayStopping()
 {
-	broadcastUpdate("ReplayStopping");
+	broadcastUpdate(RpcEvent::ReplayStopping);
 }
 /**
  * Replay Buffer stopped successfully
@@ -669,7 +745,7 @@ void Events::OnReplayStopping()
  */
 void Events::OnReplayStopped()
 {
-	broadcastUpdate("ReplayStopped");
+	broadcastUpdate(RpcEvent::ReplayStopped);
 }
 /**
  * OBS is exiting.
@@ -682,7 +758,7 @@ void Events::OnReplayStopped()
 void Events::OnExit()
 {
 	state::closing = true;
-	broadcastUpdate("Exiting");
+	broadcastUpdate(RpcEvent::Exiting);
 	this->disconnect();
 }
 /**
@@ -754,7 +830,7 @@ void Events::StreamStatus()
 	obs_data_apply(data, stats);
 	obs_data_set_bool(data, "preview-only",
 			  false); // Retrocompat with OBSRemote
-	broadcastUpdate("StreamStatus", data);
+	broadcastUpdate(RpcEvent::StreamStatus, data);
 	obs_data_release(data);
 	obs_data_release(stats);
 }
@@ -810,7 +886,7 @@ void Events::Heartbeat()
 	}
 	obs_data_t *stats = GetStats();
 	obs_data_set_obj(data, "stats", stats);
-	broadcastUpdate("Heartbeat", data);
+	broadcastUpdate(RpcEvent::Heartbeat, data);
 	obs_data_release(data);
 	obs_data_release(stats);
 }
@@ -828,7 +904,7 @@ void Events::TransitionDurationChanged(int ms)
 {
 	obs_data_t *fields = obs_data_create();
 	obs_data_set_int(fields, "new-duration", ms);
-	broadcastUpdate("TransitionDurationChanged", fields);
+	broadcastUpdate(RpcEvent::TransitionDurationChanged, fields);
 	obs_data_release(fields);
 }
 /**
@@ -855,7 +931,7 @@ void Events::OnTransitionBegin(void *param, calldata_t *data)
 		return;
 	}
 	obs_data_t *fields = Utils::GetTransitionData(transition);
-	instance->broadcastUpdate("TransitionBegin", fields);
+	instance->broadcastUpdate(RpcEvent::TransitionBegin, fields);
 	obs_data_release(fields);
 }
 /**
@@ -890,7 +966,7 @@ void Events::OnTransitionEnd(void *param, calldata_t *data)
 	}
 	obs_data_t *fields = Utils::GetTransitionData(transition);
 	blog(LOG_DEBUG, "transition %s ended - to scene %s", obs_data_get_string(fields, "name"), obs_data_get_string(fields, "to-scene"));
-	instance->broadcastUpdate("TransitionEnd", fields);
+	instance->broadcastUpdate(RpcEvent::TransitionEnd, fields);
 	obs_data_release(fields);
 }
 /**
@@ -916,16 +992,13 @@ void Events::OnTransitionVideoEnd(void *param, calldata_t *data)
 		return;
 	}
 	obs_data_t *fields = Utils::GetTransitionData(transition);
-	instance->broadcastUpdate("TransitionVideoEnd", fields);
+	instance->broadcastUpdate(RpcEvent::TransitionVideoEnd, fields);
 	obs_data_release(fields);
 }
 /**
  * A source has been created. A source can be an input, a scene or a transition.
  *
  * @return {String} `sourceName` Source name
- * @return {String} `sourceType` Source type. Can be "input", "scene", "transition" or "filter".
- * @return {String} `sourceKind` Source kind.
- * @return {Object} `sourceSettings` Source settings
  *
  * @api events
  * @name SourceCreated
@@ -940,21 +1013,12 @@ void Events::OnSourceCreate(void *param, calldata_t *data)
 		return;
 	}
 	self->connectSourceSignals(source);
-	const OBSDataAutoRelease sourceSettings = obs_source_get_settings(source);
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_string(fields, "sourceType", sourceTypeToString(obs_source_get_type(source)));
-	obs_data_set_string(fields, "sourceKind", obs_source_get_id(source));
-	obs_data_set_obj(fields, "sourceSettings", sourceSettings);
-	self->broadcastUpdate("SourceCreated", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceCreated, RpcEvent::SourcePayload{obs_source_get_name(source)});
 }
 /**
  * A source has been destroyed/removed. A source can be an input, a scene or a transition.
  *
  * @return {String} `sourceName` Source name
- * @return {String} `sourceType` Source type. Can be "input", "scene", "transition" or "filter".
- * @return {String} `sourceKind` Source kind.
  *
  * @api events
  * @name SourceDestroyed
@@ -969,13 +1033,7 @@ void Events::OnSourceDestroy(void *param, calldata_t *data)
 		return;
 	}
 	self->disconnectSourceSignals(source);
-	const obs_source_type sourceType = obs_source_get_type(source);
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_string(fields, "sourceType", sourceTypeToString(sourceType));
-	obs_data_set_string(fields, "sourceKind", obs_source_get_id(source));
-	self->broadcastUpdate("SourceDestroyed", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceDestroyed, RpcEvent::SourcePayload{obs_source_get_name(source)});
 }
 /**
  * The volume of a source has changed.
@@ -999,11 +1057,7 @@ void Events::OnSourceVolumeChange(void *param, calldata_t *data)
 	if (!calldata_get_float(data, "volume", &volume)) {
 		return;
 	}
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_double(fields, "volume", volume);
-	self->broadcastUpdate("SourceVolumeChanged", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceVolumeChanged, RpcEvent::VolumePayload{obs_source_get_name(source), volume});
 }
 /**
  * A source has been muted or unmuted.
@@ -1027,11 +1081,7 @@ void Events::OnSourceMuteStateChange(void *param, calldata_t *data)
 	if (!calldata_get_bool(data, "muted", &muted)) {
 		return;
 	}
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_bool(fields, "muted", muted);
-	self->broadcastUpdate("SourceMuteStateChanged", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceMuteStateChanged, RpcEvent::MutePayload{obs_source_get_name(source), muted});
 }
 /**
  * The audio sync offset of a source has changed.
@@ -1058,7 +1108,7 @@ void Events::OnSourceAudioSyncOffsetChanged(void *param, calldata_t *data)
 	obs_data_t *fields = obs_data_create();
 	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
 	obs_data_set_int(fields, "syncOffset", (int)syncOffset);
-	self->broadcastUpdate("SourceAudioSyncOffsetChanged", fields);
+	self->broadcastUpdate(RpcEvent::SourceAudioSyncOffsetChanged, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1099,7 +1149,7 @@ void Events::OnSourceAudioMixersChanged(void *param, calldata_t *data)
 	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
 	obs_data_set_array(fields, "mixers", mixers);
 	obs_data_set_string(fields, "hexMixersValue", hexValue.toUtf8());
-	self->broadcastUpdate("SourceAudioMixersChanged", fields);
+	self->broadcastUpdate(RpcEvent::SourceAudioMixersChanged, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1125,19 +1175,14 @@ void Events::OnSourceRename(void *param, calldata_t *data)
 		return;
 	}
 	const char *previousName = calldata_get_string(data, "prev_name");
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "previousName", previousName);
-	obs_data_set_string(fields, "newName", newName);
-	self->broadcastUpdate("SourceRenamed", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceRenamed, RpcEvent::RenamePayload{previousName, newName});
 }
 /**
  * A filter was added to a source.
  *
  * @return {String} `sourceName` Source name
  * @return {String} `filterName` Filter name
- * @return {String} `filterType` Filter type
- * @return {Object} `filterSettings` Filter settings
+ * @return {Boolean} `filterEnabled` Filter state
  *
  * @api events
  * @name SourceFilterAdded
@@ -1155,23 +1200,17 @@ void Events::OnSourceFilterAdded(void *param, calldata_t *data)
 	if (!filter) {
 		return;
 	}
-	self->connectFilterSignals(filter);
-	obs_data_t *filterSettings = obs_source_get_settings(filter);
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_string(fields, "filterName", obs_source_get_name(filter));
-	obs_data_set_string(fields, "filterType", obs_source_get_id(filter));
-	obs_data_set_obj(fields, "filterSettings", filterSettings);
-	self->broadcastUpdate("SourceFilterAdded", fields);
-	obs_data_release(filterSettings);
-	obs_data_release(fields);
+	if (self->wants(RpcEvent::SourceFilterVisibilityChanged))
+		self->connectFilterSignals(filter);
+	self->broadcastUpdate(RpcEvent::SourceFilterAdded,
+			      RpcEvent::FilterPayload{obs_source_get_name(source), obs_source_get_name(filter), obs_source_enabled(filter)});
 }
 /**
  * A filter was removed from a source.
  *
  * @return {String} `sourceName` Source name
  * @return {String} `filterName` Filter name
- * @return {String} `filterType` Filter type
+ * @return {Boolean} `filterEnabled` Filter state
  *
  * @api events
  * @name SourceFilterRemoved
@@ -1186,10 +1225,7 @@ void Events::OnSourceRemoved(void *param, calldata_t *data)
 	if (!source) {
 		return;
 	}
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	self->broadcastUpdate("SourceRemoved", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceRemoved, RpcEvent::SourcePayload{obs_source_get_name(source)});
 }
 void Events::OnSourceFilterRemoved(void *param, calldata_t *data)
 {
@@ -1203,12 +1239,8 @@ void Events::OnSourceFilterRemoved(void *param, calldata_t *data)
 		return;
 	}
 	self->disconnectFilterSignals(filter);
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
-	obs_data_set_string(fields, "filterName", obs_source_get_name(filter));
-	obs_data_set_string(fields, "filterType", obs_source_get_id(filter));
-	self->broadcastUpdate("SourceFilterRemoved", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceFilterRemoved,
+			      RpcEvent::FilterPayload{obs_source_get_name(source), obs_source_get_name(filter), obs_source_enabled(filter)});
 }
 /**
  * The visibility/enabled state of a filter changed
@@ -1230,12 +1262,8 @@ void Events::OnSourceFilterVisibilityChanged(void *param, calldata_t *data)
 		return;
 	}
 	const OBSSource parent = obs_filter_get_parent(source);
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "sourceName", obs_source_get_name(parent));
-	obs_data_set_string(fields, "filterName", obs_source_get_name(source));
-	obs_data_set_bool(fields, "filterEnabled", obs_source_enabled(source));
-	self->broadcastUpdate("SourceFilterVisibilityChanged", fields);
-	obs_data_release(fields);
+	self->broadcastUpdate(RpcEvent::SourceFilterVisibilityChanged,
+			      RpcEvent::FilterPayload{obs_source_get_name(parent), obs_source_get_name(source), obs_source_enabled(source)});
 }
 /**
  * Filters in a source have been reordered.
@@ -1261,7 +1289,7 @@ void Events::OnSourceFilterOrderChanged(void *param, calldata_t *data)
 	obs_data_t *fields = obs_data_create();
 	obs_data_set_string(fields, "sourceName", obs_source_get_name(source));
 	obs_data_set_array(fields, "filters", filters);
-	self->broadcastUpdate("SourceFiltersReordered", fields);
+	self->broadcastUpdate(RpcEvent::SourceFiltersReordered, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1301,7 +1329,7 @@ void Events::OnSceneReordered(void *param, calldata_t *data)
 	obs_data_t *fields = obs_data_create();
 	obs_data_set_string(fields, "scene-name", obs_source_get_name(obs_scene_get_source(scene)));
 	obs_data_set_array(fields, "scene-items", sceneItems);
-	instance->broadcastUpdate("SourceOrderChanged", fields);
+	instance->broadcastUpdate(RpcEvent::SourceOrderChanged, fields);
 	obs_data_release(fields);
 	obs_data_array_release(sceneItems);
 }
@@ -1330,7 +1358,7 @@ void Events::OnSceneItemAdd(void *param, calldata_t *data)
 	obs_data_set_string(fields, "scene-name", sceneName);
 	obs_data_set_string(fields, "item-name", sceneItemName);
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(sceneItem));
-	instance->broadcastUpdate("SceneItemAdded", fields);
+	instance->broadcastUpdate(RpcEvent::SceneItemAdded, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1358,7 +1386,7 @@ void Events::OnSceneItemDelete(void *param, calldata_t *data)
 	obs_data_set_string(fields, "scene-name", sceneName);
 	obs_data_set_string(fields, "item-name", sceneItemName);
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(sceneItem));
-	instance->broadcastUpdate("SceneItemRemoved", fields);
+	instance->broadcastUpdate(RpcEvent::SceneItemRemoved, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1385,13 +1413,8 @@ void Events::OnSceneItemVisibilityChanged(void *param, calldata_t *data)
 	calldata_get_bool(data, "visible", &visible);
 	const char *sceneName = obs_source_get_name(obs_scene_get_source(scene));
 	const char *sceneItemName = obs_source_get_name(obs_sceneitem_get_source(sceneItem));
-	obs_data_t *fields = obs_data_create();
-	obs_data_set_string(fields, "scene-name", sceneName);
-	obs_data_set_string(fields, "item-name", sceneItemName);
-	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(sceneItem));
-	obs_data_set_bool(fields, "item-visible", visible);
-	instance->broadcastUpdate("SceneItemVisibilityChanged", fields);
-	obs_data_release(fields);
+	instance->broadcastUpdate(RpcEvent::SceneItemVisibilityChanged,
+				  RpcEvent::SceneItemPayload{sceneName, sceneItemName, obs_sceneitem_get_id(sceneItem), visible});
 }
 /**
  * An item's locked status has been toggled.
@@ -1422,7 +1445,7 @@ void Events::OnSceneItemLockChanged(void *param, calldata_t *data)
 	obs_data_set_string(fields, "item-name", sceneItemName);
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(sceneItem));
 	obs_data_set_bool(fields, "item-locked", locked);
-	instance->broadcastUpdate("SceneItemLockChanged", fields);
+	instance->broadcastUpdate(RpcEvent::SceneItemLockChanged, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1453,7 +1476,7 @@ void Events::OnSceneItemTransform(void *param, calldata_t *data)
 	obs_data_set_string(fields, "item-name", sceneItemName);
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(sceneItem));
 	obs_data_set_obj(fields, "transform", transform);
-	instance->broadcastUpdate("SceneItemTransformChanged", fields);
+	instance->broadcastUpdate(RpcEvent::SceneItemTransformChanged, fields);
 	obs_data_release(fields);
 	obs_data_release(transform);
 }
@@ -1486,7 +1509,7 @@ void Events::OnSceneItemSelected(void *param, calldata_t *data)
 	obs_data_set_string(fields, "scene-name", obs_source_get_name(sceneSource));
 	obs_data_set_string(fields, "item-name", obs_source_get_name(itemSource));
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(item));
-	self->broadcastUpdate("SceneItemSelected", fields);
+	self->broadcastUpdate(RpcEvent::SceneItemSelected, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1518,7 +1541,7 @@ void Events::OnSceneItemDeselected(void *param, calldata_t *data)
 	obs_data_set_string(fields, "scene-name", obs_source_get_name(sceneSource));
 	obs_data_set_string(fields, "item-name", obs_source_get_name(itemSource));
 	obs_data_set_int(fields, "item-id", obs_sceneitem_get_id(item));
-	self->broadcastUpdate("SceneItemDeselected", fields);
+	self->broadcastUpdate(RpcEvent::SceneItemDeselected, fields);
 	obs_data_release(fields);
 }
 /**
@@ -1526,6 +1549,7 @@ void Events::OnSceneItemDeselected(void *param, calldata_t *data)
  *
  * @return {String} `scene-name` Name of the scene being previewed.
  * @return {Array<SceneItem>} `sources` List of sources composing the scene. Same specification as [`GetCurrentScene`](#getcurrentscene).
+ *                                       Only built when read, see RpcEvent::sceneItems().
  *
  * @api events
  * @name PreviewSceneChanged
@@ -1538,14 +1562,7 @@ void Events::OnPreviewSceneChanged()
 		const OBSSourceAutoRelease scene = obs_frontend_get_current_preview_scene();
 		if (!scene)
 			return;
-		obs_data_t *idata = obs_data_create_from_json(Utils::GetSceneItems(scene).qtocs());
-		const OBSDataArrayAutoRelease sceneItems = obs_data_get_array(idata, "array");
-		obs_data_release(idata);
-		obs_data_t *data = obs_data_create();
-		obs_data_set_string(data, "scene-name", obs_source_get_name(scene));
-		obs_data_set_array(data, "sources", sceneItems);
-		broadcastUpdate("PreviewSceneChanged", data);
-		obs_data_release(data);
+		broadcastUpdate(RpcEvent::PreviewSceneChanged, RpcEvent::ScenePayload{obs_source_get_name(scene), OBSGetWeakRef(scene)});
 	}
 }
 /**
@@ -1560,10 +1577,7 @@ void Events::OnPreviewSceneChanged()
  */
 void Events::OnStudioModeSwitched(bool checked)
 {
-	obs_data_t *data = obs_data_create();
-	obs_data_set_bool(data, "new-state", checked);
-	broadcastUpdate("StudioModeSwitched", data);
-	obs_data_release(data);
+	broadcastUpdate(RpcEvent::StudioModeSwitched, RpcEvent::StatePayload{checked});
 }
 /**
  * A custom broadcast message was received
@@ -1581,7 +1595,7 @@ void Events::OnBroadcastCustomMessage(const QString &realm, obs_data_t *data)
 	obs_data_t *broadcastData = obs_data_create();
 	obs_data_set_string(broadcastData, "realm", realm.toUtf8().constData());
 	obs_data_set_obj(broadcastData, "data", data);
-	broadcastUpdate("BroadcastCustomMessage", broadcastData);
+	broadcastUpdate(RpcEvent::BroadcastCustomMessage, broadcastData);
 	obs_data_release(data);
 }
 /**
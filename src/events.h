@@ -19,6 +19,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -70,63 +71,12 @@ public:
 	void OnBroadcastCustomMessage(const QString &realm, obs_data_t *data);
 
 	bool HeartbeatIsActive;
-	enum event_type {
-		SourceDestroyed,
-		SourceRemoved,
-		SceneChanged,
-		SceneListChanged,
-		SceneCollectionChanged,
-		SceneCollectionListChanged,
-		TransitionChange,
-		TransitionListChanged,
-		ProfileChanged,
-		ProfileListChanged,
-		StreamStarting,
-		StreamStarted,
-		StreamStopping,
-		StreamStopped,
-		RecordingStarting,
-		RecordingStarted,
-		RecordingStopping,
-		RecordingStopped,
-		RecordingPaused,
-		RecordingResumed,
-		ReplayStarting,
-		ReplayStarted,
-		ReplayStopping,
-		ReplayStopped,
-		StudioModeSwitched,
-		PreviewSceneChanged,
-		Exiting,
-		LoadingFinished,
-		FrontendEvent,
-		TransitionBegin,
-		TransitionEnd,
-		TransitionVideoEnd,
-		SourceCreated,
-		SourceDestroy,
-		SourceVolumeChanged,
-		SourceMuteStateChanged,
-		SourceAudioSyncOffsetChanged,
-		SourceAudioMixersChanged,
-		SourceRenamed,
-		SourceFilterAdded,
-		SourceFilterRemoved,
-		SourceFilterVisibilityChanged,
-		SourceFilterOrderChanged,
-		SceneReordered,
-		SceneItemAdd,
-		SceneItemDeleted,
-		SceneItemVisibilityChanged,
-		SceneItemLockChanged,
-		SceneItemTransform,
-		SceneItemSelected,
-		SceneItemDeselected,
-		SwitchScenes
-	};
-	Q_ENUM(event_type)
-	static QString event_to_string(const event_type &enumval);
-	static event_type string_to_event(const QString &string);
+	bool is_started() const { return started; }
+
+	// Events something in the plugin reacts to, the others are neither connected nor emitted
+	bool wants(RpcEvent::Type type) const { return active_events.load(std::memory_order_relaxed) & event_bit(type); }
+	QStringList get_active_events() const;
+	void request_subscription_update();
 
 signals:
 	void obsEvent(const RpcEvent &event);
@@ -148,7 +98,16 @@ private:
 
 	bool started = false;
 
-	void broadcastUpdate(const char *updateType, obs_data_t *additionalFields);
+	static uint64_t event_bit(RpcEvent::Type type) { return uint64_t(1) << type; }
+	static uint64_t required_events();
+	void update_subscriptions();
+	void connect_all_source_signals();
+	std::atomic<uint64_t> active_events;
+	std::atomic<bool> subscription_update_pending{false};
+	bool signals_connected = false;
+
+	void broadcastUpdate(RpcEvent::Type type, obs_data_t *additionalFields = nullptr);
+	void broadcastUpdate(RpcEvent::Type type, RpcEvent::Payload payload);
 
 	void OnSceneChange();
 	void FinishedLoading();
@@ -0,0 +1,179 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "feedback-index.h"
+#include "Midi_hook.h"
+
+QString FeedbackIndex::join(const QString &first, const QString &second)
+{
+	return first + QChar(0) + second;
+}
+/*
+ * The events a hook gives feedback for, and the subject they have to be about
+ */
+QVector<FeedbackIndex::Key> FeedbackIndex::keys_for(const MidiHook *hook)
+{
+	QVector<Key> keys;
+	if (!hook->action)
+		return keys;
+	switch (*hook->action) {
+	case ActionsClass::Actions::Set_Volume:
+		keys.push_back(Key(RpcEvent::SourceVolumeChanged, hook->audio_source));
+		break;
+	case ActionsClass::Actions::Toggle_Mute:
+		keys.push_back(Key(RpcEvent::SourceMuteStateChanged, hook->audio_source));
+		break;
+	case ActionsClass::Actions::Set_Mute:
+		keys.push_back(Key(RpcEvent::SourceMuteStateChanged, hook->source));
+		break;
+	case ActionsClass::Actions::Do_Transition:
+	case ActionsClass::Actions::Set_Current_Scene:
+		keys.push_back(Key(RpcEvent::SwitchScenes, hook->scene));
+		break;
+	case ActionsClass::Actions::Set_Preview_Scene:
+		keys.push_back(Key(RpcEvent::PreviewSceneChanged, hook->scene));
+		break;
+	case ActionsClass::Actions::Toggle_Start_Stop_Recording:
+	case ActionsClass::Actions::Start_Recording:
+	case ActionsClass::Actions::Stop_Recording:
+		keys.push_back(Key(RpcEvent::RecordingStarted, QString()));
+		keys.push_back(Key(RpcEvent::RecordingStopping, QString()));
+		keys.push_back(Key(RpcEvent::RecordingStopped, QString()));
+		break;
+	case ActionsClass::Actions::Pause_Recording:
+	case ActionsClass::Actions::Resume_Recording:
+	case ActionsClass::Actions::Unpause_Recording:
+		keys.push_back(Key(RpcEvent::RecordingPaused, QString()));
+		keys.push_back(Key(RpcEvent::RecordingResumed, QString()));
+		keys.push_back(Key(RpcEvent::RecordingStopped, QString()));
+		break;
+	case ActionsClass::Actions::Toggle_Start_Stop_Streaming:
+	case ActionsClass::Actions::Start_Streaming:
+	case ActionsClass::Actions::Stop_Streaming:
+		keys.push_back(Key(RpcEvent::StreamStarted, QString()));
+		keys.push_back(Key(RpcEvent::StreamStopping, QString()));
+		keys.push_back(Key(RpcEvent::StreamStopped, QString()));
+		break;
+	case ActionsClass::Actions::Toggle_Start_Stop_Replay_Buffer:
+	case ActionsClass::Actions::Start_Replay_Buffer:
+	case ActionsClass::Actions::Stop_Replay_Buffer:
+		keys.push_back(Key(RpcEvent::ReplayStarted, QString()));
+		keys.push_back(Key(RpcEvent::ReplayStopping, QString()));
+		keys.push_back(Key(RpcEvent::ReplayStopped, QString()));
+		break;
+	case ActionsClass::Actions::Studio_Mode:
+		keys.push_back(Key(RpcEvent::StudioModeSwitched, QString()));
+		break;
+	case ActionsClass::Actions::Enable_Source_Filter:
+	case ActionsClass::Actions::Disable_Source_Filter:
+	case ActionsClass::Actions::Toggle_Source_Filter:
+		keys.push_back(Key(RpcEvent::SourceFilterVisibilityChanged, join(hook->source, hook->filter)));
+		break;
+	case ActionsClass::Actions::Toggle_Source_Visibility:
+		if (!hook->scene.isEmpty())
+			keys.push_back(Key(RpcEvent::SceneItemVisibilityChanged, join(hook->scene, hook->source)));
+		break;
+	case ActionsClass::Actions::Set_Current_Transition:
+		keys.push_back(Key(RpcEvent::SwitchTransition, hook->transition));
+		break;
+	default:
+		// Actions without a state OBS reports back
+		break;
+	}
+	return keys;
+}
+/*
+ * Name of the thing an event is about, built the same way as in keys_for
+ */
+QString FeedbackIndex::event_subject(const RpcEvent &event)
+{
+	switch (event.type()) {
+	case RpcEvent::SourceVolumeChanged:
+		if (const auto volume = event.get<RpcEvent::VolumePayload>())
+			return volume->source;
+		break;
+	case RpcEvent::SourceMuteStateChanged:
+		if (const auto mute = event.get<RpcEvent::MutePayload>())
+			return mute->source;
+		break;
+	case RpcEvent::SwitchScenes:
+	case RpcEvent::PreviewSceneChanged:
+		if (const auto scene = event.get<RpcEvent::ScenePayload>())
+			return scene->scene;
+		break;
+	case RpcEvent::SourceFilterVisibilityChanged:
+		if (const auto filter = event.get<RpcEvent::FilterPayload>())
+			return join(filter->source, filter->filter);
+		break;
+	case RpcEvent::SceneItemVisibilityChanged:
+		if (const auto item = event.get<RpcEvent::SceneItemPayload>())
+			return join(item->scene, item->item);
+		break;
+	case RpcEvent::SwitchTransition:
+		if (const auto transition = event.get<RpcEvent::TransitionPayload>())
+			return transition->transition;
+		break;
+	default:
+		break;
+	}
+	return QString();
+}
+void FeedbackIndex::add(MidiHook *hook)
+{
+	for (const Key &key : keys_for(hook)) {
+		hooks[key].push_back(hook);
+		event_counts[key.first]++;
+	}
+}
+void FeedbackIndex::remove(MidiHook *hook)
+{
+	for (const Key &key : keys_for(hook)) {
+		auto it = hooks.find(key);
+		if (it == hooks.end() || !it->removeOne(hook))
+			continue;
+		if (it->isEmpty())
+			hooks.erase(it);
+		if (--event_counts[key.first] <= 0)
+			event_counts.remove(key.first);
+	}
+}
+void FeedbackIndex::rebuild(const QVector<MidiHook *> &all_hooks)
+{
+	clear();
+	for (auto hook : all_hooks)
+		add(hook);
+}
+void FeedbackIndex::clear()
+{
+	hooks.clear();
+	event_counts.clear();
+}
+const QVector<MidiHook *> *FeedbackIndex::find(RpcEvent::Type type, const QString &subject) const
+{
+	const auto it = hooks.constFind(Key(type, subject));
+	return (it == hooks.constEnd()) ? nullptr : &it.value();
+}
+/*
+ * True if any hook gives feedback for that event type, whatever its subject
+ */
+bool FeedbackIndex::wants(RpcEvent::Type type) const
+{
+	return event_counts.contains(type);
+}
+/*
+ * Every event type some hook gives feedback for
+ */
+QList<RpcEvent::Type> FeedbackIndex::event_types() const
+{
+	return event_counts.keys();
+}
@@ -0,0 +1,47 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "rpc/RpcEvent.h"
+
+class MidiHook;
+/*
+ * Feedback Index
+ * Per device reverse table from an OBS event to the hooks that want feedback for it,
+ * keyed by (RpcEvent::Type, subject). The subject is the name the event is about
+ * (source, scene, transition, source and filter...), empty for global events like streaming.
+ * Two names are joined with a NUL, which cannot occur in OBS names as '/' can.
+ */
+class FeedbackIndex {
+public:
+	void add(MidiHook *hook);
+	void remove(MidiHook *hook);
+	void rebuild(const QVector<MidiHook *> &hooks);
+	void clear();
+	const QVector<MidiHook *> *find(RpcEvent::Type type, const QString &subject) const;
+	bool wants(RpcEvent::Type type) const;
+	QList<RpcEvent::Type> event_types() const;
+	static QString event_subject(const RpcEvent &event);
+
+private:
+	typedef QPair<RpcEvent::Type, QString> Key;
+	static QVector<Key> keys_for(const MidiHook *hook);
+	static QString join(const QString &first, const QString &second);
+	QHash<Key, QVector<MidiHook *>> hooks;
+	QHash<RpcEvent::Type, int> event_counts;
+};
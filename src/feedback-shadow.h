@@ -0,0 +1,101 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "Midi_message.h"
+
+/*
+ * Feedback Shadow
+ * Last value sent to an output device per (channel, note or control, number), so feedback that
+ * would not change what the controller shows can be skipped. A note off is stored as 0.
+ * Lock free, any thread may update it.
+ */
+class FeedbackShadow {
+public:
+	static constexpr uint8_t unknown = 0xFF;
+
+	FeedbackShadow() { clear(); }
+	/* Records the value the message leaves on the device, false if it was already there */
+	bool update(const MidiMessage &message)
+	{
+		const int index = slot(message.message_type, message.channel, message.NORC);
+		if (index < 0)
+			return true;
+		const uint8_t value = stored_value(message);
+		return values[index].exchange(value, std::memory_order_relaxed) != value;
+	}
+	/* Records the value without asking whether it changed, for messages sent past the shadow */
+	void set(const MidiMessage &message)
+	{
+		const int index = slot(message.message_type, message.channel, message.NORC);
+		if (index >= 0)
+			values[index].store(stored_value(message), std::memory_order_relaxed);
+	}
+	/* Forgets the slot of a message that did not reach the device, the next value for it is sent */
+	void invalidate(const MidiMessage &message)
+	{
+		const int index = slot(message.message_type, message.channel, message.NORC);
+		if (index >= 0)
+			values[index].store(unknown, std::memory_order_relaxed);
+	}
+	/* Forgets everything, the next value for every slot is sent */
+	void clear()
+	{
+		for (auto &value : values)
+			value.store(unknown, std::memory_order_relaxed);
+	}
+	/* Calls f with the message that restores each known slot */
+	template<typename F> void for_each(F f) const
+	{
+		for (int index = 0; index < (int)slots; index++) {
+			const uint8_t value = values[index].load(std::memory_order_relaxed);
+			if (value == unknown)
+				continue;
+			MidiMessage message;
+			const bool control = (index / 128) % 2;
+			message.channel = (uint8_t)(index / 256 + 1);
+			message.NORC = (uint8_t)(index % 128);
+			message.value = value;
+			message.message_type = control ? MidiMessageType::Control_Change : (value ? MidiMessageType::Note_On : MidiMessageType::Note_Off);
+			f(message);
+		}
+	}
+
+private:
+	static constexpr size_t slots = 16 * 2 * 128;
+	static uint8_t stored_value(const MidiMessage &message) { return (message.message_type == MidiMessageType::Note_Off) ? 0 : (message.value & 0x7F); }
+	/* Index of (channel, kind, number), -1 for messages that are not tracked */
+	static int slot(MidiMessageType type, int channel, int number)
+	{
+		int kind;
+		switch (type) {
+		case MidiMessageType::Note_On:
+		case MidiMessageType::Note_Off:
+			kind = 0;
+			break;
+		case MidiMessageType::Control_Change:
+			kind = 1;
+			break;
+		default:
+			return -1;
+		}
+		// Channels are clamped the same way the output encodes them
+		return ((std::clamp(channel, 1, 16) - 1) * 2 + kind) * 128 + (number & 0x7F);
+	}
+	std::array<std::atomic<uint8_t>, slots> values;
+};
@@ -16,6 +16,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <obs-frontend-api/obs-frontend-api.h>
 #endif
 #include <map>
+#include <memory>
 #include <utility>
 
 #include <QDialogButtonBox>
@@ -26,6 +27,8 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "ui_settings-dialog.h"
 #include "../device-manager.h"
 #include "../config.h"
+#include "../source-cache.h"
+#include "../events.h"
 #include "Macros.h"
 PluginWindow::PluginWindow(QWidget *parent) : QDialog(parent, Qt::Dialog), ui(new Ui::PluginWindow)
 {
@@ -39,6 +42,9 @@ PluginWindow::PluginWindow(QWidget *parent) : QDialog(parent, Qt::Dialog), ui(ne
 	hide_all_pairs();
 	connect_ui_signals();
 	ui->box_action->setAlignment((int)Alignment::Top_Center);
+	diagnostics_timer = new QTimer(this);
+	diagnostics_timer->setInterval(1000);
+	connect(diagnostics_timer, &QTimer::timeout, this, &PluginWindow::update_diagnostics);
 	starting = false;
 }
 
@@ -55,9 +61,11 @@ void PluginWindow::connect_ui_signals() const
 	connect(ui->list_midi_dev, SIGNAL(currentTextChanged(QString)), this, SLOT(on_device_select(QString)));
 	connect(ui->check_enabled, SIGNAL(stateChanged(int)), this, SLOT(on_check_enabled_state_changed(int)));
 	connect(ui->bidirectional, SIGNAL(stateChanged(int)), this, SLOT(on_bid_enabled_state_changed(int)));
+	connect(ui->btn_reset_device, SIGNAL(clicked()), this, SLOT(reset_device()));
+	connect(ui->btn_resync_device, SIGNAL(clicked()), this, SLOT(resync_device()));
 	// Connections for Configure Tab
 	connect(ui->cb_obs_output_scene, SIGNAL(currentTextChanged(QString)), this, SLOT(get_sources(QString)));
-	connect(ui->cb_obs_output_action, SIGNAL(currentTextChanged(QString)), this, SLOT(obs_actions_select(QString)));
+	connect(ui->cb_obs_output_action, SIGNAL(currentIndexChanged(int)), this, SLOT(obs_actions_select(int)));
 	connect(ui->cb_obs_output_source, SIGNAL(currentTextChanged(QString)), this, SLOT(on_source_change(QString)));
 	connect(ui->cb_obs_output_scene, SIGNAL(currentTextChanged(QString)), this, SLOT(on_scene_change(QString)));
 	// connect(ui->table_mapping, SIGNAL(cellClicked(int, int)), this, SLOT(edit_mapping()));
@@ -71,23 +79,25 @@ void PluginWindow::connect_ui_signals() const
 void PluginWindow::setup_actions() const
 {
 	ui->cb_obs_output_action->clear();
-	ui->cb_obs_output_action->addItems(Utils::TranslateActions());
+	// Items carry the action enum, the label is only for display
+	for (auto action : Utils::AllActions_raw)
+		ui->cb_obs_output_action->addItem(Utils::translate_action(action), (int)action);
 	ui->cb_obs_output_action->setCurrentIndex(1);
 	ui->cb_obs_output_action->setCurrentIndex(0);
 }
 void PluginWindow::ToggleShowHide()
 {
 	if (!isVisible()) {
+		// Without an observer the port list is only as fresh as the last look
+		if (!GetDeviceManager()->is_observing_ports())
+			GetDeviceManager()->refresh_ports();
 		load_devices();
 		ui->tabWidget->setCurrentIndex(0);
 		ui->list_midi_dev->setCurrentRow(0);
 		setVisible(true);
 	} else {
-		setVisible(false);
-		ui->btn_Listen_many->setChecked(false);
-		ui->btn_Listen_one->setChecked(false);
-		hide_all_pairs();
-		reset_to_defaults();
+		// Deleted on close, the next toggle builds it again
+		close();
 	}
 }
 
@@ -186,6 +196,8 @@ void PluginWindow::on_device_select(const QString &curitem) const
 				ui->outbox->setEnabled(true);
 				ui->bidirectional->setEnabled(true);
 				ui->bidirectional->setChecked(MAdevice->isBidirectional());
+				ui->btn_reset_device->setEnabled(MAdevice->isBidirectional() && !MAdevice->is_resetting());
+				ui->btn_resync_device->setEnabled(MAdevice->isBidirectional());
 
 				if (MAdevice->isBidirectional()) {
 					ui->outbox->setCurrentText(MAdevice->get_midi_output_name());
@@ -195,6 +207,8 @@ void PluginWindow::on_device_select(const QString &curitem) const
 				ui->check_enabled->setChecked(false);
 				ui->outbox->setEnabled(false);
 				ui->bidirectional->setEnabled(false);
+				ui->btn_reset_device->setEnabled(false);
+				ui->btn_resync_device->setEnabled(false);
 			}
 			/// HOOK up the Message Handler
 			ui->mapping_lbl_device_name->setText(curitem);
@@ -212,13 +226,16 @@ void PluginWindow::handle_midi_message(const MidiMessage &mess) const
 		return;
 
 	if (ui->btn_Listen_one->isChecked() || ui->btn_Listen_many->isChecked()) {
-		blog(1, "got midi message via gui, \n Device = %s \n MType = %s \n NORC : %i \n Channel: %i \n Value: %i", mess.device_name.qtocs(),
-		     mess.message_type.qtocs(), mess.NORC, mess.channel, mess.value);
-		ui->mapping_lbl_device_name->setText(mess.device_name);
+		const auto device = GetDeviceManager()->get_midi_device_by_id(mess.device_id);
+		const QString device_name = (device != nullptr) ? device->get_midi_input_name() : ui->mapping_lbl_device_name->text();
+		const QString message_type = MidiMessage::message_type_to_string(mess.message_type);
+		blog(1, "got midi message via gui, \n Device = %s \n MType = %s \n NORC : %i \n Channel: %i \n Value: %i", device_name.qtocs(),
+		     message_type.qtocs(), mess.NORC, mess.channel, mess.value);
+		ui->mapping_lbl_device_name->setText(device_name);
 		ui->sb_channel->setValue(mess.channel);
 		ui->sb_norc->setValue(mess.NORC);
 		ui->slider_value->setValue(mess.value);
-		ui->cb_mtype->setCurrentText(mess.message_type);
+		ui->cb_mtype->setCurrentText(message_type);
 		ui->btn_Listen_one->setChecked(false);
 	}
 	if (find_mapping_location(mess) != -1) {
@@ -230,6 +247,37 @@ void PluginWindow::on_bid_enabled_state_changed(int state) const
 	auto device = GetDeviceManager()->get_midi_device(ui->list_midi_dev->currentItem()->text().qtocs());
 	ui->outbox->setEnabled(state);
 	device->set_bidirectional(state);
+	ui->btn_reset_device->setEnabled(state && !device->is_resetting());
+	ui->btn_resync_device->setEnabled(state);
+}
+/*
+ * Resets the selected device, the button stays disabled until the reset has been written
+ */
+void PluginWindow::reset_device()
+{
+	auto device = GetDeviceManager()->get_midi_device(ui->list_midi_dev->currentItem()->text());
+	if (!device || device->is_resetting())
+		return;
+	ui->btn_reset_device->setEnabled(false);
+	ui->btn_reset_device->setText("Resetting...");
+	auto connection = std::make_shared<QMetaObject::Connection>();
+	*connection = connect(device, &MidiAgent::reset_finished, this, [this, device, connection](int messages) {
+		disconnect(*connection);
+		ui->btn_reset_device->setText("Reset Device");
+		if (ui->list_midi_dev->currentItem() && ui->list_midi_dev->currentItem()->text() == device->get_midi_input_name())
+			ui->btn_reset_device->setEnabled(device->isBidirectional());
+		blog(LOG_DEBUG, "Reset of %s finished, %d messages", device->get_midi_output_name().qtocs(), messages);
+	});
+	device->reset_feedback();
+}
+/*
+ * Sends the selected device its feedback state again
+ */
+void PluginWindow::resync_device() const
+{
+	auto device = GetDeviceManager()->get_midi_device(ui->list_midi_dev->currentItem()->text());
+	if (device)
+		device->resync_feedback();
 }
 PluginWindow::~PluginWindow()
 {
@@ -439,15 +487,19 @@ void PluginWindow::clear_actions_box(QLayout *layout) const
 		delete layout;
 	}
 }
-void PluginWindow::obs_actions_select(const QString &action) const
+void PluginWindow::obs_actions_select(int index) const
 {
+	if (index < 0)
+		return;
+	const auto action = (ActionsClass::Actions)ui->cb_obs_output_action->itemData(index).toInt();
 	clear_actions_box(ui->box_action->layout());
-	Actions *AC = Actions::make_action(Utils::untranslate(action));
-	ui->box_action->setLayout(AC->set_widgets());
+	Actions *AC = Actions::make_action(action);
+	if (AC)
+		ui->box_action->setLayout(AC->set_widgets());
 	ui->btn_reset->setEnabled(true);
 	if (!switching) {
 		hide_all_pairs();
-		switch (ActionsClass::string_to_action(Utils::untranslate(action))) {
+		switch (action) {
 		case ActionsClass::Actions::Set_Preview_Scene:
 			show_pair(Pairs::Scene);
 			break;
@@ -563,53 +615,33 @@ void PluginWindow::set_range_text(QString left, QString right) const
 }
 bool PluginWindow::map_exists() const
 {
-	auto devicemanager = GetDeviceManager();
-	const auto hooks = devicemanager->get_midi_hooks(ui->mapping_lbl_device_name->text());
-	for (auto hook : hooks) {
-		if ((hook->channel == ui->sb_channel->value()) && (hook->norc == ui->sb_norc->value()) && (hook->message_type == ui->cb_mtype->currentText())) {
-			return true;
-		}
-	}
-	return false;
+	return find_existing_hook() != nullptr;
 }
 MidiHook *PluginWindow::find_existing_hook() const
 {
-	auto devicemanager = GetDeviceManager();
-	const auto hooks = devicemanager->get_midi_hooks(ui->mapping_lbl_device_name->text());
-	for (auto hook : hooks) {
-		if ((hook->channel == ui->sb_channel->value()) && (hook->norc == ui->sb_norc->value()) && (hook->message_type == ui->cb_mtype->currentText())) {
-			return hook;
-		}
-	}
-	return nullptr;
+	const auto device = GetDeviceManager()->get_midi_device(ui->mapping_lbl_device_name->text());
+	if (device == nullptr)
+		return nullptr;
+	return device->find_midi_hook(MidiMessage::string_to_message_type(ui->cb_mtype->currentText()), ui->sb_channel->value(), ui->sb_norc->value());
 }
 int PluginWindow::find_mapping_location(const MidiMessage &message) const
 {
-	auto devicemanager = GetDeviceManager();
-	const auto hooks = devicemanager->get_midi_hooks(ui->mapping_lbl_device_name->text());
-	for (int i = 0; i < hooks.size(); i++) {
-		if ((hooks.at(i)->channel == message.channel) && (hooks.at(i)->norc == message.NORC) && (hooks.at(i)->message_type == message.message_type)) {
-			if (hooks.at(i)->value_as_filter) {
-				if (hooks.at(i)->value == message.value) {
-					return i;
-				}
-			} else {
-				return i;
-			}
-		}
-	}
-	return -1;
+	const auto device = GetDeviceManager()->get_midi_device(ui->mapping_lbl_device_name->text());
+	if (device == nullptr)
+		return -1;
+	const auto hook = device->find_midi_hook(message.message_type, message.channel, message.NORC, message.value);
+	return (hook == nullptr) ? -1 : device->GetMidiHooks().indexOf(hook);
 }
 void PluginWindow::add_new_mapping()
 {
 	if ((!map_exists() && verify_mapping() && ui->sb_channel->value() != 0) || ((map_exists() && ui->check_use_value->isChecked())) || editmode) {
 		auto *new_midi_hook = new MidiHook();
 		new_midi_hook->channel = ui->sb_channel->value();
-		new_midi_hook->message_type = ui->cb_mtype->currentText();
+		new_midi_hook->message_type = MidiMessage::string_to_message_type(ui->cb_mtype->currentText());
 		new_midi_hook->norc = ui->sb_norc->value();
 		new_midi_hook->value_as_filter = ui->check_use_value->isChecked();
 		new_midi_hook->value.emplace(ui->slider_value->value());
-		new_midi_hook->action = ui->cb_obs_output_action->currentText();
+		new_midi_hook->action = (ActionsClass::Actions)ui->cb_obs_output_action->currentData().toInt();
 		if (ui->cb_obs_output_scene->isVisible()) {
 			new_midi_hook->scene = ui->cb_obs_output_scene->currentText();
 		}
@@ -644,6 +676,7 @@ void PluginWindow::add_new_mapping()
 			new_midi_hook->hotkey = Utils::get_hotkey_key(ui->cb_obs_output_hotkey->currentText());
 		}
 		new_midi_hook->set_obs_action();
+		new_midi_hook->coalesce = new_midi_hook->actions && new_midi_hook->actions->is_continuous() && new_midi_hook->coalescing_allowed();
 		if (editmode) {
 			GetDeviceManager().get()->get_midi_device(ui->mapping_lbl_device_name->text())->edit_midi_hook(edithook, new_midi_hook);
 		} else {
@@ -677,7 +710,7 @@ void PluginWindow::add_new_mapping()
 }
 void PluginWindow::add_row_from_hook(const MidiHook *hook) const
 {
-	if (hook == nullptr)
+	if (hook == nullptr || hook->actions == nullptr)
 		return;
 	ui->list_mapping->addItem(hook->actions->get_action_string());
 	// const auto row = ui->table_mapping->rowCount();
@@ -736,6 +769,12 @@ void PluginWindow::tab_changed(const int tab) const
 		ui->mapping_lbl_device_name->setText(ui->list_midi_dev->currentItem()->text());
 		Utils::build_hotkey_map();
 	}
+	if (ui->tabWidget->widget(tab) == ui->tab_diagnostics) {
+		update_diagnostics();
+		diagnostics_timer->start();
+	} else {
+		diagnostics_timer->stop();
+	}
 	clear_table();
 	load_table();
 	// this->ui->table_mapping->resizeColumnsToContents();
@@ -885,3 +924,34 @@ void PluginWindow::on_source_change(const QString &new_source) const
 		ui->cb_obs_output_filter->addItems(Utils::get_filter_names(new_source));
 	}
 }
+/*
+ * Fills the diagnostics tab with the runtime counters of every device
+ */
+void PluginWindow::update_diagnostics() const
+{
+	QString text;
+	const auto devices = GetDeviceManager()->get_active_midi_devices();
+	for (auto device : devices) {
+		text.append(device->get_midi_input_name()).append("\n");
+		text.append(QString("  Ingest queue: depth %1, high water %2, dropped %3\n")
+				    .arg(device->get_queue_depth())
+				    .arg(device->get_queue_high_water())
+				    .arg(device->get_dropped_messages()));
+		text.append(QString("  Coalesced messages: %1\n").arg(device->get_coalesced_messages()));
+		text.append(QString("  Latency p50/p99/max: %1\n").arg(device->get_latency_summary()));
+		const MidiOutputWriter &output = device->get_output_writer();
+		text.append(QString("  Output queue: depth %1, queued %2, sent %3, dropped %4\n")
+				    .arg(output.get_depth())
+				    .arg(output.get_queued())
+				    .arg(output.get_sent())
+				    .arg(output.get_dropped()));
+		text.append(QString("  Suppressed feedback: %1\n").arg(device->get_suppressed_messages()));
+		if (device->isBidirectional() && !device->is_output_ready())
+			text.append("  Feedback paused, output not connected\n");
+	}
+	if (devices.isEmpty())
+		text = "No MIDI devices configured\n";
+	text.append(QString("\nSource cache: %1 hits, %2 misses\n").arg(GetSourceCache()->get_hits()).arg(GetSourceCache()->get_misses()));
+	text.append(QString("\nActive OBS events: %1\n").arg(GetEventsSystem()->get_active_events().join(", ")));
+	ui->text_diagnostics->setPlainText(text);
+}
@@ -12,6 +12,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #pragma once
 #include <QtWidgets/QDialog>
+#include <QtCore/QTimer>
 
 #include <vector>
 
@@ -29,10 +30,12 @@ public slots:
 private slots:
 	void on_check_enabled_state_changed(int state) const;
 	void on_bid_enabled_state_changed(int state) const;
+	void reset_device();
+	void resync_device() const;
 	void on_device_select(const QString &curitem) const;
 	void select_output_device(const QString &item) const;
 	void handle_midi_message(const MidiMessage &mess) const;
-	void obs_actions_select(const QString &action) const;
+	void obs_actions_select(int index) const;
 	void set_edit_mode();
 	void save_edit();
 	void set_min_max_range_defaults(int min, int max) const;
@@ -51,6 +54,7 @@ private slots:
 	void remove_hook(MidiHook *hook) const;
 	void delete_mapping() const;
 	void edit_mapping();
+	void update_diagnostics() const;
 	//static void set_cell_colors(const QColor &color, QTableWidgetItem *item);
 
 private:
@@ -84,4 +88,5 @@ private:
 	bool editmode = false;
 	bool switching = false;
 	MidiHook *edithook;
+	QTimer *diagnostics_timer;
 };
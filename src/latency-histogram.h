@@ -0,0 +1,113 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+ * Latency Histogram
+ * Durations in nanoseconds, in log-linear buckets like an HDR histogram: 32 buckets per power of
+ * two, so a percentile is within about 3% of the recorded value. Durations past about 68 s are
+ * counted as 68 s.
+ * Lock free, for a single writer: record() is a few loads and stores, without atomic read-modify-write.
+ * Any thread may read a summary while it records, it may then miss the latest values.
+ */
+class LatencyHistogram {
+public:
+	struct Summary {
+		uint64_t count = 0;
+		uint64_t p50_ns = 0;
+		uint64_t p99_ns = 0;
+		uint64_t max_ns = 0;
+	};
+
+	void record(uint64_t ns)
+	{
+		auto &bucket = counts[bucket_index(std::min(ns, max_value))];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (ns > max.load(std::memory_order_relaxed))
+			max.store(ns, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	/* The highest value of the bucket holding each percentile, never above the maximum recorded */
+	Summary summary() const
+	{
+		Summary result;
+		std::array<uint64_t, bucket_count> snapshot;
+		for (size_t i = 0; i < bucket_count; i++) {
+			snapshot[i] = counts[i].load(std::memory_order_relaxed);
+			result.count += snapshot[i];
+		}
+		result.max_ns = max.load(std::memory_order_relaxed);
+		if (result.count == 0)
+			return result;
+		result.p50_ns = std::min(percentile(snapshot, (result.count + 1) / 2), result.max_ns);
+		result.p99_ns = std::min(percentile(snapshot, result.count - result.count / 100), result.max_ns);
+		return result;
+	}
+	uint64_t get_count() const { return total.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr int sub_bits = 5;
+	static constexpr uint64_t sub_count = uint64_t(1) << sub_bits;
+	static constexpr int max_exponent = 35;
+	static constexpr uint64_t max_value = (uint64_t(1) << (max_exponent + 1)) - 1;
+	static constexpr size_t bucket_count = (max_exponent - sub_bits + 2) * sub_count;
+
+	static int highest_bit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+	/* Exact below sub_count, then sub_count buckets for each power of two */
+	static size_t bucket_index(uint64_t value)
+	{
+		if (value < sub_count)
+			return (size_t)value;
+		const int exponent = highest_bit(value);
+		return (size_t)((exponent - sub_bits + 1) * sub_count + ((value >> (exponent - sub_bits)) - sub_count));
+	}
+	static uint64_t bucket_highest(size_t index)
+	{
+		if (index < sub_count)
+			return index;
+		const int shift = (int)(index / sub_count) - 1;
+		return ((index % sub_count + sub_count + 1) << shift) - 1;
+	}
+	/* Value of the rank-th smallest recorded, rank counted from 1 */
+	static uint64_t percentile(const std::array<uint64_t, bucket_count> &snapshot, uint64_t rank)
+	{
+		uint64_t seen = 0;
+		for (size_t i = 0; i < bucket_count; i++) {
+			seen += snapshot[i];
+			if (seen >= rank)
+				return bucket_highest(i);
+		}
+		return max_value;
+	}
+	std::array<std::atomic<uint64_t>, bucket_count> counts{};
+	std::atomic<uint64_t> max{0};
+	std::atomic<uint64_t> total{0};
+};
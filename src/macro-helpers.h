@@ -18,6 +18,7 @@ public:
 	//** Scene button Values **//
 	inline static int previous_scene_norc = -1;
 	inline static int previous_preview_scene_norc = -1;
+	inline static int previous_transition_norc = -1;
 	//** **/
 	inline static bool swapping = false;
 	inline static bool closing = false;
@@ -27,43 +28,43 @@ namespace Macro {
 /**
  *Toggles a midi message between on and off states, should work on both notes and controls.
  */
-inline void Toggle(MidiAgent *agent, MidiMessage *message)
+inline void Toggle(MidiAgent *agent, MidiMessage message)
 {
 	if (state::swapping)
 		return;
-	if (message->isNote()) {
-		message->message_type = (message->message_type == "Note On") ? "Note Off" : "Note On";
+	if (message.isNote()) {
+		message.message_type = (message.message_type == MidiMessageType::Note_On) ? MidiMessageType::Note_Off : MidiMessageType::Note_On;
 	}
-	message->value = (message->value > 0) ? 0 : 127;
-	agent->send_message_to_midi_device((MidiMessage)*message);
+	message.value = (message.value > 0) ? 0 : 127;
+	agent->send_message_to_midi_device(message);
 }
 /**
  *Toggles a midi message between on and off states, should work on both notes and controls.
  */
-inline static void set_on_off(MidiAgent *agent, MidiMessage *message, bool on)
+inline static void set_on_off(MidiAgent *agent, MidiMessage message, bool on)
 {
 	if (state::swapping)
 		return;
-	if (message->isNote()) {
-		message->message_type = (on) ? "Note On" : "Note Off";
+	if (message.isNote()) {
+		message.message_type = (on) ? MidiMessageType::Note_On : MidiMessageType::Note_Off;
 	}
-	message->value = (on) ? 127 : 0;
-	agent->send_message_to_midi_device((MidiMessage)*message);
+	message.value = (on) ? 127 : 0;
+	agent->send_message_to_midi_device(message);
 }
 
-inline static void swap_buttons(MidiAgent *agent, MidiMessage *message, int button1, int button2)
+inline static void swap_buttons(MidiAgent *agent, MidiMessage message, int button1, int button2)
 {
 	state::swapping = true;
 	if (1 > 0) {
-		message->message_type = "Note Off";
-		message->NORC = button1;
-		message->value = 0;
-		agent->send_message_to_midi_device((MidiMessage)*message);
+		message.message_type = MidiMessageType::Note_Off;
+		message.NORC = button1;
+		message.value = 0;
+		agent->send_message_to_midi_device(message);
 	}
-	message->NORC = button2;
-	message->message_type = "Note On";
-	message->value = 1;
-	agent->send_message_to_midi_device((MidiMessage)*message);
+	message.NORC = button2;
+	message.message_type = MidiMessageType::Note_On;
+	message.value = 1;
+	agent->send_message_to_midi_device(message);
 	state::swapping = false;
 }
 /// <summary>
@@ -72,24 +73,18 @@ inline static void swap_buttons(MidiAgent *agent, MidiMessage *message, int butt
 /// <param name="agent">MidiAgent</param>
 /// <param name="message"></param>
 /// <param name="vol"></param>
-inline static void set_volume(MidiAgent *agent, MidiMessage *message, double vol)
+inline static void set_volume(MidiAgent *agent, MidiMessage message, double vol)
 {
 	const uint8_t newvol = Utils::mapper2(cbrt(vol));
-	message->value = newvol;
-	agent->send_message_to_midi_device((MidiMessage)*message);
+	message.value = newvol;
+	agent->send_message_to_midi_device(message);
 }
+/// <summary>
+/// Resets the notes and controls the hooks of agent use, asynchronously, see MidiAgent::reset_feedback
+/// </summary>
+/// <param name="agent">MidiAgent</param>
 inline static void reset_midi(MidiAgent *agent)
 {
-	MidiMessage message;
-	for (int j = 0; j <= 16; j++) {
-		message.channel = j;
-		for (int i = 0; i <= 127; i++) {
-			message.NORC = i;
-			message.message_type = "Control Change";
-			agent->send_message_to_midi_device(message);
-			message.message_type = "Note Off";
-			agent->send_message_to_midi_device(message);
-		}
-	}
+	agent->reset_feedback();
 }
 }; // End Macro
@@ -0,0 +1,209 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "mapping-cache.h"
+
+#include <cstring>
+
+#include <QtCore/QSaveFile>
+
+MappingCache::Builder::Builder()
+{
+	strings.emplace_back();
+	string_index.insert(QString(), 0);
+}
+uint32_t MappingCache::Builder::intern(const QString &string)
+{
+	if (string.isEmpty())
+		return 0;
+	const auto it = string_index.constFind(string);
+	if (it != string_index.constEnd())
+		return it.value();
+	const uint32_t index = (uint32_t)strings.size();
+	strings.push_back(string.toUtf8());
+	string_index.insert(string, index);
+	return index;
+}
+void MappingCache::Builder::add_device(Device device)
+{
+	device.first_hook = device_first_hook;
+	device.hook_count = (uint32_t)hooks.size() - device_first_hook;
+	devices.push_back(device);
+	device_first_hook = (uint32_t)hooks.size();
+}
+void MappingCache::Builder::add_hook(const Hook &hook)
+{
+	hooks.push_back(hook);
+}
+QByteArray MappingCache::Builder::finish(bool debug_mode) const
+{
+	Header header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.device_size = sizeof(Device);
+	header.hook_size = sizeof(Hook);
+	header.debug_mode = debug_mode;
+	header.string_count = (uint32_t)strings.size();
+	header.device_count = (uint32_t)devices.size();
+	header.hook_count = (uint32_t)hooks.size();
+	std::vector<uint32_t> offsets;
+	offsets.reserve(strings.size() + 1);
+	uint32_t offset = 0;
+	for (const QByteArray &string : strings) {
+		offsets.push_back(offset);
+		offset += (uint32_t)string.size();
+	}
+	offsets.push_back(offset);
+	header.string_bytes = offset;
+
+	QByteArray image;
+	image.reserve((int)(sizeof(Header) + offsets.size() * sizeof(uint32_t) + padded(offset) + devices.size() * sizeof(Device) +
+			    hooks.size() * sizeof(Hook)));
+	image.append((const char *)&header, sizeof(header));
+	image.append((const char *)offsets.data(), (int)(offsets.size() * sizeof(uint32_t)));
+	for (const QByteArray &string : strings)
+		image.append(string);
+	image.append(QByteArray((int)(padded(offset) - offset), '\0'));
+	image.append((const char *)devices.data(), (int)(devices.size() * sizeof(Device)));
+	image.append((const char *)hooks.data(), (int)(hooks.size() * sizeof(Hook)));
+	return image;
+}
+MappingCache::~MappingCache()
+{
+	close();
+}
+/*
+ * FNV-1a, 64 bit
+ */
+uint64_t MappingCache::checksum(const char *data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+bool MappingCache::write(QByteArray image, const QByteArray &json, const QString &path)
+{
+	if ((size_t)image.size() < sizeof(Header))
+		return false;
+	auto *header = (Header *)image.data();
+	header->json_size = (uint64_t)json.size();
+	header->json_checksum = checksum(json.constData(), (size_t)json.size());
+	header->body_checksum = checksum(image.constData() + sizeof(Header), image.size() - sizeof(Header));
+	QSaveFile out(path);
+	if (!out.open(QIODevice::WriteOnly) || out.write(image) != image.size())
+		return false;
+	return out.commit();
+}
+bool MappingCache::open(const QString &path, const QByteArray &json)
+{
+	close();
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	map_size = file.size();
+	map = file.map(0, map_size);
+	if (!map || !validate(json)) {
+		close();
+		return false;
+	}
+	return true;
+}
+/*
+ * Everything a record can point at is checked here, the getters trust the file afterwards
+ */
+bool MappingCache::validate(const QByteArray &json)
+{
+	if ((size_t)map_size < sizeof(Header))
+		return false;
+	header = (const Header *)map;
+	if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version || header->device_size != sizeof(Device) ||
+	    header->hook_size != sizeof(Hook))
+		return false;
+	if (header->json_size != (uint64_t)json.size() || header->json_checksum != checksum(json.constData(), (size_t)json.size()))
+		return false;
+	const size_t offsets_size = ((size_t)header->string_count + 1) * sizeof(uint32_t);
+	const size_t expected = sizeof(Header) + offsets_size + padded(header->string_bytes) + (size_t)header->device_count * sizeof(Device) +
+				(size_t)header->hook_count * sizeof(Hook);
+	if (header->string_count == 0 || (size_t)map_size != expected)
+		return false;
+	if (header->body_checksum != checksum((const char *)map + sizeof(Header), (size_t)map_size - sizeof(Header)))
+		return false;
+	string_offsets = (const uint32_t *)(map + sizeof(Header));
+	string_bytes = (const char *)(map + sizeof(Header) + offsets_size);
+	devices = (const Device *)(string_bytes + padded(header->string_bytes));
+	hooks = (const Hook *)(devices + header->device_count);
+	for (uint32_t i = 0; i < header->string_count; i++) {
+		if (string_offsets[i] > string_offsets[i + 1])
+			return false;
+	}
+	if (string_offsets[header->string_count] != header->string_bytes)
+		return false;
+	const auto valid_string = [this](uint32_t index) { return index < header->string_count; };
+	for (uint32_t i = 0; i < header->device_count; i++) {
+		const Device &device = devices[i];
+		if ((uint64_t)device.first_hook + device.hook_count > header->hook_count || !valid_string(device.name) || !valid_string(device.outname) ||
+		    !valid_string(device.reset_sysex))
+			return false;
+	}
+	for (uint32_t i = 0; i < header->hook_count; i++) {
+		const Hook &hook = hooks[i];
+		for (uint32_t string : {hook.action, hook.scene, hook.source, hook.filter, hook.transition, hook.item, hook.hotkey, hook.audio_source,
+					hook.media_source, hook.scene_collection, hook.profile, hook.string_override}) {
+			if (!valid_string(string))
+				return false;
+		}
+	}
+	return true;
+}
+void MappingCache::close()
+{
+	if (map)
+		file.unmap((uchar *)map);
+	file.close();
+	map = nullptr;
+	map_size = 0;
+	header = nullptr;
+	string_offsets = nullptr;
+	string_bytes = nullptr;
+	devices = nullptr;
+	hooks = nullptr;
+}
+bool MappingCache::get_debug_mode() const
+{
+	return header && header->debug_mode;
+}
+uint32_t MappingCache::get_device_count() const
+{
+	return header ? header->device_count : 0;
+}
+uint32_t MappingCache::get_hook_count() const
+{
+	return header ? header->hook_count : 0;
+}
+const MappingCache::Device &MappingCache::get_device(uint32_t index) const
+{
+	return devices[index];
+}
+const MappingCache::Hook &MappingCache::get_hook(uint32_t index) const
+{
+	return hooks[index];
+}
+QString MappingCache::get_string(uint32_t index) const
+{
+	if (index == 0)
+		return QString();
+	return QString::fromUtf8(string_bytes + string_offsets[index], (int)(string_offsets[index + 1] - string_offsets[index]));
+}
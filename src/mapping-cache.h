@@ -0,0 +1,138 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+
+/*
+ * Mapping Cache
+ * Binary sidecar of a config file holding its device and hook tables already compiled:
+ * fixed size records that refer to one table of interned strings.
+ * At startup it is memory mapped and the devices are built straight from the records,
+ * as long as the checksum it was written with matches the JSON file, which stays the
+ * source of truth. It is written again after every save.
+ *
+ * Layout: Header, string offsets (string_count + 1), string bytes padded to 4,
+ * Device records, Hook records. Native byte order, the version is bumped on any change.
+ */
+class MappingCache {
+public:
+	static constexpr uint32_t version = 1;
+	enum DeviceFlags : uint32_t { Enabled = 1, Bidirectional = 2, RealtimeDispatch = 4, OutputBatching = 8, OutputRunningStatus = 16 };
+	enum HookFlags : uint32_t { BoolOverride = 1, HasRangeMin = 2, HasRangeMax = 4, ValueAsFilter = 8, Coalesce = 16 };
+	// Strings are indices into the string table, 0 is the empty string
+	struct Device {
+		uint32_t name;
+		uint32_t outname;
+		uint32_t reset_sysex; // as saved, in hex
+		uint32_t flags;
+		int32_t dispatch_cpu;
+		uint32_t output_bytes_per_second;
+		uint32_t first_hook;
+		uint32_t hook_count;
+	};
+	struct Hook {
+		int32_t channel;
+		int32_t message_type;
+		int32_t norc;
+		uint32_t action; // enum name
+		uint32_t scene;
+		uint32_t source;
+		uint32_t filter;
+		uint32_t transition;
+		uint32_t item;
+		uint32_t hotkey;
+		uint32_t audio_source;
+		uint32_t media_source;
+		uint32_t scene_collection;
+		uint32_t profile;
+		uint32_t string_override;
+		int32_t duration;
+		int32_t int_override;
+		int32_t range_min;
+		int32_t range_max;
+		int32_t value;
+		uint32_t flags;
+	};
+	/*
+	 * Collects the records and interns their strings, filled by the agents and hooks on save
+	 */
+	class Builder {
+	public:
+		Builder();
+		uint32_t intern(const QString &string);
+		// Records the hooks added since the previous device
+		void add_device(Device device);
+		void add_hook(const Hook &hook);
+		// The image to write, without the checksum of the JSON it goes with
+		QByteArray finish(bool debug_mode) const;
+
+	private:
+		QHash<QString, uint32_t> string_index;
+		std::vector<QByteArray> strings;
+		std::vector<Device> devices;
+		std::vector<Hook> hooks;
+		uint32_t device_first_hook = 0;
+	};
+
+	MappingCache() = default;
+	~MappingCache();
+	MappingCache(const MappingCache &) = delete;
+	MappingCache &operator=(const MappingCache &) = delete;
+	static uint64_t checksum(const char *data, size_t size);
+	// Stamps image with the checksum of json and replaces the file at path
+	static bool write(QByteArray image, const QByteArray &json, const QString &path);
+	// Maps path, false if it is missing, damaged, of another version or not made from json
+	bool open(const QString &path, const QByteArray &json);
+	void close();
+	bool get_debug_mode() const;
+	uint32_t get_device_count() const;
+	uint32_t get_hook_count() const;
+	const Device &get_device(uint32_t index) const;
+	const Hook &get_hook(uint32_t index) const;
+	QString get_string(uint32_t index) const;
+
+private:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t device_size;
+		uint32_t hook_size;
+		uint32_t debug_mode;
+		uint64_t json_size;
+		uint64_t json_checksum;
+		uint64_t body_checksum;
+		uint32_t string_count;
+		uint32_t string_bytes;
+		uint32_t device_count;
+		uint32_t hook_count;
+	};
+	static constexpr char magic[8] = {'O', 'B', 'S', 'M', 'I', 'D', 'I', 'C'};
+	static size_t padded(size_t size) { return (size + 3) & ~size_t(3); }
+	bool validate(const QByteArray &json);
+	QFile file;
+	const uchar *map = nullptr;
+	qint64 map_size = 0;
+	const Header *header = nullptr;
+	const uint32_t *string_offsets = nullptr;
+	const char *string_bytes = nullptr;
+	const Device *devices = nullptr;
+	const Hook *hooks = nullptr;
+};
@@ -11,10 +11,18 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <functional>
 #include <string>
 #include <utility>
+#include <QtCore/QByteArray>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QSet>
 #include <QtCore/QTime>
+#include <QtCore/QVarLengthArray>
+#include <util/platform.h>
 #include "utils.h"
 #include "midi-agent.h"
 #include "obs-midi.h"
@@ -22,6 +30,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "config.h"
 #include "device-manager.h"
 #include "macro-helpers.h"
+#include "source-cache.h"
 using namespace std;
 ////////////////
 // MIDI AGENT //
@@ -41,22 +50,13 @@ MidiAgent::MidiAgent(const int &in_port, std::optional<int> out_port)
 	set_callbacks();
 }
 /// <summary>
-/// Creates a Midi Agent from saved devices
+/// Creates an empty Midi Agent for a saved device.
+/// The Device Manager loads its settings and hooks, sets the callbacks and opens its ports in stages.
 /// </summary>
-/// <param name="midiData"></param>
-MidiAgent::MidiAgent(const char *midiData)
+MidiAgent::MidiAgent()
 {
 	// Sets the parent of this instance of MidiAgent to Device Manager
 	this->setParent(GetDeviceManager().get());
-	// Sets the Midi Callback function
-	this->Load(midiData);
-	if (is_device_attached(midiData)) {
-		set_callbacks();
-		if (enabled)
-			open_midi_input_port();
-		if (bidirectional)
-			open_midi_output_port();
-	}
 }
 /// <summary>
 ///  Sets the callbacks for
@@ -66,10 +66,26 @@ MidiAgent::MidiAgent(const char *midiData)
 /// </summary>
 void MidiAgent::set_callbacks()
 {
+	// Agents made after OBS finished loading will never see LoadingFinished
+	loading = !GetEventsSystem()->is_started();
 	connect(GetEventsSystem().get(), &Events::obsEvent, this, &MidiAgent::handle_obs_event);
 	midiin.set_callback([this](const auto &message) { HandleInput(message, this); });
 	midiin.set_error_callback([this](const auto &error_type, const auto &error_message) { HandleError(error_type, error_message, this); });
 	midiout.set_error_callback([this](const auto &error_type, const auto &error_message) { HandleError(error_type, error_message, this); });
+	output_writer.set_multi_message_writes(backend_takes_multi_message_writes(midiout.get_current_api()));
+	start_dispatcher();
+	output_writer.start();
+}
+/// <summary>
+/// Whether one send_message() may hold several channel messages on this backend.
+/// Only CoreMIDI packet lists are documented to, JACK events and the ALSA sequencer encoder take one message each
+/// and WinMM takes anything longer than a short message as sysex.
+/// </summary>
+/// <param name="api"></param>
+/// <returns></returns>
+bool MidiAgent::backend_takes_multi_message_writes(libremidi::API api)
+{
+	return api == libremidi::API::MACOSX_CORE;
 }
 /// <summary>
 /// MidiAgent Deconstructor
@@ -77,48 +93,169 @@ void MidiAgent::set_callbacks()
 MidiAgent::~MidiAgent()
 {
 	this->disconnect();
-	clear_MidiHooks();
 	midiin.cancel_callback();
+	stop_dispatcher();
+	output_writer.stop();
+	clear_MidiHooks();
+	collect_retired_hooks();
 }
 /// <summary>
-/// Checks wether a device is attached and in the device list;
+/// Takes over the settings and hooks of another profile or scene collection for the same device.
+/// Ports that stay the same are left open, so the controller keeps working through the switch.
 /// </summary>
-/// <param name="incoming_data"></param>
-/// <returns></returns>
-bool MidiAgent::is_device_attached(const char *incoming_data)
+/// <param name="data">The device's entry in the new config</param>
+/// <param name="hooks">Hooks kept from an earlier visit to that config, instead of loading them again</param>
+/// <returns>The hooks the agent had, still alive: keep them or pass them to retire_midi_hooks()</returns>
+QVector<MidiHook *> MidiAgent::swap_config(obs_data_t *data, std::optional<QVector<MidiHook *>> hooks)
 {
-	obs_data_t *data = obs_data_create_from_json(incoming_data);
-	const int minput_port = DeviceManager().get_input_port_number(obs_data_get_string(data, "name"));
-	obs_data_release(data);
-	return (minput_port != -1);
+	const QString previous_output = midi_output_name;
+	load_settings(data);
+	QVector<MidiHook *> old_hooks = swap_midi_hooks(hooks ? *hooks : load_hooks(data));
+	update_ports_for_settings(previous_output);
+	return old_hooks;
 }
 /// <summary>
-/// Loads information from OBS data. (recalled from Config)
+/// swap_config() from a mapping cache record
+/// </summary>
+QVector<MidiHook *> MidiAgent::swap_config(const MappingCache &cache, const MappingCache::Device &device, std::optional<QVector<MidiHook *>> hooks)
+{
+	const QString previous_output = midi_output_name;
+	load_settings(cache, device);
+	QVector<MidiHook *> old_hooks = swap_midi_hooks(hooks ? *hooks : load_hooks(cache, device));
+	update_ports_for_settings(previous_output);
+	return old_hooks;
+}
+/// <summary>
+/// Device settings from the config, hooks are loaded by load_hooks().
 /// This will not enable the MidiAgent or open the port. (and shouldn't)
 /// </summary>
-/// <param name="incoming_data"></param>
-void MidiAgent::Load(const char *incoming_data)
+/// <param name="data">The device's entry in the config</param>
+void MidiAgent::load_settings(obs_data_t *data)
 {
-	obs_data_t *data = obs_data_create_from_json(incoming_data);
 	obs_data_set_default_bool(data, "enabled", false);
 	obs_data_set_default_bool(data, "bidirectional", false);
+	obs_data_set_default_bool(data, "realtime_dispatch", false);
+	obs_data_set_default_int(data, "dispatch_cpu", -1);
+	obs_data_set_default_bool(data, "output_batching", false);
+	obs_data_set_default_bool(data, "output_running_status", false);
+	obs_data_set_default_int(data, "output_bytes_per_second", 0);
+	obs_data_set_default_string(data, "reset_sysex", "");
 	midi_input_name = QString(obs_data_get_string(data, "name"));
 	midi_output_name = QString(obs_data_get_string(data, "outname"));
-	input_port = DeviceManager().get_input_port_number(midi_input_name);
-	output_port = DeviceManager().get_output_port_number(midi_output_name);
+	resolve_ports();
 	enabled = obs_data_get_bool(data, "enabled");
 	bidirectional = obs_data_get_bool(data, "bidirectional");
+	realtime_dispatch = obs_data_get_bool(data, "realtime_dispatch");
+	dispatch_cpu = (int)obs_data_get_int(data, "dispatch_cpu");
+	MidiOutputWriter::Options output_options;
+	output_options.batching = obs_data_get_bool(data, "output_batching");
+	output_options.running_status = obs_data_get_bool(data, "output_running_status");
+	output_options.bytes_per_second = (uint32_t)std::max<long long>(0, obs_data_get_int(data, "output_bytes_per_second"));
+	output_writer.set_options(output_options);
+	set_reset_sysex(obs_data_get_string(data, "reset_sysex"));
+}
+/// <summary>
+/// Device settings from a mapping cache record, same fields and defaults as the obs_data one
+/// </summary>
+void MidiAgent::load_settings(const MappingCache &cache, const MappingCache::Device &device)
+{
+	midi_input_name = cache.get_string(device.name);
+	midi_output_name = cache.get_string(device.outname);
+	resolve_ports();
+	enabled = device.flags & MappingCache::Enabled;
+	bidirectional = device.flags & MappingCache::Bidirectional;
+	realtime_dispatch = device.flags & MappingCache::RealtimeDispatch;
+	dispatch_cpu = device.dispatch_cpu;
+	MidiOutputWriter::Options output_options;
+	output_options.batching = device.flags & MappingCache::OutputBatching;
+	output_options.running_status = device.flags & MappingCache::OutputRunningStatus;
+	output_options.bytes_per_second = device.output_bytes_per_second;
+	output_writer.set_options(output_options);
+	set_reset_sysex(cache.get_string(device.reset_sysex));
+}
+/// <summary>
+/// Builds the device's hooks from the config, not added to the agent yet.
+/// May run on a pool thread at startup, it only touches the hooks it builds and migrated_hooks.
+/// </summary>
+/// <param name="data">The device's entry in the config</param>
+/// <returns></returns>
+QVector<MidiHook *> MidiAgent::load_hooks(obs_data_t *data)
+{
+	QVector<MidiHook *> hooks;
+	migrated_hooks = false;
 	obs_data_array_t *hooksData = obs_data_get_array(data, "hooks");
 	const size_t hooksCount = obs_data_array_count(hooksData);
+	hooks.reserve((int)hooksCount);
 	for (size_t i = 0; i < hooksCount; i++) {
 		obs_data_t *hookData = obs_data_array_item(hooksData, i);
-		auto *mh = new MidiHook(obs_data_get_json(hookData));
-
-		add_MidiHook(std::move(mh));
+		auto *mh = new MidiHook(hookData);
+		migrated_hooks |= mh->action_migrated;
+		hooks.push_back(mh);
 		obs_data_release(hookData);
 	}
 	obs_data_array_release(hooksData);
-	obs_data_release(data);
+	return hooks;
+}
+/// <summary>
+/// Builds the device's hooks from its mapping cache record, not added to the agent yet
+/// </summary>
+QVector<MidiHook *> MidiAgent::load_hooks(const MappingCache &cache, const MappingCache::Device &device)
+{
+	QVector<MidiHook *> hooks;
+	migrated_hooks = false;
+	hooks.reserve((int)device.hook_count);
+	for (uint32_t i = 0; i < device.hook_count; i++) {
+		auto *mh = new MidiHook(cache, cache.get_hook(device.first_hook + i));
+		migrated_hooks |= mh->action_migrated;
+		hooks.push_back(mh);
+	}
+	return hooks;
+}
+/// <summary>
+/// Looks the port numbers of the device's names up in the Device Manager's port snapshot
+/// </summary>
+void MidiAgent::resolve_ports()
+{
+	input_port = GetDeviceManager()->get_input_port_number(midi_input_name);
+	output_port = GetDeviceManager()->get_output_port_number(midi_output_name);
+}
+/// <summary>
+/// Opens and closes ports after the settings changed under a running agent.
+/// Ports that were open and are still wanted stay open.
+/// </summary>
+/// <param name="previous_output">Output name before the change, its port is reopened if it differs</param>
+void MidiAgent::update_ports_for_settings(const QString &previous_output)
+{
+	if (midi_output_name != previous_output)
+		close_midi_output_port();
+	if (!enabled)
+		close_midi_input_port();
+	else if (input_port != -1)
+		open_midi_input_port();
+	if (!bidirectional)
+		close_midi_output_port();
+	else if (output_port != -1)
+		open_midi_output_port();
+}
+/// <summary>
+/// Sets the reset sysex from its hex form in the config, ignored unless it starts with F0 and ends with F7
+/// </summary>
+/// <param name="hex"></param>
+void MidiAgent::set_reset_sysex(const QString &hex)
+{
+	const QByteArray sysex = QByteArray::fromHex(hex.toLatin1());
+	reset_sysex.clear();
+	if (sysex.size() >= 2 && (unsigned char)sysex.front() == 0xF0 && (unsigned char)sysex.back() == 0xF7)
+		reset_sysex.assign(sysex.begin(), sysex.end());
+	else if (!sysex.isEmpty())
+		blog(LOG_WARNING, "Ignoring reset sysex for %s, it must start with F0 and end with F7", midi_input_name.qtocs());
+}
+/// <summary>
+/// True if Load found hooks saved with a translated action label
+/// </summary>
+bool MidiAgent::has_migrated_hooks() const
+{
+	return migrated_hooks;
 }
 /// <summary>
 /// Sets the input port number and name
@@ -153,7 +290,9 @@ void MidiAgent::open_midi_input_port()
 		} catch (const libremidi::system_error &error) {
 			blog(LOG_DEBUG, "Midi system Error %s", error.what());
 		}
-		blog(LOG_INFO, "MIDI device connected In: [%d] %s", input_port, midi_input_name.toStdString().c_str());
+		connected = midiin.is_port_open();
+		if (connected)
+			blog(LOG_INFO, "MIDI device connected In: [%d] %s", input_port, midi_input_name.toStdString().c_str());
 	}
 }
 /// <summary>
@@ -161,7 +300,10 @@ void MidiAgent::open_midi_input_port()
 /// </summary>
 void MidiAgent::open_midi_output_port()
 {
-	if (!midiout.is_port_open()) {
+	{
+		std::lock_guard<std::mutex> lock(output_mutex);
+		if (midiout.is_port_open())
+			return;
 		try {
 			midiout.open_port(output_port);
 		} catch (const libremidi::midi_exception &error) {
@@ -171,7 +313,12 @@ void MidiAgent::open_midi_output_port()
 		} catch (const libremidi::system_error &error) {
 			blog(LOG_DEBUG, "Midi system Error %s", error.what());
 		}
+		if (!midiout.is_port_open())
+			return;
+		output_ready = true;
 	}
+	// A device that comes back may have lost what feedback had set on it
+	resync_feedback();
 }
 /// <summary>
 /// Closes both MIDI input and MIDI output ports
@@ -190,17 +337,90 @@ void MidiAgent::close_midi_input_port()
 	if (midiin.is_port_open()) {
 		midiin.close_port();
 	}
+	connected = false;
 }
 /// <summary>
 /// Closes the connection to the MIDI output port
 /// </summary>
 void MidiAgent::close_midi_output_port()
 {
+	std::lock_guard<std::mutex> lock(output_mutex);
+	output_ready = false;
 	if (midiout.is_port_open()) {
 		midiout.close_port();
 	}
 }
 /// <summary>
+/// Looks the devices up again after the MIDI ports changed. Ports of a device that went away are
+/// closed, as is a port whose number moved, since it may point at another device now.
+/// </summary>
+/// <returns>True if a port this agent wants is still closed, see reconnect()</returns>
+bool MidiAgent::update_ports()
+{
+	const int new_input_port = GetDeviceManager()->get_input_port_number(midi_input_name);
+	const int new_output_port = GetDeviceManager()->get_output_port_number(midi_output_name);
+	if (new_input_port != input_port) {
+		if (midiin.is_port_open()) {
+			close_midi_input_port();
+			if (new_input_port == -1)
+				blog(LOG_INFO, "MIDI device disconnected In: %s", midi_input_name.qtocs());
+		}
+		input_port = new_input_port;
+	}
+	if (new_output_port != output_port) {
+		bool was_open;
+		{
+			std::lock_guard<std::mutex> lock(output_mutex);
+			was_open = midiout.is_port_open();
+		}
+		if (was_open) {
+			close_midi_output_port();
+			if (new_output_port == -1)
+				blog(LOG_INFO, "MIDI device disconnected Out: %s, feedback paused", midi_output_name.qtocs());
+		}
+		output_port = new_output_port;
+	}
+	return needs_reconnect();
+}
+/// <summary>
+/// True if the agent is enabled (or bidirectional) and its device is there, but the port is not open
+/// </summary>
+/// <returns></returns>
+bool MidiAgent::needs_reconnect() const
+{
+	if (enabled && input_port != -1 && !midiin.is_port_open())
+		return true;
+	return bidirectional && output_port != -1 && !output_ready;
+}
+/// <summary>
+/// Opens the ports needs_reconnect() found closed. Feedback held back meanwhile is resynced.
+/// </summary>
+/// <returns>True if nothing is left to open</returns>
+bool MidiAgent::reconnect()
+{
+	if (enabled && input_port != -1)
+		open_midi_input_port();
+	if (bidirectional && output_port != -1)
+		open_midi_output_port();
+	return !needs_reconnect();
+}
+/// <summary>
+/// True until OBS has finished loading, the Device Manager opens the ports then
+/// </summary>
+/// <returns></returns>
+bool MidiAgent::is_loading() const
+{
+	return loading;
+}
+/// <summary>
+/// False while feedback is held back, because the output is closed or the device is gone
+/// </summary>
+/// <returns></returns>
+bool MidiAgent::is_output_ready() const
+{
+	return output_ready;
+}
+/// <summary>
 ///
 /// </summary>
 /// <returns></returns>
@@ -233,9 +453,7 @@ bool MidiAgent::set_bidirectional(const bool &state)
 {
 	this->bidirectional = state;
 	if (!state) {
-		if (midiout.is_port_open()) {
-			midiout.close_port();
-		}
+		close_midi_output_port();
 	} else {
 		open_midi_output_port();
 	}
@@ -251,6 +469,14 @@ int MidiAgent::GetPort() const
 	return input_port;
 }
 /// <summary>
+/// Id stamped on every MidiMessage coming from this device
+/// </summary>
+/// <returns></returns>
+uint16_t MidiAgent::get_device_id() const
+{
+	return device_id;
+}
+/// <summary>
 ///
 /// </summary>
 /// <returns></returns>
@@ -289,14 +515,233 @@ void MidiAgent::HandleInput(const libremidi::message &message, void *userData)
 	}
 	/*************Get Message parts***********/
 	self->sending = true;
-	auto *x = new MidiMessage();
-	x->set_message(message);
-	/***** Send Messages to emit function *****/
-	x->device_name = self->get_midi_input_name();
-	emit self->broadcast_midi_message((MidiMessage)*x);
-	/** check if hook exists for this note or cc norc and launch it **/
-	self->exe_midi_hook_if_exists(x);
-	delete x;
+	MidiMessage x;
+	x.set_message(message);
+	x.device_id = self->device_id;
+	// Backend timestamps are not on the os_gettime_ns() clock, and only deltas on some backends
+	x.received_ns = os_gettime_ns();
+	/** hand it to the dispatcher thread, hooks are never run on the driver thread **/
+	self->enqueue_message(x);
+}
+/// <summary>
+/// Pushes a decoded message to the ingest queue and wakes the dispatcher.
+/// Called on the MIDI driver thread only.
+/// </summary>
+/// <param name="message"></param>
+void MidiAgent::enqueue_message(const MidiMessage &message)
+{
+	if (!ingest_queue.push(message)) {
+		dropped_messages.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	const size_t depth = ingest_queue.size();
+	if (depth > queue_high_water.load(std::memory_order_relaxed))
+		queue_high_water.store(depth, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (dispatcher_sleeping.load()) {
+		std::lock_guard<std::mutex> lock(dispatcher_mutex);
+		dispatcher_wake.notify_one();
+	}
+}
+/// <summary>
+/// Starts the dispatcher thread that drains the ingest queue and runs hooks
+/// </summary>
+void MidiAgent::start_dispatcher()
+{
+	if (dispatcher.joinable())
+		return;
+	dispatcher_running = true;
+	dispatcher = std::thread(&MidiAgent::dispatch_loop, this);
+}
+/// <summary>
+/// Stops and joins the dispatcher thread, messages still queued are dropped
+/// </summary>
+void MidiAgent::stop_dispatcher()
+{
+	if (!dispatcher.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(dispatcher_mutex);
+		dispatcher_running = false;
+	}
+	dispatcher_wake.notify_one();
+	dispatcher.join();
+	blog(LOG_INFO, "MIDI dispatcher stopped for %s: queue high water %zu, dropped %llu, coalesced %llu", midi_input_name.qtocs(),
+	     get_queue_high_water(), (unsigned long long)get_dropped_messages(), (unsigned long long)get_coalesced_messages());
+	if (ingest_latency.get_count())
+		blog(LOG_INFO, "MIDI latency p50/p99/max for %s: %s", midi_input_name.qtocs(), get_latency_summary().qtocs());
+}
+/// <summary>
+/// Dispatcher thread body, drains the ingest queue in batches
+/// </summary>
+void MidiAgent::dispatch_loop()
+{
+	if (realtime_dispatch && !Utils::set_thread_realtime_priority())
+		blog(LOG_WARNING, "Could not raise MIDI dispatcher priority for %s", midi_input_name.qtocs());
+	if (dispatch_cpu >= 0 && !Utils::set_thread_affinity(dispatch_cpu))
+		blog(LOG_WARNING, "Could not pin MIDI dispatcher for %s to CPU %d", midi_input_name.qtocs(), dispatch_cpu);
+	std::array<MidiMessage, dispatch_batch_size> batch;
+	while (dispatcher_running.load()) {
+		const size_t count = ingest_queue.pop(batch.data(), batch.size());
+		if (count == 0) {
+			std::unique_lock<std::mutex> lock(dispatcher_mutex);
+			dispatcher_sleeping.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			dispatcher_wake.wait_for(lock, std::chrono::milliseconds(100),
+						 [this] { return !ingest_queue.empty() || !dispatcher_running.load(); });
+			dispatcher_sleeping.store(false);
+			continue;
+		}
+		dispatch_epoch.fetch_add(1);
+		dispatch_batch(batch.data(), count);
+		dispatch_epoch.fetch_add(1);
+	}
+}
+/// <summary>
+/// Runs the hooks for one batch of messages in arrival order.
+/// Anything that piled up while the previous batch ran lands in the same batch, so a
+/// coalescing hook hit several times only runs once, with the newest value, at its last position.
+/// Records the latencies: callback to hook match per message, match to action start and action run time per hook.
+/// </summary>
+/// <param name="messages"></param>
+/// <param name="count"></param>
+void MidiAgent::dispatch_batch(const MidiMessage *messages, size_t count)
+{
+	struct PendingHook {
+		MidiHook *hook;
+		int value;
+	};
+	static const QMetaMethod broadcast_signal = QMetaMethod::fromSignal(&MidiAgent::broadcast_midi_message);
+	if (isSignalConnected(broadcast_signal)) {
+		for (size_t i = 0; i < count; i++)
+			emit broadcast_midi_message(messages[i]);
+	}
+	QVarLengthArray<PendingHook, dispatch_batch_size> pending;
+	{
+		std::lock_guard<std::mutex> lock(hooks_mutex);
+		for (size_t i = 0; i < count; i++) {
+			const MidiMessage &message = messages[i];
+			const auto *bucket = hook_index.find_bucket(message.message_type, message.channel, message.NORC);
+			if (!bucket)
+				continue;
+			if (const auto *filtered = bucket->filtered_by(message.value)) {
+				for (auto hook : *filtered)
+					pending.append({hook, message.value});
+			}
+			for (auto hook : bucket->hooks)
+				pending.append({hook, message.value});
+		}
+	}
+	const uint64_t matched_ns = os_gettime_ns();
+	for (size_t i = 0; i < count; i++) {
+		if (messages[i].received_ns)
+			ingest_latency.record(matched_ns > messages[i].received_ns ? matched_ns - messages[i].received_ns : 0);
+	}
+	// Walk backwards so the newest value of each coalescing hook is the one kept
+	QVarLengthArray<MidiHook *, 16> kept;
+	uint64_t coalesced = 0;
+	for (int i = pending.size() - 1; i >= 0; i--) {
+		MidiHook *hook = pending[i].hook;
+		if (!hook->coalesce)
+			continue;
+		if (std::find(kept.cbegin(), kept.cend(), hook) != kept.cend()) {
+			pending[i].hook = nullptr;
+			coalesced++;
+		} else {
+			kept.append(hook);
+		}
+	}
+	if (coalesced)
+		coalesced_messages.fetch_add(coalesced, std::memory_order_relaxed);
+	uint64_t now = os_gettime_ns();
+	for (const auto &entry : pending) {
+		if (!entry.hook)
+			continue;
+		dispatch_latency.record(now - matched_ns);
+		execute_hook(entry.hook, entry.value);
+		const uint64_t done = os_gettime_ns();
+		execute_latency.record(done - now);
+		now = done;
+	}
+}
+/// <summary>
+/// Name of the action of a hook for logs, as it was loaded when it did not resolve
+/// </summary>
+static QString hook_action_name(const MidiHook *hook)
+{
+	return hook->action ? ActionsClass::action_to_string(*hook->action) : hook->action_string;
+}
+/// <summary>
+/// Runs a single hook with the value of the message that triggered it.
+/// Actions throw when their target is missing, which must not end the dispatch thread.
+/// </summary>
+/// <param name="hook"></param>
+/// <param name="value"></param>
+void MidiAgent::execute_hook(MidiHook *hook, int value)
+{
+	if (!hook->value_as_filter)
+		hook->value.emplace(value);
+	try {
+		hook->EXE();
+	} catch (const char *error) {
+		blog(LOG_WARNING, "Action %s failed: %s", qtocs(hook_action_name(hook)), error);
+	} catch (const std::exception &error) {
+		blog(LOG_WARNING, "Action %s failed: %s", qtocs(hook_action_name(hook)), error.what());
+	} catch (...) {
+		blog(LOG_WARNING, "Action %s failed", qtocs(hook_action_name(hook)));
+	}
+}
+size_t MidiAgent::get_queue_depth() const
+{
+	return ingest_queue.size();
+}
+size_t MidiAgent::get_queue_high_water() const
+{
+	return queue_high_water.load(std::memory_order_relaxed);
+}
+uint64_t MidiAgent::get_dropped_messages() const
+{
+	return dropped_messages.load(std::memory_order_relaxed);
+}
+uint64_t MidiAgent::get_coalesced_messages() const
+{
+	return coalesced_messages.load(std::memory_order_relaxed);
+}
+const MidiOutputWriter &MidiAgent::get_output_writer() const
+{
+	return output_writer;
+}
+const LatencyHistogram &MidiAgent::get_ingest_latency() const
+{
+	return ingest_latency;
+}
+const LatencyHistogram &MidiAgent::get_dispatch_latency() const
+{
+	return dispatch_latency;
+}
+const LatencyHistogram &MidiAgent::get_execute_latency() const
+{
+	return execute_latency;
+}
+/// <summary>
+/// p50/p99/max of each latency in microseconds, for the log and the diagnostics
+/// </summary>
+/// <returns></returns>
+QString MidiAgent::get_latency_summary() const
+{
+	const auto format = [](const char *name, const LatencyHistogram &histogram) {
+		const LatencyHistogram::Summary summary = histogram.summary();
+		return QString("%1 %2/%3/%4 us (%5)")
+			.arg(name)
+			.arg(summary.p50_ns / 1000.0, 0, 'f', 1)
+			.arg(summary.p99_ns / 1000.0, 0, 'f', 1)
+			.arg(summary.max_ns / 1000.0, 0, 'f', 1)
+			.arg(summary.count);
+	};
+	return QString("%1, %2, %3")
+		.arg(format("ingest", ingest_latency))
+		.arg(format("dispatch", dispatch_latency))
+		.arg(format("execute", execute_latency));
 }
 /// <summary>
 /// Callback function to handle midi errors
@@ -320,46 +765,37 @@ QVector<MidiHook *> MidiAgent::GetMidiHooks() const
 	return midiHooks;
 }
 /// <summary>
-/// Returns a MidiHook* if Message Type, NORC and Channel are found
+/// Event types this device gives feedback for
 /// </summary>
-/// <param name="message">MidiMessage</param>
-/// <returns>MidiHook*</returns>
-MidiHook *MidiAgent::get_midi_hook_if_exists(MidiMessage *message)
-{
-	for (auto midiHook : this->midiHooks) {
-		if (midiHook->message_type == message->message_type && midiHook->norc == message->NORC && midiHook->channel == message->channel) {
-			if (midiHook->value_as_filter) {
-				if (message->value == midiHook->value)
-					return midiHook;
-			} else
-				return midiHook;
-		}
-	}
-	return nullptr;
+QList<RpcEvent::Type> MidiAgent::get_feedback_events() const
+{
+	return feedback_index.event_types();
 }
 /// <summary>
-/// Executes a MidiHook* if Message Type, NORC and Channel are found
+/// Lets the events system drop or pick up the OBS events the hooks need
+/// </summary>
+void MidiAgent::feedback_changed()
+{
+	if (auto events = GetEventsSystem())
+		events->request_subscription_update();
+}
+/// <summary>
+/// Returns the first MidiHook* mapped to Message Type, NORC and Channel.
+/// Without a value any hook on that control is returned, which is what duplicate checks need.
 /// </summary>
-/// <param name="message">MidiMessage</param>
 /// <returns>MidiHook*</returns>
-void MidiAgent::exe_midi_hook_if_exists(MidiMessage *message)
-{
-	for (auto midiHook : this->midiHooks) {
-		if (midiHook->message_type == message->message_type && midiHook->norc == message->NORC && midiHook->channel == message->channel) {
-			if (midiHook->value_as_filter) {
-				if (message->value == *midiHook->value)
-					midiHook->EXE();
-			} else {
-				midiHook->value.emplace(message->value);
-				midiHook->EXE();
-			}
-		}
-	}
+MidiHook *MidiAgent::find_midi_hook(MidiMessageType message_type, int channel, int norc, std::optional<int> value) const
+{
+	return hook_index.find(message_type, channel, norc, value);
 }
 void MidiAgent::add_MidiHook(MidiHook *hook)
 {
 	// Add a new MidiHook
+	std::lock_guard<std::mutex> lock(hooks_mutex);
 	midiHooks.push_back(hook);
+	hook_index.add(hook);
+	feedback_index.add(hook);
+	feedback_changed();
 }
 /// <summary>
 /// Sets wether or not this Midi Agent is enabled
@@ -380,7 +816,36 @@ void MidiAgent::set_enabled(const bool &state)
 /// <param name="mh">Midi Hooks </param>
 void MidiAgent::set_midi_hooks(QVector<MidiHook *> mh)
 {
-	midiHooks = std::move(mh);
+	QVector<MidiHook *> old_hooks = swap_midi_hooks(std::move(mh));
+	old_hooks.erase(std::remove_if(old_hooks.begin(), old_hooks.end(), [this](MidiHook *hook) { return midiHooks.contains(hook); }), old_hooks.end());
+	retire_midi_hooks(old_hooks);
+}
+/// <summary>
+/// Replaces current MidiHooks in one step, the dispatcher sees either table whole
+/// </summary>
+/// <param name="mh">Midi Hooks</param>
+/// <returns>The previous hooks, not deleted, the dispatcher may still be running one of them</returns>
+QVector<MidiHook *> MidiAgent::swap_midi_hooks(QVector<MidiHook *> mh)
+{
+	QVector<MidiHook *> old_hooks;
+	{
+		std::lock_guard<std::mutex> lock(hooks_mutex);
+		old_hooks = std::exchange(midiHooks, std::move(mh));
+		hook_index.rebuild(midiHooks);
+		feedback_index.rebuild(midiHooks);
+	}
+	feedback_changed();
+	return old_hooks;
+}
+/// <summary>
+/// Deletes hooks that are out of the table as soon as the dispatcher is done with them
+/// </summary>
+/// <param name="hooks"></param>
+void MidiAgent::retire_midi_hooks(const QVector<MidiHook *> &hooks)
+{
+	for (auto hook : hooks)
+		retire_hook(hook);
+	collect_retired_hooks();
 }
 /// <summary>
 /// Remove a midi hook
@@ -390,15 +855,44 @@ void MidiAgent::set_midi_hooks(QVector<MidiHook *> mh)
 void MidiAgent::remove_MidiHook(MidiHook *hook)
 {
 	// Remove a MidiHook
-	if (midiHooks.contains(hook)) {
+	{
+		std::lock_guard<std::mutex> lock(hooks_mutex);
+		if (!midiHooks.contains(hook))
+			return;
+		hook_index.remove(hook);
+		feedback_index.remove(hook);
 		midiHooks.removeOne(hook);
-		delete (hook);
 	}
+	feedback_changed();
+	retire_hook(hook);
+	collect_retired_hooks();
 }
+/// <summary>
+/// Swaps a hook for its edited copy in place, the old hook and its executor are retired.
+/// No other hook is touched.
+/// </summary>
+/// <param name="old_hook"></param>
+/// <param name="new_hook"></param>
 void MidiAgent::edit_midi_hook(MidiHook *old_hook, MidiHook *new_hook)
 {
-	remove_MidiHook(old_hook);
-	add_MidiHook(new_hook);
+	int position;
+	{
+		std::lock_guard<std::mutex> lock(hooks_mutex);
+		position = midiHooks.indexOf(old_hook);
+		if (position == -1) {
+			midiHooks.push_back(new_hook);
+		} else {
+			hook_index.remove(old_hook);
+			feedback_index.remove(old_hook);
+			midiHooks[position] = new_hook;
+		}
+		hook_index.add(new_hook);
+		feedback_index.add(new_hook);
+	}
+	feedback_changed();
+	if (position != -1)
+		retire_hook(old_hook);
+	collect_retired_hooks();
 }
 /// <summary>
 /// Clears all the MidiHooks for this device.
@@ -406,321 +900,181 @@ void MidiAgent::edit_midi_hook(MidiHook *old_hook, MidiHook *new_hook)
 /// </summary>
 void MidiAgent::clear_MidiHooks()
 {
-	for (auto hook:midiHooks) {
-		delete hook;
+	QVector<MidiHook *> old_hooks;
+	{
+		std::lock_guard<std::mutex> lock(hooks_mutex);
+		hook_index.clear();
+		feedback_index.clear();
+		old_hooks = std::exchange(midiHooks, {});
+	}
+	feedback_changed();
+	for (auto hook : old_hooks) {
+		retire_hook(hook);
+	}
+	collect_retired_hooks();
+}
+/// <summary>
+/// Queues a hook for deletion once the dispatcher can no longer be running it.
+/// The hook must already be out of the index.
+/// </summary>
+/// <param name="hook"></param>
+void MidiAgent::retire_hook(MidiHook *hook)
+{
+	retired_hooks.push_back(qMakePair(hook, dispatch_epoch.load()));
+}
+/// <summary>
+/// Deletes retired hooks the dispatcher is done with.
+/// A hook retired while the dispatcher was idle (even epoch) is safe right away,
+/// one retired during a batch (odd epoch) is safe as soon as that batch ended.
+/// </summary>
+void MidiAgent::collect_retired_hooks()
+{
+	const uint64_t epoch = dispatch_epoch.load();
+	for (int i = retired_hooks.size() - 1; i >= 0; i--) {
+		const auto &retired = retired_hooks.at(i);
+		if ((retired.second % 2) == 0 || epoch != retired.second || !dispatcher.joinable()) {
+			delete retired.first;
+			retired_hooks.remove(i);
+		}
 	}
-	midiHooks.clear();
 }
 /// <summary>
 /// Get this MidiAgent state as OBS Data. (includes midi hooks)
 /// *This is needed to Serialize the state in the config.*
 /// https://obsproject.com/docs/reference-settings.html
+/// Written straight into the device's entry, the hooks into an array of it.
 /// </summary>
-/// <returns>QString (OBSData Json string)</returns>
-QString MidiAgent::GetData()
+/// <param name="data">The device's entry in the config</param>
+void MidiAgent::GetData(obs_data_t *data) const
 {
-	blog(LOG_DEBUG, "MA::GetData");
-	obs_data_t *data = obs_data_create();
 	obs_data_set_string(data, "name", midi_input_name.toStdString().c_str());
 	obs_data_set_string(data, "outname", midi_output_name.toStdString().c_str());
 	obs_data_set_bool(data, "enabled", enabled);
 	obs_data_set_bool(data, "bidirectional", bidirectional);
+	obs_data_set_bool(data, "realtime_dispatch", realtime_dispatch);
+	obs_data_set_int(data, "dispatch_cpu", dispatch_cpu);
+	const MidiOutputWriter::Options output_options = output_writer.get_options();
+	obs_data_set_bool(data, "output_batching", output_options.batching);
+	obs_data_set_bool(data, "output_running_status", output_options.running_status);
+	obs_data_set_int(data, "output_bytes_per_second", output_options.bytes_per_second);
+	obs_data_set_string(data, "reset_sysex", QByteArray((const char *)reset_sysex.data(), (int)reset_sysex.size()).toHex(' ').toUpper().constData());
 	obs_data_array_t *arrayData = obs_data_array_create();
 	for (auto midiHook : midiHooks) {
-		obs_data_t *hookData = obs_data_create_from_json(midiHook->GetData().toStdString().c_str());
+		obs_data_t *hookData = obs_data_create();
+		midiHook->GetData(hookData);
 		obs_data_array_push_back(arrayData, hookData);
 		obs_data_release(hookData);
 	}
 	obs_data_set_array(data, "hooks", arrayData);
-	QString return_data(obs_data_get_json(data));
 	obs_data_array_release(arrayData);
-	obs_data_release(data);
-	return return_data;
-}
-/// <summary>
-/// Get Midi Hook, For use with events
-/// </summary>
-/// <param name="event"></param>
-/// <returns>MidiHook *</returns>
-MidiHook *MidiAgent::get_midi_hook_if_exists(const RpcEvent &event) const
-{
-	for (auto hook: this->midiHooks) {
-		bool found = false;
-		switch (ActionsClass::string_to_action(Utils::untranslate(hook->action))) {
-		case ActionsClass::Actions::Set_Volume:
-			found = (hook->audio_source == QString(obs_data_get_string(event.additionalFields(), "sourceName")) &&
-				 event.updateType() == "SourceVolumeChanged");
-			break;
-		case ActionsClass::Actions::Toggle_Mute:
-			found = (hook->audio_source == QString(obs_data_get_string(event.additionalFields(), "sourceName")) &&
-				 event.updateType() == "SourceMuteStateChanged");
-			break;
-		case ActionsClass::Actions::Do_Transition:
-		case ActionsClass::Actions::Set_Preview_Scene:
-		case ActionsClass::Actions::Set_Current_Scene:
-			found = (hook->scene == QString(obs_data_get_string(event.additionalFields(), "scene-name")));
-			break;
-		case ActionsClass::Actions::Toggle_Start_Stop_Recording:
-		case ActionsClass::Actions::Start_Recording:
-		case ActionsClass::Actions::Stop_Recording:
-			found = ((event.updateType() == "RecordingStarted") || (event.updateType() == "RecordingStopped") ||
-				 (event.updateType() == "RecordingStopping"));
-			break;
-		case ActionsClass::Actions::Toggle_Start_Stop_Streaming:
-		case ActionsClass::Actions::Start_Streaming:
-		case ActionsClass::Actions::Stop_Streaming:
-			found = ((event.updateType() == "StreamStarted") || (event.updateType() == "StreamStopped") ||
-				 (event.updateType() == "StreamStopping"));
-			break;
-		case ActionsClass::Actions::Disable_Preview:
-
-			break;
-		case ActionsClass::Actions::Disable_Source_Filter:
-
-			break;
-
-		case ActionsClass::Actions::Enable_Preview:
-
-			break;
-		case ActionsClass::Actions::Enable_Source_Filter:
-
-			break;
-		case ActionsClass::Actions::Move_T_Bar:
-
-			break;
-		case ActionsClass::Actions::Next_Media:
-
-			break;
-		case ActionsClass::Actions::Pause_Recording:
-
-			break;
-		case ActionsClass::Actions::Play_Pause_Media:
-
-			break;
-		case ActionsClass::Actions::Previous_Media:
-
-			break;
-		case ActionsClass::Actions::Reload_Browser_Source:
-
-			break;
-		case ActionsClass::Actions::Reset_Scene_Item:
-
-			break;
-		case ActionsClass::Actions::Reset_Stats:
-
-			break;
-		case ActionsClass::Actions::Restart_Media:
-
-			break;
-		case ActionsClass::Actions::Resume_Recording:
-
-			break;
-		case ActionsClass::Actions::Save_Replay_Buffer:
-
-			break;
-		case ActionsClass::Actions::Scrub_Media:
-
-			break;
-		case ActionsClass::Actions::Set_Audio_Monitor_Type:
-
-			break;
-		case ActionsClass::Actions::Set_Browser_Source_URL:
-
-			break;
-		case ActionsClass::Actions::Set_Current_Profile:
-
-			break;
-		case ActionsClass::Actions::Set_Current_Scene_Collection:
-
-			break;
-		case ActionsClass::Actions::Set_Current_Transition:
-
-			break;
-		case ActionsClass::Actions::Set_Gain_Filter:
-
-			break;
-		case ActionsClass::Actions::Set_Media_Time:
-
-			break;
-		case ActionsClass::Actions::Set_Mute:
-
-			break;
-		case ActionsClass::Actions::Set_Opacity:
-
-			break;
-		case ActionsClass::Actions::Set_Scene_Item_Crop:
-
-			break;
-		case ActionsClass::Actions::Set_Scene_Item_Position:
-
-			break;
-		case ActionsClass::Actions::Set_Scene_Item_Render:
-
-			break;
-		case ActionsClass::Actions::Set_Scene_Item_Transform:
-
-			break;
-		case ActionsClass::Actions::Set_Scene_Transition_Override:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Filter_Visibility:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Name:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Position:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Rotation:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Scale:
-
-			break;
-		case ActionsClass::Actions::Set_Source_Settings:
-
-			break;
-		case ActionsClass::Actions::Set_Sync_Offset:
-
-			break;
-		case ActionsClass::Actions::Set_Text_GDIPlus_Text:
-
-			break;
-		case ActionsClass::Actions::Set_Transition_Duration:
-
-			break;
-		case ActionsClass::Actions::Start_Replay_Buffer:
-
-			break;
-		case ActionsClass::Actions::Stop_Media:
-
-			break;
-		case ActionsClass::Actions::Stop_Replay_Buffer:
-
-			break;
-		case ActionsClass::Actions::Studio_Mode:
-
-			break;
-		case ActionsClass::Actions::Take_Screenshot:
-
-			break;
-		case ActionsClass::Actions::Take_Source_Screenshot:
-
-			break;
-		case ActionsClass::Actions::Toggle_Source_Filter:
-
-			break;
-		case ActionsClass::Actions::Toggle_Source_Visibility:
-
-			break;
-		case ActionsClass::Actions::Toggle_Start_Stop_Replay_Buffer:
-
-			break;
-		case ActionsClass::Actions::Unpause_Recording:
-
-			break;
-		}
-		if (found)
-			return hook;
-	}
-	return NULL;
+}
+/// <summary>
+/// Writes the device and its hooks as mapping cache records
+/// </summary>
+/// <param name="cache"></param>
+void MidiAgent::GetData(MappingCache::Builder &cache) const
+{
+	for (auto midiHook : midiHooks)
+		midiHook->GetData(cache);
+	MappingCache::Device device{};
+	device.name = cache.intern(midi_input_name);
+	device.outname = cache.intern(midi_output_name);
+	device.reset_sysex = cache.intern(QByteArray((const char *)reset_sysex.data(), (int)reset_sysex.size()).toHex(' ').toUpper());
+	const MidiOutputWriter::Options output_options = output_writer.get_options();
+	device.flags = (enabled ? MappingCache::Enabled : 0) | (bidirectional ? MappingCache::Bidirectional : 0) |
+		       (realtime_dispatch ? MappingCache::RealtimeDispatch : 0) | (output_options.batching ? MappingCache::OutputBatching : 0) |
+		       (output_options.running_status ? MappingCache::OutputRunningStatus : 0);
+	device.dispatch_cpu = dispatch_cpu;
+	device.output_bytes_per_second = output_options.bytes_per_second;
+	cache.add_device(device);
 }
 /*Handle OBS events*/
 void MidiAgent::handle_obs_event(const RpcEvent &event)
 {
-	blog(LOG_DEBUG, "OBS Event : %s \n AD: %s", event.updateType().toStdString().c_str(), obs_data_get_json(event.additionalFields()));
-	if (event.updateType() == "FinishedLoading") {
+	const RpcEvent::Type type = event.type();
+	// The obs_data view is only built when someone asked for debug output
+	if (GetConfig() && GetConfig()->DebugMode)
+		blog(LOG_DEBUG, "OBS Event : %s \n AD: %s", event.updateType().toStdString().c_str(), obs_data_get_json(event.additionalFields()));
+	if (type == RpcEvent::LoadingFinished)
 		loading = false;
-		return;
-	}
 	if (loading)
 		return;
-	MidiHook *hook = get_midi_hook_if_exists(event);
 
 	/// <summary>
-	/// 	ON EVENT TYPE Find matching hook, pull data from that hook, and do thing.
+	/// 	ON EVENT TYPE Look up the hooks indexed under (type, subject), and send their feedback.
 	/// </summary>
 	/// <param name="event"></param>
-	if (hook != NULL) {
-		MidiMessage *message = hook->get_message_from_hook();
-		switch (Events::string_to_event(event.updateType())) {
-		case Events::event_type::SourceVolumeChanged:
-			Macro::set_volume(this, message, obs_data_get_double(event.additionalFields(), "volume"));
-			break;
-		case Events::event_type::SwitchScenes:
-			Macro::swap_buttons(this, message, state::previous_scene_norc, hook->norc);
-			state::previous_scene_norc = hook->norc;
-			blog(LOG_DEBUG, "Switch Scenes %s", obs_data_get_string(event.additionalFields(), "scene-name"));
-			break;
-		case Events::event_type::PreviewSceneChanged:
-			Macro::swap_buttons(this, message, state::previous_preview_scene_norc, hook->norc);
-			state::previous_preview_scene_norc = hook->norc;
-			blog(LOG_DEBUG, "Scene Preview Changed");
-			break;
-		case Events::event_type::SourceMuteStateChanged:
-			Macro::set_on_off(this, message, !obs_data_get_bool(event.additionalFields(), "muted"));
-			break;
-		case Events::event_type::StreamStarted:
-			Macro::set_on_off(this, message, true);
-			break;
-		case Events::event_type::StreamStarting:
-			Macro::set_on_off(this, message, false);
-			break;
-		case Events::event_type::StreamStopped:
-			Macro::set_on_off(this, message, false);
-			break;
-		case Events::event_type::StreamStopping:
-			Macro::set_on_off(this, message, false);
-			break;
-		case Events::event_type::RecordingStarted:
-			Macro::set_on_off(this, message, true);
-			break;
-		case Events::event_type::RecordingStarting:
-			Macro::set_on_off(this, message, false);
-			break;
-		case Events::event_type::RecordingStopping:
-			Macro::set_on_off(this, message, true);
-			break;
-		case Events::event_type::RecordingStopped:
-			Macro::set_on_off(this, message, false);
-			break;
-		case Events::event_type::SceneChanged:
-			Macro::swap_buttons(this, message, state::previous_scene_norc, hook->norc);
-			state::previous_scene_norc = hook->norc;
-			blog(LOG_DEBUG, "Scene Changed");
-			break;
-		}
-
-		delete (message);
-	} else {
-		/// <summary>
-		/// Events that dont need a hook
-		/// </summary>
-		/// <param name="event"></param>
-		switch (Events::string_to_event(event.updateType())) {
-		case Events::event_type::LoadingFinished:
-			startup();
-			break;
-		case Events::event_type::SourceRenamed:
-			rename_source(event);
-			break;
-		case Events::event_type::Exiting:
-			state::closing = true;
-			break;
-		case Events::event_type::SourceRemoved:
-			remove_source(event);
-			break;
-		case Events::event_type::ProfileChanged:
-			GetDeviceManager().get()->reload();
-			break;
-		case Events::event_type::SceneCollectionChanged:
-			GetDeviceManager().get()->reload();
-			break;
-		case Events::event_type::TransitionBegin:
-			break;
+	const QVector<MidiHook *> *hooks = feedback_index.wants(type) ? feedback_index.find(type, FeedbackIndex::event_subject(event)) : nullptr;
+	if (hooks) {
+		for (auto hook : *hooks) {
+			const MidiMessage message = hook->get_message_from_hook();
+			switch (type) {
+			case RpcEvent::SourceVolumeChanged:
+				Macro::set_volume(this, message, event.get<RpcEvent::VolumePayload>()->volume);
+				break;
+			case RpcEvent::SwitchScenes:
+				Macro::swap_buttons(this, message, state::previous_scene_norc, hook->norc);
+				state::previous_scene_norc = hook->norc;
+				blog(LOG_DEBUG, "Switch Scenes %s", event.get<RpcEvent::ScenePayload>()->scene.qtocs());
+				break;
+			case RpcEvent::PreviewSceneChanged:
+				Macro::swap_buttons(this, message, state::previous_preview_scene_norc, hook->norc);
+				state::previous_preview_scene_norc = hook->norc;
+				blog(LOG_DEBUG, "Scene Preview Changed");
+				break;
+			case RpcEvent::SwitchTransition:
+				Macro::swap_buttons(this, message, state::previous_transition_norc, hook->norc);
+				state::previous_transition_norc = hook->norc;
+				break;
+			case RpcEvent::SourceMuteStateChanged:
+				Macro::set_on_off(this, message, !event.get<RpcEvent::MutePayload>()->muted);
+				break;
+			case RpcEvent::SourceFilterVisibilityChanged:
+				Macro::set_on_off(this, message, event.get<RpcEvent::FilterPayload>()->enabled);
+				break;
+			case RpcEvent::SceneItemVisibilityChanged:
+				Macro::set_on_off(this, message, event.get<RpcEvent::SceneItemPayload>()->visible);
+				break;
+			case RpcEvent::StudioModeSwitched:
+				Macro::set_on_off(this, message, event.get<RpcEvent::StatePayload>()->state);
+				break;
+			case RpcEvent::StreamStarted:
+			case RpcEvent::RecordingStarted:
+			case RpcEvent::RecordingStopping:
+			case RpcEvent::RecordingPaused:
+			case RpcEvent::ReplayStarted:
+				Macro::set_on_off(this, message, true);
+				break;
+			case RpcEvent::StreamStopping:
+			case RpcEvent::StreamStopped:
+			case RpcEvent::RecordingStopped:
+			case RpcEvent::RecordingResumed:
+			case RpcEvent::ReplayStopping:
+			case RpcEvent::ReplayStopped:
+				Macro::set_on_off(this, message, false);
+				break;
+			default:
+				break;
+			}
 		}
 	}
+	/// <summary>
+	/// Events that dont need a hook. Profile and scene collection changes are handled once by Config.
+	/// </summary>
+	/// <param name="event"></param>
+	switch (type) {
+	case RpcEvent::SourceRenamed:
+		rename_source(event);
+		break;
+	case RpcEvent::Exiting:
+		state::closing = true;
+		break;
+	case RpcEvent::SourceRemoved:
+		remove_source(event);
+		break;
+	default:
+		break;
+	}
 }
 /// <summary>
 /// Find all hooks that have name, and remove hook
@@ -731,14 +1085,20 @@ void MidiAgent::remove_source(const RpcEvent &event)
 	if (state::closing)
 		return;
 
-	const QString from = obs_data_get_string(event.additionalFields(), "sourceName");
-	for (auto midiHook : this->midiHooks) {
+	const auto removed = event.get<RpcEvent::SourcePayload>();
+	if (!removed)
+		return;
+	const QString &from = removed->source;
+	// Iterates a copy, remove_MidiHook changes midiHooks
+	bool removed_hooks = false;
+	for (auto midiHook : GetMidiHooks()) {
 		if (midiHook->source == from) {
 			this->remove_MidiHook(midiHook);
-			GetConfig().get()->Save();
+			removed_hooks = true;
 		}
 	}
-	GetConfig()->Save();
+	if (removed_hooks)
+		GetConfig()->Save();
 }
 /// <summary>
 /// Find all hooks that have name, and replace name
@@ -746,18 +1106,31 @@ void MidiAgent::remove_source(const RpcEvent &event)
 /// <param name="event">incoming RpcEvent</param>
 void MidiAgent::rename_source(const RpcEvent &event)
 {
-	blog(LOG_DEBUG, "Rename source %s to %s", obs_data_get_string(event.additionalFields(), "previousName"),
-	     obs_data_get_string(event.additionalFields(), "newName"));
-	const QString from = obs_data_get_string(event.additionalFields(), "previousName");
-	for (auto midiHook : this->midiHooks) {
-		if (midiHook->scene == from) {
-			midiHook->scene = obs_data_get_string(event.additionalFields(), "newName");
-			GetConfig().get()->Save();
-		} else if (midiHook->source == from) {
-			midiHook->source = obs_data_get_string(event.additionalFields(), "newName");
-			GetConfig().get()->Save();
-		}
+	const auto rename = event.get<RpcEvent::RenamePayload>();
+	if (!rename)
+		return;
+	const QString &from = rename->previous_name;
+	const QString &to = rename->new_name;
+	blog(LOG_DEBUG, "Rename source %s to %s", from.qtocs(), to.qtocs());
+	// Renamed hooks are replaced by a copy so the executor the dispatcher may be running stays intact
+	bool renamed = false;
+	for (auto midiHook : GetMidiHooks()) {
+		if (midiHook->scene != from && midiHook->source != from)
+			continue;
+		obs_data_t *hookData = obs_data_create();
+		midiHook->GetData(hookData);
+		auto *renamed_hook = new MidiHook(hookData);
+		obs_data_release(hookData);
+		if (renamed_hook->scene == from)
+			renamed_hook->scene = to;
+		else
+			renamed_hook->source = to;
+		renamed_hook->set_obs_action();
+		edit_midi_hook(midiHook, renamed_hook);
+		renamed = true;
 	}
+	if (renamed)
+		GetConfig().get()->Save();
 }
 /// <summary>
 /// Sends message to midi Devices
@@ -765,16 +1138,164 @@ void MidiAgent::rename_source(const RpcEvent &event)
 /// <param name="message">MidiMessage to send</param>
 void MidiAgent::send_message_to_midi_device(const MidiMessage &message)
 {
-	if (message.message_type != "none") {
-		std::unique_ptr<libremidi::message> hello = std::make_unique<libremidi::message>();
-		if (message.message_type == "Control Change") {
-			this->midiout.send_message(hello->control_change(message.channel, message.NORC, message.value));
-		} else if (message.message_type == "Note On") {
-			this->midiout.send_message(hello->note_on(message.channel, message.NORC, message.value));
-		} else if (message.message_type == "Note Off") {
-			this->midiout.send_message(hello->note_off(message.channel, message.NORC, message.value));
+	unsigned char bytes[3];
+	if (!encode_message(message, bytes))
+		return;
+	// Held back while the output is closed or the device is gone, the resync on open sends it
+	if (!output_ready.load(std::memory_order_relaxed)) {
+		feedback_shadow.set(message);
+		return;
+	}
+	if (!feedback_shadow.update(message)) {
+		suppressed_messages.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	// Dropped with the queue full, the device still shows the previous value
+	if (!output_writer.send(bytes, sizeof(bytes)))
+		feedback_shadow.invalidate(message);
+}
+/// <summary>
+/// Called by the output writer, on its thread, for a message a driver write failed for.
+/// What the device shows for its slot is not known anymore, so the next value is sent whatever it is.
+/// </summary>
+/// <param name="bytes"></param>
+/// <param name="size"></param>
+void MidiAgent::forget_feedback(const unsigned char *bytes, size_t size)
+{
+	MidiMessage message;
+	message.set_message(bytes, size);
+	feedback_shadow.invalidate(message);
+}
+/// <summary>
+/// Encodes the channel messages obs-midi sends, false for any other type
+/// </summary>
+/// <param name="message"></param>
+/// <param name="bytes">Three bytes</param>
+/// <returns></returns>
+bool MidiAgent::encode_message(const MidiMessage &message, unsigned char *bytes)
+{
+	switch (message.message_type) {
+	case MidiMessageType::Control_Change:
+	case MidiMessageType::Note_On:
+	case MidiMessageType::Note_Off:
+		// Channels are 1 based, out of range ones are clamped like libremidi does
+		bytes[0] = (unsigned char)(((uint8_t)message.message_type << 4) | (std::clamp<int>(message.channel, 1, 16) - 1));
+		bytes[1] = (unsigned char)(message.NORC & 0x7F);
+		bytes[2] = (unsigned char)(message.value & 0x7F);
+		return true;
+	default:
+		return false;
+	}
+}
+/// <summary>
+/// Turns off what the hooks of this device can light up and anything else feedback turned on:
+/// a note off for every note and a zero for every control, or the device's sysex reset when one is configured.
+/// The messages are paced by the output writer, reset_finished is emitted once they are all written.
+/// </summary>
+void MidiAgent::reset_feedback()
+{
+	if (resetting.exchange(true))
+		return;
+	int messages = 0;
+	if (!reset_sysex.empty()) {
+		// What the device shows afterwards is up to it
+		feedback_shadow.clear();
+		if (output_writer.send_long(reset_sysex, true))
+			messages++;
+	} else {
+		QSet<uint32_t> targets;
+		const auto reset = [this, &targets, &messages](MidiMessage message) {
+			message.value = 0;
+			if (message.message_type == MidiMessageType::Note_On)
+				message.message_type = MidiMessageType::Note_Off;
+			const uint32_t target = ((uint32_t)message.message_type << 16) | (message.channel << 8) | message.NORC;
+			if (targets.contains(target))
+				return;
+			targets.insert(target);
+			unsigned char bytes[3];
+			if (!encode_message(message, bytes))
+				return;
+			feedback_shadow.set(message);
+			if (output_writer.send(bytes, sizeof(bytes), true))
+				messages++;
+			else
+				feedback_shadow.invalidate(message);
+		};
+		for (auto hook : GetMidiHooks()) {
+			MidiMessage message;
+			message.message_type = hook->message_type;
+			message.channel = (uint8_t)hook->channel;
+			message.NORC = (uint8_t)hook->norc;
+			reset(message);
 		}
+		feedback_shadow.for_each([&reset](const MidiMessage &message) {
+			if (message.value != 0)
+				reset(message);
+		});
+	}
+	const bool notified = output_writer.notify_when_written([this, messages]() {
+		QMetaObject::invokeMethod(
+			this,
+			[this, messages]() {
+				resetting = false;
+				blog(LOG_INFO, "Reset %s with %d messages", midi_output_name.qtocs(), messages);
+				emit reset_finished(messages);
+			},
+			Qt::QueuedConnection);
+	});
+	if (!notified) {
+		resetting = false;
+		emit reset_finished(0);
+	}
+}
+/// <summary>
+/// Sends the device everything feedback has set on it again, paced, for when it may have lost it.
+/// Sends made meanwhile still go through the shadow, so they stay in order with it.
+/// </summary>
+void MidiAgent::resync_feedback()
+{
+	int messages = 0;
+	feedback_shadow.for_each([this, &messages](const MidiMessage &message) {
+		unsigned char bytes[3];
+		if (!encode_message(message, bytes))
+			return;
+		if (output_writer.send(bytes, sizeof(bytes), true))
+			messages++;
+		else
+			feedback_shadow.invalidate(message);
+	});
+	blog(LOG_DEBUG, "Resync %s with %d messages", midi_output_name.qtocs(), messages);
+}
+uint64_t MidiAgent::get_suppressed_messages() const
+{
+	return suppressed_messages.load(std::memory_order_relaxed);
+}
+/// <summary>
+/// True from reset_feedback() until reset_finished
+/// </summary>
+/// <returns></returns>
+bool MidiAgent::is_resetting() const
+{
+	return resetting;
+}
+/// <summary>
+/// Writes bytes queued by the output writer to the port, called on the writer thread.
+/// </summary>
+/// <param name="bytes"></param>
+/// <param name="size"></param>
+/// <returns>False if the port is closed or the driver failed</returns>
+bool MidiAgent::write_output(const unsigned char *bytes, size_t size)
+{
+	std::lock_guard<std::mutex> lock(output_mutex);
+	if (!midiout.is_port_open())
+		return false;
+	try {
+		midiout.send_message(bytes, size);
+	} catch (const libremidi::midi_exception &error) {
+		blog(LOG_DEBUG, "Midi Error %s", error.what());
+		return false;
 	}
+	return true;
 }
 /// <summary>
 /// Sends Message to Midi device
@@ -791,21 +1312,17 @@ void MidiAgent::send_bytes(unsigned char bytes)
 void MidiAgent::set_current_volumes()
 {
 	const auto volumelist = Utils::GetAudioSourceNames();
-	for (int i = 0; i < volumelist.count(); i++) {
-
-		const auto source = obs_get_source_by_name(volumelist.at(i).toStdString().c_str());
+	for (const auto &name : volumelist) {
+		const QVector<MidiHook *> *hooks = feedback_index.find(RpcEvent::SourceVolumeChanged, name);
+		if (!hooks)
+			continue;
+		const OBSSource source = GetSourceCache()->get_source(name.toUtf8().constData());
+		if (!source)
+			continue;
 		const auto vol = obs_source_get_volume(source);
-		obs_data_t *additional = obs_data_create();
-		obs_data_set_string(additional, "sourceName", volumelist.at(i).toStdString().c_str());
-
-		auto *event = new RpcEvent(QString("SourceVolumeChanged"), NULL, NULL, additional);
-		MidiHook *hook = get_midi_hook_if_exists((RpcEvent)*event);
-		obs_source_release(source);
-		obs_data_release(additional);
-		if (hook == nullptr)
-			return;
-		blog(LOG_DEBUG, "Get Volume %s is %i", volumelist.at(i).toStdString().c_str(), Utils::mapper2(vol));
-		Macro::set_volume(this, hook->get_message_from_hook(), vol);
+		blog(LOG_DEBUG, "Get Volume %s is %i", name.toStdString().c_str(), Utils::mapper2(vol));
+		for (auto hook : *hooks)
+			Macro::set_volume(this, hook->get_message_from_hook(), vol);
 	}
 }
 /// <summary>
@@ -12,6 +12,10 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <functional>
 #include <map>
@@ -21,6 +25,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
 
 #include <libremidi/libremidi.hpp>
 #if __has_include(<obs-frontend-api.h>)
@@ -31,15 +36,36 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "rpc/RpcEvent.h"
 #include "utils.h"
 #include "obs-controller.h"
+#include "midi-hook-index.h"
+#include "feedback-index.h"
+#include "spsc-queue.h"
+#include "midi-output-writer.h"
+#include "feedback-shadow.h"
+#include "latency-histogram.h"
+#include "mapping-cache.h"
+
+// Backend of every MIDI client, headless builds run without MIDI hardware or a sequencer
+#ifdef OBS_MIDI_HEADLESS
+constexpr libremidi::API midi_api = libremidi::API::DUMMY;
+#else
+constexpr libremidi::API midi_api = libremidi::API::UNSPECIFIED;
+#endif
 
 class MidiAgent : public QObject {
 	Q_OBJECT
 public:
 	MidiAgent(const int &in_port, std::optional<int> out_port = std::nullopt);
-	MidiAgent(const char *data);
+	MidiAgent();
 	~MidiAgent();
-	bool is_device_attached(const char *idata);
-	void Load(const char *data);
+	// Profile and scene collection switches
+	QVector<MidiHook *> swap_config(obs_data_t *data, std::optional<QVector<MidiHook *>> hooks = std::nullopt);
+	QVector<MidiHook *> swap_config(const MappingCache &cache, const MappingCache::Device &device, std::optional<QVector<MidiHook *>> hooks = std::nullopt);
+	void load_settings(obs_data_t *data);
+	void load_settings(const MappingCache &cache, const MappingCache::Device &device);
+	QVector<MidiHook *> load_hooks(obs_data_t *data);
+	QVector<MidiHook *> load_hooks(const MappingCache &cache, const MappingCache::Device &device);
+	bool has_migrated_hooks() const;
+	void resolve_ports();
 	// Open Actions
 	void open_midi_input_port();
 	void open_midi_output_port();
@@ -47,12 +73,19 @@ public:
 	void close_both_midi_ports();
 	void close_midi_output_port();
 	void close_midi_input_port();
+	// Hot plug, driven by the device watcher
+	bool update_ports();
+	bool needs_reconnect() const;
+	bool reconnect();
+	bool is_output_ready() const;
+	bool is_loading() const;
 	const QString &get_midi_input_name() const;
 	const QString &get_midi_output_name() const;
 	void set_input_port(int port);
 	void set_output_port(int port);
 	void set_midi_output_name(const QString &oname);
 	int GetPort() const;
+	uint16_t get_device_id() const;
 	bool isEnabled() const;
 	bool isConnected() const;
 	bool isBidirectional() const;
@@ -62,17 +95,39 @@ public:
 	static void HandleError(const libremidi::midi_error &error, const std::string_view &error_message, void *userData);
 	void HandleError(const libremidi::driver_error &error_type, const std::string_view &error_message, void *userData);
 	void set_callbacks();
+	// Dispatcher
+	void start_dispatcher();
+	void stop_dispatcher();
+	size_t get_queue_depth() const;
+	size_t get_queue_high_water() const;
+	uint64_t get_dropped_messages() const;
+	uint64_t get_coalesced_messages() const;
+	// Dispatcher latencies
+	const LatencyHistogram &get_ingest_latency() const;
+	const LatencyHistogram &get_dispatch_latency() const;
+	const LatencyHistogram &get_execute_latency() const;
+	QString get_latency_summary() const;
+	// Output writer
+	const MidiOutputWriter &get_output_writer() const;
 	QVector<MidiHook *> GetMidiHooks() const;
+	QList<RpcEvent::Type> get_feedback_events() const;
 	void set_midi_hooks(QVector<MidiHook *>);
-	void exe_midi_hook_if_exists(MidiMessage *message);
+	QVector<MidiHook *> swap_midi_hooks(QVector<MidiHook *> mh);
+	void retire_midi_hooks(const QVector<MidiHook *> &hooks);
+	MidiHook *find_midi_hook(MidiMessageType message_type, int channel, int norc, std::optional<int> value = std::nullopt) const;
 	void add_MidiHook(MidiHook *hook);
 	void remove_MidiHook(MidiHook *hook);
 	void edit_midi_hook(MidiHook *old_hook, MidiHook *new_hook);
 	void clear_MidiHooks();
-	QString GetData();
+	void GetData(obs_data_t *data) const;
+	void GetData(MappingCache::Builder &cache) const;
 	void remove_source(const RpcEvent &event);
 	void rename_source(const RpcEvent &event);
 	void send_message_to_midi_device(const MidiMessage &message);
+	void reset_feedback();
+	bool is_resetting() const;
+	void resync_feedback();
+	uint64_t get_suppressed_messages() const;
 	void send_bytes(unsigned char bytes);
 	void set_current_scene();
 	void set_current_volumes();
@@ -82,11 +137,35 @@ public slots:
 signals:
 	void broadcast_midi_message(const MidiMessage &);
 	void do_obs_action(MidiHook *, int);
+	void reset_finished(int messages);
 
 private:
+	static constexpr size_t ingest_queue_size = 1024;
+	static constexpr size_t dispatch_batch_size = 64;
+	inline static uint16_t next_device_id = 1;
+	const uint16_t device_id = next_device_id++;
 	bool loading = true;
-	libremidi::midi_in midiin;
-	libremidi::midi_out midiout;
+	bool migrated_hooks = false;
+	libremidi::midi_in midiin{midi_api};
+	libremidi::midi_out midiout{midi_api};
+	// Serializes the output port between the writer thread and open/close
+	std::mutex output_mutex;
+	// Set while the output port is open, feedback is only kept in the shadow otherwise
+	std::atomic<bool> output_ready{false};
+	bool write_output(const unsigned char *bytes, size_t size);
+	static bool encode_message(const MidiMessage &message, unsigned char *bytes);
+	static bool backend_takes_multi_message_writes(libremidi::API api);
+	// Sent instead of the per note reset when set, for devices that have one
+	std::vector<unsigned char> reset_sysex;
+	void set_reset_sysex(const QString &hex);
+	void update_ports_for_settings(const QString &previous_output);
+	std::atomic<bool> resetting{false};
+	// What the output device shows, sends that would not change it are skipped
+	FeedbackShadow feedback_shadow;
+	std::atomic<uint64_t> suppressed_messages{0};
+	MidiOutputWriter output_writer{[this](const unsigned char *bytes, size_t size) { return write_output(bytes, size); },
+				       [this](const unsigned char *bytes, size_t size) { forget_feedback(bytes, size); }};
+	void forget_feedback(const unsigned char *bytes, size_t size);
 	QString midi_input_name;
 	QString midi_output_name;
 	bool sending{};
@@ -95,8 +174,37 @@ private:
 	bool enabled = false;
 	bool connected = false;
 	bool bidirectional = false;
-	MidiHook *get_midi_hook_if_exists(MidiMessage *message);
-	MidiHook *get_midi_hook_if_exists(const RpcEvent &event) const;
 	bool closing = false;
 	QVector<MidiHook *> midiHooks;
+	MidiHookIndex hook_index;
+	// Reverse index for OBS event feedback, only used on the UI thread
+	FeedbackIndex feedback_index;
+	void feedback_changed();
+	// Ingest queue and dispatcher thread
+	void enqueue_message(const MidiMessage &message);
+	void dispatch_loop();
+	void dispatch_batch(const MidiMessage *messages, size_t count);
+	static void execute_hook(MidiHook *hook, int value);
+	void retire_hook(MidiHook *hook);
+	void collect_retired_hooks();
+	SpscQueue<MidiMessage, ingest_queue_size> ingest_queue;
+	std::thread dispatcher;
+	std::atomic<bool> dispatcher_running{false};
+	std::atomic<bool> dispatcher_sleeping{false};
+	std::mutex dispatcher_mutex;
+	std::condition_variable dispatcher_wake;
+	bool realtime_dispatch = false;
+	int dispatch_cpu = -1;
+	std::atomic<size_t> queue_high_water{0};
+	std::atomic<uint64_t> dropped_messages{0};
+	std::atomic<uint64_t> coalesced_messages{0};
+	// Written by the dispatcher thread only
+	LatencyHistogram ingest_latency;   // MIDI input callback to hook match
+	LatencyHistogram dispatch_latency; // hook match to its action starting
+	LatencyHistogram execute_latency;  // the action itself
+	// Guards the hook index against the dispatcher, only the UI thread writes it
+	mutable std::mutex hooks_mutex;
+	// Odd while the dispatcher runs a batch, hooks removed during a batch are deleted after it
+	std::atomic<uint64_t> dispatch_epoch{0};
+	QVector<QPair<MidiHook *, uint64_t>> retired_hooks;
 };
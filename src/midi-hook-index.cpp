@@ -0,0 +1,103 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "midi-hook-index.h"
+#include "Midi_hook.h"
+
+int MidiHookIndex::make_key(MidiMessageType message_type, int channel, int norc)
+{
+	if (message_type == MidiMessageType::None)
+		return -1;
+	return ((int)message_type << 16) | ((channel & 0xFF) << 8) | (norc & 0xFF);
+}
+const QVector<MidiHook *> *MidiHookIndex::Bucket::filtered_by(int value) const
+{
+	if (value < 0 || value >= (int)filtered_values.size() || !filtered_values.test(value))
+		return nullptr;
+	const auto it = filtered.constFind(value);
+	return (it == filtered.constEnd()) ? nullptr : &it.value();
+}
+/*
+ * Adds a hook to the index, hooks keep their insertion order inside a key
+ */
+void MidiHookIndex::add(MidiHook *hook)
+{
+	const int key = make_key(hook->message_type, hook->channel, hook->norc);
+	if (key == -1)
+		return;
+	Bucket &bucket = buckets[key];
+	if (hook->value_as_filter && hook->value) {
+		const int value = *hook->value;
+		bucket.filtered[value].push_back(hook);
+		if (value >= 0 && value < (int)bucket.filtered_values.size())
+			bucket.filtered_values.set(value);
+	} else {
+		bucket.hooks.push_back(hook);
+	}
+}
+void MidiHookIndex::remove(MidiHook *hook)
+{
+	const int key = make_key(hook->message_type, hook->channel, hook->norc);
+	auto bucket = buckets.find(key);
+	if (bucket == buckets.end())
+		return;
+	if (!bucket->hooks.removeOne(hook)) {
+		for (auto it = bucket->filtered.begin(); it != bucket->filtered.end(); ++it) {
+			if (it->removeOne(hook)) {
+				if (it->isEmpty()) {
+					if (it.key() >= 0 && it.key() < (int)bucket->filtered_values.size())
+						bucket->filtered_values.reset(it.key());
+					bucket->filtered.erase(it);
+				}
+				break;
+			}
+		}
+	}
+	if (bucket->empty())
+		buckets.erase(bucket);
+}
+void MidiHookIndex::rebuild(const QVector<MidiHook *> &hooks)
+{
+	clear();
+	for (auto hook : hooks)
+		add(hook);
+}
+void MidiHookIndex::clear()
+{
+	buckets.clear();
+}
+const MidiHookIndex::Bucket *MidiHookIndex::find_bucket(MidiMessageType message_type, int channel, int norc) const
+{
+	const auto it = buckets.constFind(make_key(message_type, channel, norc));
+	return (it == buckets.constEnd()) ? nullptr : &it.value();
+}
+/*
+ * Returns the first hook for the key.
+ * With a value, filter hooks for that value win over hooks that take any value,
+ * without a value any hook on the key is returned.
+ */
+MidiHook *MidiHookIndex::find(MidiMessageType message_type, int channel, int norc, std::optional<int> value) const
+{
+	const Bucket *bucket = find_bucket(message_type, channel, norc);
+	if (!bucket)
+		return nullptr;
+	if (value) {
+		if (const auto *filtered = bucket->filtered_by(*value))
+			return filtered->first();
+	}
+	if (!bucket->hooks.isEmpty())
+		return bucket->hooks.first();
+	if (!value && !bucket->filtered.isEmpty())
+		return bucket->filtered.constBegin()->first();
+	return nullptr;
+}
@@ -0,0 +1,49 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <bitset>
+#include <optional>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include "Midi_message.h"
+
+class MidiHook;
+/*
+ * Midi Hook Index
+ * Per device dispatch table keyed by (message type, channel, note or control).
+ * Hooks that use their value as a filter are stored per value, and a 128 bit
+ * map per key tells if any filter exists for a value without touching the hash.
+ */
+class MidiHookIndex {
+public:
+	struct Bucket {
+		QVector<MidiHook *> hooks;          // hooks that take any value
+		std::bitset<128> filtered_values;   // values that have at least one filter hook
+		QHash<int, QVector<MidiHook *>> filtered;
+		const QVector<MidiHook *> *filtered_by(int value) const;
+		bool empty() const { return hooks.isEmpty() && filtered.isEmpty(); }
+	};
+	void add(MidiHook *hook);
+	void remove(MidiHook *hook);
+	void rebuild(const QVector<MidiHook *> &hooks);
+	void clear();
+	const Bucket *find_bucket(MidiMessageType message_type, int channel, int norc) const;
+	MidiHook *find(MidiMessageType message_type, int channel, int norc, std::optional<int> value = std::nullopt) const;
+
+private:
+	static int make_key(MidiMessageType message_type, int channel, int norc);
+	QHash<int, Bucket> buckets;
+};
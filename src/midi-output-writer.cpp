@@ -0,0 +1,286 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "midi-output-writer.h"
+
+#include <algorithm>
+#include <utility>
+
+MidiOutputWriter::MidiOutputWriter(WriteFunction write_function, FailureFunction failure_function)
+	: write(std::move(write_function)), failed(std::move(failure_function))
+{
+	pending.reserve(queue_size);
+	writing.reserve(queue_size);
+	buffer.reserve(max_batch * 3);
+}
+MidiOutputWriter::~MidiOutputWriter()
+{
+	stop();
+}
+void MidiOutputWriter::set_options(const Options &new_options)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	options = new_options;
+}
+MidiOutputWriter::Options MidiOutputWriter::get_options() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return options;
+}
+void MidiOutputWriter::set_multi_message_writes(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	multi_message_writes = enabled;
+}
+void MidiOutputWriter::start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (writer.joinable())
+		return;
+	running = true;
+	writer = std::thread(&MidiOutputWriter::write_loop, this);
+}
+/*
+ * Stops and joins the writer thread, messages still queued are dropped
+ */
+void MidiOutputWriter::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!writer.joinable())
+			return;
+		running = false;
+	}
+	wake.notify_one();
+	writer.join();
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const Item &item : pending) {
+		if (!(item.flags & Marker))
+			dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	pending.clear();
+	pending_long.clear();
+	pending_markers.clear();
+}
+/*
+ * Queues one channel message (1 to 3 bytes), returns false if it was dropped
+ * because the queue is full or the writer is not running
+ */
+bool MidiOutputWriter::send(const unsigned char *bytes, size_t size, bool paced)
+{
+	if (size == 0 || size > 3)
+		return false;
+	Item item{};
+	std::copy(bytes, bytes + size, item.bytes.begin());
+	item.size = (uint8_t)size;
+	item.flags = paced ? Paced : 0;
+	return push(item);
+}
+/*
+ * Queues a message of any length, sysex for instance, it is always written on its own
+ */
+bool MidiOutputWriter::send_long(std::vector<unsigned char> bytes, bool paced)
+{
+	if (bytes.empty())
+		return false;
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!running || pending.size() >= queue_size) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	pending.push_back(Item{{}, 0, (uint8_t)(Long | (paced ? Paced : 0))});
+	pending_long.push_back(std::move(bytes));
+	lock.unlock();
+	queued.fetch_add(1, std::memory_order_relaxed);
+	wake.notify_one();
+	return true;
+}
+/*
+ * Calls callback on the writer thread once everything queued before it has been written.
+ * It is never called if the writer stops first, returns false if the writer is not running.
+ */
+bool MidiOutputWriter::notify_when_written(std::function<void()> callback)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!running)
+		return false;
+	pending.push_back(Item{{}, 0, Marker});
+	pending_markers.push_back(std::move(callback));
+	lock.unlock();
+	wake.notify_one();
+	return true;
+}
+bool MidiOutputWriter::push(const Item &item)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running || pending.size() >= queue_size) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		pending.push_back(item);
+	}
+	queued.fetch_add(1, std::memory_order_relaxed);
+	wake.notify_one();
+	return true;
+}
+void MidiOutputWriter::write_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return !pending.empty() || !running; });
+		if (!running)
+			return;
+		writing.swap(pending);
+		writing_long.swap(pending_long);
+		writing_markers.swap(pending_markers);
+		lock.unlock();
+		write_items();
+		writing.clear();
+		writing_long.clear();
+		writing_markers.clear();
+		lock.lock();
+	}
+}
+/*
+ * Writes everything swapped out of the queue in order: runs of plain messages in batches,
+ * paced and long messages one by one, and calls the markers as they come up
+ */
+void MidiOutputWriter::write_items()
+{
+	const Options current = get_options();
+	const uint32_t paced_rate = current.bytes_per_second > 0 ? current.bytes_per_second : din_bytes_per_second;
+	size_t first = 0;
+	while (first < writing.size()) {
+		const Item &item = writing[first];
+		size_t next = first + 1;
+		bool written = true;
+		if (item.flags & Marker) {
+			const std::function<void()> callback = std::move(writing_markers.front());
+			writing_markers.pop_front();
+			callback();
+		} else if (item.flags & Long) {
+			const std::vector<unsigned char> bytes = std::move(writing_long.front());
+			writing_long.pop_front();
+			written = write_bytes(bytes.data(), bytes.size(), 1, (item.flags & Paced) ? paced_rate : current.bytes_per_second) != WriteResult::Stopped;
+		} else if (item.flags & Paced) {
+			const WriteResult result = write_bytes(item.bytes.data(), item.size, 1, paced_rate);
+			if (result == WriteResult::Failed)
+				report_failed(&item, 1);
+			written = result != WriteResult::Stopped;
+		} else {
+			while (next < writing.size() && next - first < max_batch && writing[next].flags == 0)
+				next++;
+			written = write_batch(writing.data() + first, next - first);
+		}
+		if (!written) {
+			// Stopped while waiting for pacing, the rest is dropped
+			for (size_t i = next; i < writing.size(); i++) {
+				if (!(writing[i].flags & Marker))
+					dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			return;
+		}
+		first = next;
+	}
+}
+/*
+ * Writes a run of plain messages, in one driver write when batching is on and the port takes it.
+ * Running status only spans a single write, the first message of each write keeps its status byte.
+ * Returns false if the writer was stopped while waiting for pacing.
+ */
+bool MidiOutputWriter::write_batch(const Item *items, size_t count)
+{
+	Options current;
+	bool batching;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current = options;
+		batching = options.batching && multi_message_writes;
+	}
+	size_t first = 0;
+	while (first < count) {
+		const size_t last = batching ? count : first + 1;
+		buffer.clear();
+		unsigned char status = 0;
+		for (size_t i = first; i < last; i++) {
+			const Item &item = items[i];
+			const bool skip_status = current.running_status && item.bytes[0] == status && item.bytes[0] < 0xF0;
+			buffer.insert(buffer.end(), item.bytes.begin() + (skip_status ? 1 : 0), item.bytes.begin() + item.size);
+			status = item.bytes[0];
+		}
+		const WriteResult result = write_bytes(buffer.data(), buffer.size(), last - first, current.bytes_per_second);
+		if (result == WriteResult::Stopped) {
+			dropped.fetch_add(count - last, std::memory_order_relaxed);
+			return false;
+		}
+		if (result == WriteResult::Failed)
+			report_failed(items + first, last - first);
+		first = last;
+	}
+	return true;
+}
+/*
+ * One driver write holding messages messages, after waiting out the previous one if paced.
+ * Messages that were not written are counted as dropped, Stopped means the writer was stopped meanwhile.
+ */
+MidiOutputWriter::WriteResult MidiOutputWriter::write_bytes(const unsigned char *bytes, size_t size, size_t messages, uint32_t bytes_per_second)
+{
+	if (bytes_per_second > 0 && !wait_for_pacing()) {
+		dropped.fetch_add(messages, std::memory_order_relaxed);
+		return WriteResult::Stopped;
+	}
+	const bool written = write(bytes, size);
+	if (written)
+		sent.fetch_add(messages, std::memory_order_relaxed);
+	else
+		dropped.fetch_add(messages, std::memory_order_relaxed);
+	if (bytes_per_second > 0) {
+		const auto duration = std::chrono::nanoseconds((int64_t)size * 1000000000 / bytes_per_second);
+		next_write = std::max(next_write, std::chrono::steady_clock::now()) + duration;
+	}
+	return written ? WriteResult::Written : WriteResult::Failed;
+}
+void MidiOutputWriter::report_failed(const Item *items, size_t count)
+{
+	if (!failed)
+		return;
+	for (size_t i = 0; i < count; i++)
+		failed(items[i].bytes.data(), items[i].size);
+}
+/*
+ * Sleeps until the previous write has gone out on the wire, false if stopped meanwhile
+ */
+bool MidiOutputWriter::wait_for_pacing()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	wake.wait_until(lock, next_write, [this] { return !running; });
+	return running;
+}
+size_t MidiOutputWriter::get_depth() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending.size();
+}
+uint64_t MidiOutputWriter::get_queued() const
+{
+	return queued.load(std::memory_order_relaxed);
+}
+uint64_t MidiOutputWriter::get_sent() const
+{
+	return sent.load(std::memory_order_relaxed);
+}
+uint64_t MidiOutputWriter::get_dropped() const
+{
+	return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * MIDI Output Writer
+ * Per device queue of outgoing channel messages, drained by its own thread so a slow or
+ * blocked output port never holds up the thread that raised the feedback.
+ * Messages that are waiting together can go out in one driver write, optionally with running
+ * status, on backends that take several messages per write. The output can be paced to a byte
+ * rate (3125 bytes/s for a 31.25 kbaud DIN port).
+ * Paced messages are always written one at a time, at the configured rate or the DIN rate if
+ * the output is unpaced, for bursts like a reset that older controllers cannot take at full speed.
+ * send(), send_long() and notify_when_written() may be called from any thread.
+ * Channel messages a driver write failed for are handed to the failure function, on the writer thread.
+ */
+class MidiOutputWriter {
+public:
+	// Returns false if the bytes could not be written, they are then counted as dropped
+	typedef std::function<bool(const unsigned char *bytes, size_t size)> WriteFunction;
+	// One channel message that was not written
+	typedef std::function<void(const unsigned char *bytes, size_t size)> FailureFunction;
+	struct Options {
+		bool batching = false; // only on a port with multi message writes
+		bool running_status = false;
+		uint32_t bytes_per_second = 0; // 0 writes as fast as the port takes it
+	};
+	static constexpr uint32_t din_bytes_per_second = 3125;
+
+	explicit MidiOutputWriter(WriteFunction write, FailureFunction failed = nullptr);
+	~MidiOutputWriter();
+	void set_options(const Options &options);
+	Options get_options() const;
+	// Set by the owner for backends that accept several channel messages in one write, off by default
+	void set_multi_message_writes(bool enabled);
+	void start();
+	void stop();
+	bool send(const unsigned char *bytes, size_t size, bool paced = false);
+	bool send_long(std::vector<unsigned char> bytes, bool paced = false);
+	bool notify_when_written(std::function<void()> callback);
+
+	size_t get_depth() const;
+	uint64_t get_queued() const;
+	uint64_t get_sent() const;
+	uint64_t get_dropped() const;
+
+private:
+	enum ItemFlags : uint8_t { Paced = 1, Long = 2, Marker = 4 };
+	// Long messages and markers keep their payload in the side queues, in the same order
+	struct Item {
+		std::array<unsigned char, 3> bytes;
+		uint8_t size;
+		uint8_t flags;
+	};
+	static constexpr size_t queue_size = 1024;
+	static constexpr size_t max_batch = 64;
+	bool push(const Item &item);
+	void write_loop();
+	void write_items();
+	enum class WriteResult { Written, Failed, Stopped };
+	bool write_batch(const Item *items, size_t count);
+	WriteResult write_bytes(const unsigned char *bytes, size_t size, size_t messages, uint32_t bytes_per_second);
+	bool wait_for_pacing();
+	void report_failed(const Item *items, size_t count);
+	WriteFunction write;
+	FailureFunction failed;
+	Options options;
+	bool multi_message_writes = false;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	// Filled by the senders, swapped out whole by the writer thread
+	std::vector<Item> pending;
+	std::deque<std::vector<unsigned char>> pending_long;
+	std::deque<std::function<void()>> pending_markers;
+	std::vector<Item> writing;
+	std::deque<std::vector<unsigned char>> writing_long;
+	std::deque<std::function<void()>> writing_markers;
+	std::vector<unsigned char> buffer;
+	std::thread writer;
+	bool running = false;
+	std::chrono::steady_clock::time_point next_write;
+	std::atomic<uint64_t> queued{0};
+	std::atomic<uint64_t> sent{0};
+	std::atomic<uint64_t> dropped{0};
+};
@@ -13,6 +13,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #include "obs-controller.h"
 #include "macro-helpers.h"
+#include "source-cache.h"
 #include <thread>
 #ifdef _WIN32
 #include <Windows.h>
@@ -25,80 +26,128 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 Actions::Actions(MidiHook *_hook) : hook{_hook}
 {
-	if (_action_map.isEmpty())
+	if (_action_factories.isEmpty())
 		make_map();
 }
 void Actions::make_map()
 {
-	_action_map.insert(QString("Set_Current_Scene"), new SetCurrentScene());
-	_action_map.insert(QString("Reset_Scene_Item"), new ResetSceneItem());
-	_action_map.insert(QString("Toggle_Mute"), new ToggleMute());
-	_action_map.insert(QString("Do_Transition"), new TransitionToProgram());
-	_action_map.insert(QString("Set_Current_Transition"), new SetCurrentTransition());
-	_action_map.insert(QString("Set_Mute"), new SetMute());
-	_action_map.insert(QString("Toggle_Start_Stop_Streaming"), new StartStopStreaming());
-	_action_map.insert(QString("Set_Preview_Scene"), new SetPreviewScene());
-	_action_map.insert(QString("Set_Current_Scene_Collection"), new SetCurrentSceneCollection());
-	_action_map.insert(QString("Set_Transition_Duration"), new SetTransitionDuration());
-	_action_map.insert(QString("Start_Streaming"), new StartStreaming());
-	_action_map.insert(QString("Stop_Streaming"), new StopStreaming());
-	_action_map.insert(QString("Start_Recording"), new StartRecording());
-	_action_map.insert(QString("Stop_Recording"), new StopRecording());
-	_action_map.insert(QString("Start_Replay_Buffer"), new StartReplayBuffer());
-	_action_map.insert(QString("Stop_Replay_Buffer"), new StopReplayBuffer());
-	_action_map.insert(QString("Set_Volume"), new SetVolume());
-	_action_map.insert(QString("Take_Source_Screenshot"), new TakeSourceScreenshot());
-	_action_map.insert(QString("Pause_Recording"), new PauseRecording());
-	_action_map.insert(QString("Enable_Source_Filter"), new EnableSourceFilter());
-	_action_map.insert(QString("Disable_Source_Filter"), new DisableSourceFilter());
-	_action_map.insert(QString("Toggle_Start_Stop_Recording"), new StartStopRecording());
-	_action_map.insert(QString("Toggle_Start_Stop_Replay_Buffer"), new StartStopReplayBuffer());
-	_action_map.insert(QString("Resume_Recording"), new ResumeRecording());
-	_action_map.insert(QString("Save_Replay_Buffer"), new SaveReplayBuffer());
-	_action_map.insert(QString("Set_Current_Profile"), new SetCurrentProfile());
-	_action_map.insert(QString("Toggle_Source_Filter"), new ToggleSourceFilter());
-	_action_map.insert(QString("Set_Text_GDIPlus_Text"), new SetTextGDIPlusText());
-	_action_map.insert(QString("Set_Browser_Source_URL"), new SetBrowserSourceURL());
-	_action_map.insert(QString("Reload_Browser_Source"), new ReloadBrowserSource());
-	_action_map.insert(QString("Set_Sync_Offset"), new SetSyncOffset());
-	_action_map.insert(QString("Set_Source_Rotation"), new SetSourceRotation());
-	_action_map.insert(QString("Set_Source_Position"), new SetSourcePosition());
-	_action_map.insert(QString("Set_Gain_Filter"), new SetGainFilter());
-	_action_map.insert(QString("Set_Opacity"), new SetOpacity());
-	_action_map.insert(QString("Set_Source_Scale"), new SetSourceScale());
-	_action_map.insert(QString("Move_T_Bar"), new move_t_bar());
-	_action_map.insert(QString("Play_Pause_Media"), new play_pause_media_source());
-	_action_map.insert(QString("Studio_Mode"), new toggle_studio_mode());
-	_action_map.insert(QString("Reset_Stats"), new reset_stats());
-	_action_map.insert(QString("Restart_Media"), new restart_media());
-	_action_map.insert(QString("Stop_Media"), new stop_media());
-	_action_map.insert(QString("Previous_Media"), new prev_media());
-	_action_map.insert(QString("Next_Media"), new next_media());
-	_action_map.insert(QString("Toggle_Source_Visibility"), new ToggleSourceVisibility());
-	_action_map.insert(QString("Take_Screenshot"), new TakeScreenshot());
-	_action_map.insert(QString("Disable_Preview"), new DisablePreview());
-	_action_map.insert(QString("Enable_Preview"), new EnablePreview());
-	_action_map.insert(QString("Toggle_Fade_Source"), new make_opacity_filter());
-	_action_map.insert(QString("Trigger_Hotkey_By_Name"), new TriggerHotkey());
-	_action_map.insert(QString("Trigger Hotkey"), new TriggerHotkey());
+	register_action<SetCurrentScene>(ActionsClass::Actions::Set_Current_Scene);
+	register_action<ResetSceneItem>(ActionsClass::Actions::Reset_Scene_Item);
+	register_action<ToggleMute>(ActionsClass::Actions::Toggle_Mute);
+	register_action<TransitionToProgram>(ActionsClass::Actions::Do_Transition);
+	register_action<SetCurrentTransition>(ActionsClass::Actions::Set_Current_Transition);
+	register_action<SetMute>(ActionsClass::Actions::Set_Mute);
+	register_action<StartStopStreaming>(ActionsClass::Actions::Toggle_Start_Stop_Streaming);
+	register_action<SetPreviewScene>(ActionsClass::Actions::Set_Preview_Scene);
+	register_action<SetCurrentSceneCollection>(ActionsClass::Actions::Set_Current_Scene_Collection);
+	register_action<SetTransitionDuration>(ActionsClass::Actions::Set_Transition_Duration);
+	register_action<StartStreaming>(ActionsClass::Actions::Start_Streaming);
+	register_action<StopStreaming>(ActionsClass::Actions::Stop_Streaming);
+	register_action<StartRecording>(ActionsClass::Actions::Start_Recording);
+	register_action<StopRecording>(ActionsClass::Actions::Stop_Recording);
+	register_action<StartReplayBuffer>(ActionsClass::Actions::Start_Replay_Buffer);
+	register_action<StopReplayBuffer>(ActionsClass::Actions::Stop_Replay_Buffer);
+	register_action<SetVolume>(ActionsClass::Actions::Set_Volume);
+	register_action<TakeSourceScreenshot>(ActionsClass::Actions::Take_Source_Screenshot);
+	register_action<PauseRecording>(ActionsClass::Actions::Pause_Recording);
+	register_action<EnableSourceFilter>(ActionsClass::Actions::Enable_Source_Filter);
+	register_action<DisableSourceFilter>(ActionsClass::Actions::Disable_Source_Filter);
+	register_action<StartStopRecording>(ActionsClass::Actions::Toggle_Start_Stop_Recording);
+	register_action<StartStopReplayBuffer>(ActionsClass::Actions::Toggle_Start_Stop_Replay_Buffer);
+	register_action<ResumeRecording>(ActionsClass::Actions::Resume_Recording);
+	register_action<SaveReplayBuffer>(ActionsClass::Actions::Save_Replay_Buffer);
+	register_action<SetCurrentProfile>(ActionsClass::Actions::Set_Current_Profile);
+	register_action<ToggleSourceFilter>(ActionsClass::Actions::Toggle_Source_Filter);
+	register_action<SetTextGDIPlusText>(ActionsClass::Actions::Set_Text_GDIPlus_Text);
+	register_action<SetBrowserSourceURL>(ActionsClass::Actions::Set_Browser_Source_URL);
+	register_action<ReloadBrowserSource>(ActionsClass::Actions::Reload_Browser_Source);
+	register_action<SetSyncOffset>(ActionsClass::Actions::Set_Sync_Offset);
+	register_action<SetSourceRotation>(ActionsClass::Actions::Set_Source_Rotation);
+	register_action<SetSourcePosition>(ActionsClass::Actions::Set_Source_Position);
+	register_action<SetGainFilter>(ActionsClass::Actions::Set_Gain_Filter);
+	register_action<SetOpacity>(ActionsClass::Actions::Set_Opacity);
+	register_action<SetSourceScale>(ActionsClass::Actions::Set_Source_Scale);
+	register_action<move_t_bar>(ActionsClass::Actions::Move_T_Bar);
+	register_action<play_pause_media_source>(ActionsClass::Actions::Play_Pause_Media);
+	register_action<toggle_studio_mode>(ActionsClass::Actions::Studio_Mode);
+	register_action<reset_stats>(ActionsClass::Actions::Reset_Stats);
+	register_action<restart_media>(ActionsClass::Actions::Restart_Media);
+	register_action<stop_media>(ActionsClass::Actions::Stop_Media);
+	register_action<prev_media>(ActionsClass::Actions::Previous_Media);
+	register_action<next_media>(ActionsClass::Actions::Next_Media);
+	register_action<ToggleSourceVisibility>(ActionsClass::Actions::Toggle_Source_Visibility);
+	register_action<TakeScreenshot>(ActionsClass::Actions::Take_Screenshot);
+	register_action<DisablePreview>(ActionsClass::Actions::Disable_Preview);
+	register_action<EnablePreview>(ActionsClass::Actions::Enable_Preview);
+	register_action<make_opacity_filter>(ActionsClass::Actions::Toggle_Fade_Source);
+	register_action<TriggerHotkey>(ActionsClass::Actions::Trigger_Hotkey_By_Name);
 }
 
-Actions *Actions::make_action(QString action, MidiHook *h)
+void Actions::prepare_factories()
 {
-	Actions *act = _action_map[action];
+	if (_action_factories.isEmpty())
+		make_map();
+}
+/*
+ * Builds a new executor owned by the hook, with its parameters already resolved
+ */
+Actions *Actions::make_action(ActionsClass::Actions action, MidiHook *h)
+{
+	if (_action_factories.isEmpty())
+		make_map();
+	const auto factory = _action_factories.value(action);
+	if (!factory) {
+		blog(LOG_WARNING, "No executor for action %s", ActionsClass::action_to_string(action).qtocs());
+		return nullptr;
+	}
+	Actions *act = factory();
 	act->set_hook(h);
 	return act;
 }
-Actions *Actions::make_action(QString action)
+/*
+ * Returns the shared instance of an action, for building its settings widgets
+ */
+Actions *Actions::make_action(ActionsClass::Actions action)
 {
-	Actions *act = _action_map[action];
-	return act;
+	if (_action_factories.isEmpty())
+		make_map();
+	if (!_action_map.contains(action)) {
+		const auto factory = _action_factories.value(action);
+		if (!factory)
+			return nullptr;
+		_action_map.insert(action, factory());
+	}
+	return _action_map.value(action);
+}
+/*
+ * Copies everything execute() needs out of the hook, converted once
+ */
+void Actions::set_hook(MidiHook *_hook)
+{
+	hook = _hook;
+	params = Params();
+	if (!hook)
+		return;
+	params.scene = hook->scene.toUtf8();
+	params.source = hook->source.toUtf8();
+	params.filter = hook->filter.toUtf8();
+	params.transition = hook->transition.toUtf8();
+	params.audio_source = hook->audio_source.toUtf8();
+	params.media_source = hook->media_source.toUtf8();
+	params.scene_collection = hook->scene_collection.toUtf8();
+	params.profile = hook->profile.toUtf8();
+	params.string_override = hook->string_override.toUtf8();
+	params.duration = hook->duration;
+	params.int_override = hook->int_override;
+	params.range_min = hook->range_min;
+	params.range_max = hook->range_max;
+	prepare();
 }
 QString Actions::get_action_string()
 {
-	return QString(Utils::translate_action_string(hook->action))
+	return QString(Utils::translate_action(*hook->action))
 		.append(" using ")
-		.append(this->hook->message_type)
+		.append(MidiMessage::message_type_to_string(this->hook->message_type))
 		.append(" ")
 		.append(QString::number(this->hook->norc));
 }
@@ -110,7 +159,7 @@ QString Actions::get_action_string()
  */
 void SetCurrentScene::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->scene.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.scene.constData());
 	obs_frontend_set_current_scene(source);
 }
 /**
@@ -121,7 +170,7 @@ void SetPreviewScene::execute()
 	if (!obs_frontend_preview_program_mode_active()) {
 		blog(LOG_INFO, "Can Not Set Preview scene -- studio mode not enabled");
 	}
-	const OBSScene scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
+	const OBSScene scene = Utils::GetSceneFromNameOrCurrent(params.scene.constData());
 	if (!scene) {
 		blog(LOG_DEBUG, "specified scene doesn't exist");
 	}
@@ -130,9 +179,9 @@ void SetPreviewScene::execute()
 }
 QString SetPreviewScene::get_action_string()
 {
-	return QString(Utils::translate_action_string(hook->action))
+	return QString(Utils::translate_action(*hook->action))
 		.append(" using ")
-		.append(this->hook->message_type)
+		.append(MidiMessage::message_type_to_string(this->hook->message_type))
 		.append(" ")
 		.append(QString::number(this->hook->norc));
 }
@@ -164,18 +213,18 @@ void EnablePreview::execute()
 void SetCurrentSceneCollection::execute()
 {
 	// TODO : Check if specified profile exists and if changing is allowed
-	obs_frontend_set_current_scene_collection(hook->scene_collection.toUtf8());
+	obs_frontend_set_current_scene_collection(params.scene_collection.constData());
 }
 /**
  * Reset a scene item.
  */
 void ResetSceneItem::execute()
 {
-	const OBSScene scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
+	const OBSScene scene = Utils::GetSceneFromNameOrCurrent(params.scene.constData());
 	if (!scene) {
 		throw("requested scene doesn't exist");
 	}
-	const OBSSceneItemAutoRelease sceneItem = Utils::GetSceneItemFromName(scene, hook->source);
+	const OBSSceneItemAutoRelease sceneItem = Utils::GetSceneItemFromName(scene, params.source.constData());
 	if (!sceneItem) {
 		throw("specified scene item doesn't exist");
 	}
@@ -191,33 +240,37 @@ void ResetSceneItem::execute()
  * Transitions the currently previewed scene to the main output using specified transition.
  * transitionDuration is optional. (milliseconds)
  */
+void TransitionToProgram::prepare()
+{
+	use_current_transition = (hook->transition == "Current Transition") || hook->transition.isEmpty();
+	use_preview_scene = (hook->scene == "Preview Scene");
+}
 void TransitionToProgram::execute()
 {
 	if (state::transitioning)
 		return;
 	state()._CurrentTransitionDuration = obs_frontend_get_transition_duration();
 	obs_source_t *transition = obs_frontend_get_current_transition();
-	QString scenename;
 	/**
 	 * If Transition from hook is not Current Transition, and if it is not an empty Value, then set current transition
 	 */
-	if ((hook->transition != "Current Transition") && !hook->transition.isEmpty() && !hook->transition.isNull()) {
-		Utils::SetTransitionByName(hook->transition);
+	if (!use_current_transition) {
+		Utils::SetTransitionByName(params.transition.constData());
 		state()._TransitionWasCalled = true;
 	}
-	if ((hook->scene != "Preview Scene") && !hook->scene.isEmpty() && !hook->scene.isNull()) {
+	if (!params.scene.isEmpty()) {
 		state()._TransitionWasCalled = true;
 	}
-	if (hook->scene == "Preview Scene") {
-		obs_source_t *source = obs_frontend_get_current_scene();
-		hook->scene = QString(obs_source_get_name(source));
+	if (params.int_override && *params.int_override > 0) {
+		obs_frontend_set_transition_duration(*params.int_override);
 		state()._TransitionWasCalled = true;
 	}
-	if (hook->int_override && *hook->int_override > 0) {
-		obs_frontend_set_transition_duration(*hook->int_override);
-		state()._TransitionWasCalled = true;
+	if (obs_frontend_preview_program_mode_active()) {
+		obs_frontend_preview_program_trigger_transition();
+	} else if (!use_preview_scene && !params.scene.isEmpty()) {
+		const OBSSource source = GetSourceCache()->get_source(params.scene.constData());
+		obs_frontend_set_current_scene(source);
 	}
-	(obs_frontend_preview_program_mode_active()) ? obs_frontend_preview_program_trigger_transition() : SetCurrentScene().execute();
 
 	state()._CurrentTransition = QString(obs_source_get_name(transition));
 
@@ -259,18 +312,19 @@ QGridLayout *TransitionToProgram::set_widgets()
  */
 void SetCurrentTransition::execute()
 {
-	Utils::SetTransitionByName(hook->transition);
+	Utils::SetTransitionByName(params.transition.constData());
 }
 /**
  * Set the duration of the currently active transition
  */
 void SetTransitionDuration::execute()
 {
-	obs_frontend_set_transition_duration(*hook->duration);
+	obs_frontend_set_transition_duration(params.duration.value_or(0));
 }
 void SetSourceVisibility::execute()
 {
-	obs_sceneitem_set_visible(Utils::GetSceneItemFromName(Utils::GetSceneFromNameOrCurrent(hook->scene), hook->source), *hook->value);
+	obs_sceneitem_set_visible(Utils::GetSceneItemFromName(Utils::GetSceneFromNameOrCurrent(params.scene.constData()), params.source.constData()),
+				  *hook->value);
 }
 /**
  *
@@ -280,7 +334,7 @@ void SetSourceVisibility::execute()
  */
 void ToggleSourceVisibility::execute()
 {
-	const auto scene = Utils::GetSceneItemFromName(Utils::GetSceneFromNameOrCurrent(hook->scene), hook->source);
+	const auto scene = Utils::GetSceneItemFromName(Utils::GetSceneFromNameOrCurrent(params.scene.constData()), params.source.constData());
 	if (obs_sceneitem_visible(scene)) {
 		obs_sceneitem_set_visible(scene, false);
 	} else {
@@ -292,10 +346,10 @@ void ToggleSourceVisibility::execute()
  */
 void ToggleMute::execute()
 {
-	if (hook->audio_source.isEmpty()) {
+	if (params.audio_source.isEmpty()) {
 		throw("sourceName is empty");
 	}
-	obs_source *source = obs_get_source_by_name(hook->audio_source.qtocs());
+	const OBSSource source = GetSourceCache()->get_source(params.audio_source.constData());
 	if (!source) {
 		throw("sourceName not found");
 	}
@@ -306,10 +360,10 @@ void ToggleMute::execute()
  */
 void SetMute::execute()
 {
-	if (hook->source.isEmpty()) {
+	if (params.source.isEmpty()) {
 		throw("sourceName is empty");
 	}
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.source.constData());
 	if (!source) {
 		throw("specified source doesn't exist");
 	}
@@ -317,9 +371,9 @@ void SetMute::execute()
 }
 QString SetMute::get_action_string()
 {
-	return QString(Utils::translate_action_string(hook->action))
+	return QString(Utils::translate_action(*hook->action))
 		.append(" with ")
-		.append(this->hook->message_type)
+		.append(MidiMessage::message_type_to_string(this->hook->message_type))
 		.append(" ")
 		.append(QString::number(this->hook->norc));
 }
@@ -461,27 +515,27 @@ void SaveReplayBuffer::execute()
 }
 void SetCurrentProfile::execute()
 {
-	if (hook->profile.isEmpty()) {
+	if (params.profile.isEmpty()) {
 		throw("profile name is empty");
 	}
 	// TODO : check if profile exists
-	obs_frontend_set_current_profile(hook->profile.toUtf8());
+	obs_frontend_set_current_profile(params.profile.constData());
 }
 void SetTextGDIPlusText::execute() {}
 void SetBrowserSourceURL::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.source.constData());
 	const QString sourceId = obs_source_get_id(source);
 	if (sourceId != "browser_source" && sourceId != "linuxbrowser-source") {
 		return blog(LOG_DEBUG, "Not a browser Source");
 	}
 	const OBSDataAutoRelease settings = obs_source_get_settings(source);
-	obs_data_set_string(settings, "url", hook->string_override.toUtf8());
+	obs_data_set_string(settings, "url", params.string_override.constData());
 	obs_source_update(source, settings);
 }
 void ReloadBrowserSource::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.source.constData());
 	obs_properties_t *sourceProperties = obs_source_properties(source);
 	obs_property_t *property = obs_properties_get(sourceProperties, "refreshnocache");
 	obs_property_button_clicked(property, source); // This returns a boolean but we ignore it because the browser plugin always returns `false`.
@@ -493,39 +547,44 @@ void TakeScreenshot::execute()
 }
 void TakeSourceScreenshot::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->scene.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.scene.constData());
 	obs_frontend_take_source_screenshot(source);
 }
 void EnableSourceFilter::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
-	const OBSSourceAutoRelease filter = obs_source_get_filter_by_name(source, hook->filter.toUtf8());
+	const OBSSource filter = GetSourceCache()->get_filter(params.source.constData(), params.filter.constData());
 	obs_source_set_enabled(filter, true);
 }
 void DisableSourceFilter::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
-	const OBSSourceAutoRelease filter = obs_source_get_filter_by_name(source, hook->filter.toUtf8());
+	const OBSSource filter = GetSourceCache()->get_filter(params.source.constData(), params.filter.constData());
 	obs_source_set_enabled(filter, false);
 }
 void ToggleSourceFilter::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
-	const OBSSourceAutoRelease filter = obs_source_get_filter_by_name(source, hook->filter.toUtf8());
+	const OBSSource filter = GetSourceCache()->get_filter(params.source.constData(), params.filter.constData());
 	if (obs_source_enabled(filter)) {
 		obs_source_set_enabled(filter, false);
 	} else {
 		obs_source_set_enabled(filter, true);
 	}
 }
-void TriggerHotkey::execute()
+void TriggerHotkey::prepare()
 {
 	obs_hotkey_t *obsHotkey = Utils::get_obs_hotkey_by_name(hook->hotkey);
-	if (!obsHotkey) {
+	if (obsHotkey)
+		params.hotkey = obs_hotkey_get_id(obsHotkey);
+}
+void TriggerHotkey::execute()
+{
+	// Hotkeys registered after the hook was built are looked up once here
+	if (params.hotkey == OBS_INVALID_HOTKEY_ID)
+		prepare();
+	if (params.hotkey == OBS_INVALID_HOTKEY_ID) {
 		blog(LOG_ERROR, "ERROR: Triggered hotkey <%s> was not found", hook->hotkey.qtocs());
 		return;
 	}
-	obs_hotkey_trigger_routed_callback(obs_hotkey_get_id(obsHotkey), true);
+	obs_hotkey_trigger_routed_callback(params.hotkey, true);
 }
 
 QString TriggerHotkey::get_action_string()
@@ -534,7 +593,7 @@ QString TriggerHotkey::get_action_string()
 		.append(" ")
 		.append(obs_hotkey_get_description(Utils::get_obs_hotkey_by_name(hook->hotkey)))
 		.append(" using ")
-		.append(hook->message_type)
+		.append(MidiMessage::message_type_to_string(hook->message_type))
 		.append(" ")
 		.append(QString::number(this->hook->norc));
 }
@@ -544,16 +603,16 @@ QString TriggerHotkey::get_action_string()
 ////////////////
 void SetVolume::execute()
 {
-	const OBSSourceAutoRelease obsSource = obs_get_source_by_name(hook->audio_source.toUtf8());
+	const OBSSource obsSource = GetSourceCache()->get_source(params.audio_source.constData());
 	obs_source_set_volume(obsSource, pow(Utils::mapper(*hook->value), 3.0));
 }
 QString SetVolume::get_action_string()
 {
-	return QString(Utils::translate_action_string(hook->action))
+	return QString(Utils::translate_action(*hook->action))
 		.append(" of ")
 		.append(hook->audio_source)
 		.append(" using ")
-		.append(this->hook->message_type)
+		.append(MidiMessage::message_type_to_string(this->hook->message_type))
 		.append(" ")
 		.append(QString::number(this->hook->norc));
 }
@@ -562,31 +621,37 @@ QString SetVolume::get_action_string()
  */
 void SetSyncOffset::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.source.constData());
 	obs_source_set_sync_offset(source, *hook->value);
 }
 void SetSourcePosition::execute() {}
+void SetSourceRotation::prepare()
+{
+	min_rotation = params.range_min.value_or(0);
+	max_rotation = params.range_max.value_or(360);
+}
 void SetSourceRotation::execute()
 {
-	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
-	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, hook->source);
-	uint32_t current = obs_sceneitem_get_alignment(item);
+	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(params.scene.constData());
+	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, params.source.constData());
 	obs_sceneitem_set_alignment(item, OBS_ALIGN_CENTER);
-	const float rotation = Utils::map_to_range((hook->range_min) ? *hook->range_min : 0, (hook->range_max) ? *hook->range_max : 360, *hook->value);
+	const float rotation = Utils::map_to_range(min_rotation, max_rotation, *hook->value);
 	obs_sceneitem_set_rot(item, rotation);
 }
+void SetSourceScale::prepare()
+{
+	max_scale_x = params.range_min.value_or(1);
+	max_scale_y = params.range_max.value_or(1);
+}
 void SetSourceScale::execute()
 {
-	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
-	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, hook->source);
-	uint32_t current = obs_sceneitem_get_alignment(item);
+	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(params.scene.constData());
+	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, params.source.constData());
 	obs_sceneitem_set_alignment(item, OBS_ALIGN_CENTER);
 	obs_sceneitem_set_bounds_type(item, obs_bounds_type::OBS_BOUNDS_NONE);
-	vec2 *scale = new vec2();
-	vec2_set(scale, Utils::map_to_range(0, (hook->range_min) ? *hook->range_min : 1, *hook->value),
-		 Utils::map_to_range(0, (hook->range_max) ? *hook->range_max : 1, *hook->value));
-	obs_sceneitem_set_scale(item, scale);
-	delete (scale);
+	vec2 scale;
+	vec2_set(&scale, Utils::map_to_range(0, max_scale_x, *hook->value), Utils::map_to_range(0, max_scale_y, *hook->value));
+	obs_sceneitem_set_scale(item, &scale);
 }
 void SetGainFilter::execute() {}
 void SetOpacity::execute() {}
@@ -599,7 +664,7 @@ void move_t_bar::execute()
 }
 void play_pause_media_source::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	switch (obs_source_media_get_state(source)) {
 	case obs_media_state::OBS_MEDIA_STATE_PAUSED:
 		obs_source_media_play_pause(source, false);
@@ -637,27 +702,27 @@ void toggle_studio_mode::execute()
 void reset_stats::execute() {}
 void restart_media::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	obs_source_media_restart(source);
 }
 void play_media::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	obs_source_media_play_pause(source, false);
 }
 void stop_media::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	obs_source_media_stop(source);
 }
 void next_media::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	obs_source_media_next(source);
 }
 void prev_media::execute()
 {
-	const OBSSourceAutoRelease source = obs_get_source_by_name(hook->media_source.toUtf8());
+	const OBSSource source = GetSourceCache()->get_source(params.media_source.constData());
 	obs_source_media_previous(source);
 }
 
@@ -666,7 +731,7 @@ float time_to_sleep(float duration)
 	return duration / 2000;
 }
 
-void fade_in_scene_item(MidiHook *hook)
+void fade_in_scene_item(const QByteArray &scene_name, const QByteArray &source_name, int duration)
 {
 	try {
 		std::thread th{[=]() {
@@ -674,11 +739,11 @@ void fade_in_scene_item(MidiHook *hook)
 			obs_data_set_double(data, "opacity", 0);
 			OBSSourceAutoRelease filter = obs_source_create_private("color_filter", "ColorFilter", data);
 
-			obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
-			obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, hook->source);
+			obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(scene_name.constData());
+			obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, source_name.constData());
 			obs_source_t *source = obs_sceneitem_get_source(item);
 			float i = 0;
-			float tts = time_to_sleep((hook->int_override) ? (float)*hook->int_override : 500.0f);
+			float tts = time_to_sleep((float)duration);
 			obs_source_filter_add(source, filter);
 			obs_sceneitem_set_visible(item, true);
 
@@ -701,7 +766,7 @@ void fade_in_scene_item(MidiHook *hook)
 	}
 }
 
-void fade_out_scene_item(MidiHook *hook)
+void fade_out_scene_item(const QByteArray &scene_name, const QByteArray &source_name, int duration)
 {
 	try {
 
@@ -710,11 +775,11 @@ void fade_out_scene_item(MidiHook *hook)
 			obs_data_set_double(data, "opacity", 100);
 			OBSSourceAutoRelease filter = obs_source_create_private("color_filter", "ColorFilter", data);
 
-			obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
-			obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, hook->source);
+			obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(scene_name.constData());
+			obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, source_name.constData());
 			obs_source_t *source = obs_sceneitem_get_source(item);
 			float i = 100;
-			float tts = time_to_sleep((hook->int_override) ? (float)*hook->int_override : 500.0f);
+			float tts = time_to_sleep((float)duration);
 			obs_source_filter_add(source, filter);
 			while (i >= 0) {
 				obs_data_set_double(data, "opacity", i);
@@ -735,9 +800,11 @@ void fade_out_scene_item(MidiHook *hook)
 }
 void make_opacity_filter::execute()
 {
-	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(hook->scene);
-	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, hook->source);
-	(obs_sceneitem_visible(item)) ? fade_out_scene_item(hook) : fade_in_scene_item(hook);
+	obs_scene_t *scene = Utils::GetSceneFromNameOrCurrent(params.scene.constData());
+	obs_sceneitem_t *item = Utils::GetSceneItemFromName(scene, params.source.constData());
+	const int duration = params.int_override.value_or(500);
+	(obs_sceneitem_visible(item)) ? fade_out_scene_item(params.scene, params.source, duration)
+				      : fade_in_scene_item(params.scene, params.source, duration);
 }
 
 QGridLayout *MediaActions::set_widgets()
@@ -33,10 +33,14 @@ class Actions : public QObject {
 public:
 	Actions(){};
 	Actions(MidiHook *_hook);
-	void set_hook(MidiHook *_hook) { hook = _hook; }
+	void set_hook(MidiHook *_hook);
 	virtual void execute(){};
-	static Actions *make_action(QString action, MidiHook *h);
-	static Actions *make_action(QString action);
+	// Continuous actions only care about the newest value, see MidiHook::coalesce
+	virtual bool is_continuous() const { return false; }
+	static Actions *make_action(ActionsClass::Actions action, MidiHook *h);
+	static Actions *make_action(ActionsClass::Actions action);
+	// Fills the factory map, must run on one thread before hooks are built on others
+	static void prepare_factories();
 	virtual QString get_action_string();
 	virtual void set_data(obs_data_t *data){};
 	virtual void set_data(QString datastring){};
@@ -49,11 +53,40 @@ public:
 	};
 
 protected:
-	MidiHook *hook;
+	/*
+	 * Hook parameters resolved once when the executor is built,
+	 * execute() only reads these and never converts strings.
+	 */
+	struct Params {
+		QByteArray scene;
+		QByteArray source;
+		QByteArray filter;
+		QByteArray transition;
+		QByteArray audio_source;
+		QByteArray media_source;
+		QByteArray scene_collection;
+		QByteArray profile;
+		QByteArray string_override;
+		obs_hotkey_id hotkey = OBS_INVALID_HOTKEY_ID;
+		std::optional<int> duration;
+		std::optional<int> int_override;
+		std::optional<int> range_min;
+		std::optional<int> range_max;
+	};
+	// Per action precomputation, runs after params are filled in
+	virtual void prepare(){};
+	MidiHook *hook = nullptr;
+	Params params;
 
 private:
 	static void make_map();
-	inline static QMap<QString, Actions *> _action_map;
+	template<typename T> static void register_action(ActionsClass::Actions action)
+	{
+		_action_factories.insert(action, []() -> Actions * { return new T(); });
+	}
+	inline static QMap<ActionsClass::Actions, Actions *(*)()> _action_factories;
+	// One shared instance per action, only used by the settings dialog to build widgets
+	inline static QMap<ActionsClass::Actions, Actions *> _action_map;
 };
 class AudioActions : public Actions {
 	QGridLayout *set_widgets() override;
@@ -83,10 +116,7 @@ public:
 	SetCurrentScene(){};
 	void execute() override;
 
-	QString get_action_string() override { return QString("Set Current Scene to ").append(scene); }
-
-private:
-	QString scene;
+	QString get_action_string() override { return QString("Set Current Scene to ").append(QString::fromUtf8(params.scene)); }
 };
 /**
  * Actions
@@ -127,6 +157,13 @@ public:
 	QComboBox *transition;
 	QSpinBox *duration;
 	QCheckBox *enable_duration;
+
+protected:
+	void prepare() override;
+
+private:
+	bool use_preview_scene = false;
+	bool use_current_transition = true;
 };
 class SetCurrentTransition : public Actions {
 public:
@@ -274,6 +311,9 @@ public:
 	TriggerHotkey(){};
 	void execute() override;
 	QString get_action_string() override;
+
+protected:
+	void prepare() override;
 };
 
 // CC ACTIONS
@@ -281,6 +321,7 @@ class SetVolume : public AudioActions {
 public:
 	SetVolume(){};
 	void execute() override;
+	bool is_continuous() const override { return true; }
 	QString get_action_string() override;
 };
 class SetSyncOffset : public Actions {
@@ -297,11 +338,27 @@ class SetSourceRotation : public Actions {
 public:
 	SetSourceRotation(){};
 	void execute() override;
+	bool is_continuous() const override { return true; }
+
+protected:
+	void prepare() override;
+
+private:
+	int min_rotation = 0;
+	int max_rotation = 360;
 };
 class SetSourceScale : public Actions {
 public:
 	SetSourceScale(){};
 	void execute() override;
+	bool is_continuous() const override { return true; }
+
+protected:
+	void prepare() override;
+
+private:
+	int max_scale_x = 1;
+	int max_scale_y = 1;
 };
 class SetGainFilter : public Actions {
 public:
@@ -317,6 +374,7 @@ class move_t_bar : public Actions {
 public:
 	move_t_bar(){};
 	void execute() override;
+	bool is_continuous() const override { return true; }
 };
 class play_pause_media_source : public MediaActions {
 public:
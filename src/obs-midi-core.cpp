@@ -0,0 +1,82 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include "obs-midi.h"
+
+#include "config.h"
+#include "device-manager.h"
+#include "events.h"
+#include "source-cache.h"
+
+void ___source_dummy_addref(obs_source_t *) {}
+void ___sceneitem_dummy_addref(obs_sceneitem_t *) {}
+void ___data_dummy_addref(obs_data_t *) {}
+void ___data_array_dummy_addref(obs_data_array_t *) {}
+void ___output_dummy_addref(obs_output_t *) {}
+
+void ___data_item_dummy_addref(obs_data_item_t *) {}
+void ___data_item_release(obs_data_item_t *dataItem)
+{
+	obs_data_item_release(&dataItem);
+}
+
+ConfigPtr _config;
+DeviceManagerPtr _deviceManager;
+eventsPtr _eventsSystem;
+SourceCachePtr _sourceCache;
+
+/*
+ * Brings up everything but the UI: events, source cache, devices and their config.
+ * The plugin module calls it from obs_module_load, headless builds from their own main.
+ */
+void LoadCore()
+{
+	qRegisterMetaType<MidiMessage>();
+	qRegisterMetaType<RpcEvent>();
+	_eventsSystem = eventsPtr(new Events());
+	_sourceCache = SourceCachePtr(new SourceCache());
+	_deviceManager = DeviceManagerPtr(new DeviceManager());
+	_config = ConfigPtr(new Config());
+}
+void UnloadCore()
+{
+	// Changes still waiting for their quiet period are written while the devices are there
+	_config->flush();
+	_eventsSystem.get()->shutdown();
+	_eventsSystem.reset();
+	_deviceManager.reset();
+	_config.reset();
+	blog(LOG_INFO, "Source cache: %llu hits, %llu misses", (unsigned long long)_sourceCache->get_hits(),
+	     (unsigned long long)_sourceCache->get_misses());
+	_sourceCache.reset();
+}
+
+ConfigPtr GetConfig()
+{
+	return _config;
+}
+
+DeviceManagerPtr GetDeviceManager()
+{
+	return _deviceManager;
+}
+
+eventsPtr GetEventsSystem()
+{
+	return _eventsSystem;
+}
+
+SourceCachePtr GetSourceCache()
+{
+	return _sourceCache;
+}
@@ -1,3 +1,4 @@
+#include <QtCore/QPointer>
 #include <QtWidgets/QAction>
 #include <QtWidgets/QMainWindow>
 
@@ -19,64 +20,37 @@
 #include "device-manager.h"
 
 #include "events.h"
+#include "source-cache.h"
 using namespace std;
 
-void ___source_dummy_addref(obs_source_t *) {}
-void ___sceneitem_dummy_addref(obs_sceneitem_t *) {}
-void ___data_dummy_addref(obs_data_t *) {}
-void ___data_array_dummy_addref(obs_data_array_t *) {}
-void ___output_dummy_addref(obs_output_t *) {}
-
-void ___data_item_dummy_addref(obs_data_item_t *) {}
-void ___data_item_release(obs_data_item_t *dataItem)
-{
-	obs_data_item_release(&dataItem);
-}
-
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-midi", "en-US")
-ConfigPtr _config;
-DeviceManagerPtr _deviceManager;
-eventsPtr _eventsSystem;
+// Built the first time the Tools menu entry is used, deleted again when it is closed
+static QPointer<PluginWindow> plugin_window;
 bool obs_module_load(void)
 {
 	blog(LOG_INFO, "MIDI LOADED! :)");
 	blog(LOG_INFO, "obs-midi version %s", GIT_TAG);
-	qRegisterMetaType<MidiMessage>();
-	_eventsSystem = eventsPtr(new Events());
-	_deviceManager = DeviceManagerPtr(new DeviceManager());
-	_config = ConfigPtr(new Config());
+	LoadCore();
 	blog(LOG_DEBUG, "Setup UI");
 	auto *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-	plugin_window = new PluginWindow(mainWindow);
 	const char *menuActionText = obs_module_text("OBS MIDI Settings");
 	auto *menuAction = (QAction *)obs_frontend_add_tools_menu_qaction(menuActionText);
-	QObject::connect(menuAction, SIGNAL(triggered()), plugin_window, SLOT(ToggleShowHide()));
+	QObject::connect(menuAction, &QAction::triggered, [mainWindow]() {
+		if (!plugin_window) {
+			plugin_window = new PluginWindow(mainWindow);
+			plugin_window->setAttribute(Qt::WA_DeleteOnClose);
+		}
+		plugin_window->ToggleShowHide();
+	});
 	blog(LOG_DEBUG, "OBSMIDI: Setup Complete");
 	return true;
 }
 
 void obs_module_unload()
 {
-	_eventsSystem.get()->shutdown();
-	_eventsSystem.reset();
-	_deviceManager.reset();
-	_config.reset();
-
+	// An open settings window points at the devices, it goes first
+	delete plugin_window.data();
+	UnloadCore();
 	blog(LOG_DEBUG, "goodbye!");
 }
-
-ConfigPtr GetConfig()
-{
-	return _config;
-}
-
-DeviceManagerPtr GetDeviceManager()
-{
-	return _deviceManager;
-}
-
-eventsPtr GetEventsSystem()
-{
-	return _eventsSystem;
-}
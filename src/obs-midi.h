@@ -24,13 +24,17 @@ using OBSDataItemAutoRelease = OBSRef<obs_data_item_t *, ___data_item_dummy_addr
 class Events;
 class Config;
 class DeviceManager;
-class PluginWindow;
+class SourceCache;
 typedef std::shared_ptr<Events> eventsPtr;
 typedef std::shared_ptr<Config> ConfigPtr;
 typedef std::shared_ptr<DeviceManager> DeviceManagerPtr;
+typedef std::shared_ptr<SourceCache> SourceCachePtr;
 ConfigPtr GetConfig();
 DeviceManagerPtr GetDeviceManager();
 eventsPtr GetEventsSystem();
-static PluginWindow *plugin_window;
+SourceCachePtr GetSourceCache();
+// Everything but the UI, shared by the plugin module and headless builds
+void LoadCore();
+void UnloadCore();
 #define OBS_MIDI_VERSION "0.1"
 #define blog(level, msg, ...) blog(level, "[obs-midi] " msg, ##__VA_ARGS__)
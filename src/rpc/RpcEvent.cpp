@@ -18,19 +18,158 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #include "RpcEvent.h"
 
+#include <mutex>
 #include <utility>
 
+#include <QtCore/QMetaEnum>
+
 #include "obs-data.h"
+#include "../events.h"
+#include "../utils.h"
 
-RpcEvent::RpcEvent(QString updateType, std::optional<uint64_t> streamTime, std::optional<uint64_t> recordingTime, obs_data_t *additionalFields)
-	: _updateType(std::move(updateType)), _streamTime(streamTime), _recordingTime(recordingTime), _additionalFields(nullptr)
-{
-	if (additionalFields) {
-		_additionalFields = obs_data_create();
-		obs_data_apply(_additionalFields, additionalFields);
+struct RpcEvent::Data {
+	Type type = None;
+	Payload payload;
+	OBSData fields;
+	// Lazily filled in, guarded by their once flags
+	mutable std::once_flag times_once;
+	mutable std::optional<uint64_t> stream_time;
+	mutable std::optional<uint64_t> recording_time;
+	mutable std::once_flag fields_once;
+	mutable OBSData payload_fields;
+	mutable std::once_flag items_once;
+	mutable OBSDataArray scene_items;
+};
+namespace {
+// Builds the obs_data view of a typed payload, with the keys the events always had
+struct PayloadFields {
+	obs_data_t *data;
+	void operator()(const std::monostate &) const {}
+	void operator()(const RpcEvent::SourcePayload &p) const { obs_data_set_string(data, "sourceName", p.source.toUtf8().constData()); }
+	void operator()(const RpcEvent::VolumePayload &p) const
+	{
+		obs_data_set_string(data, "sourceName", p.source.toUtf8().constData());
+		obs_data_set_double(data, "volume", p.volume);
+	}
+	void operator()(const RpcEvent::MutePayload &p) const
+	{
+		obs_data_set_string(data, "sourceName", p.source.toUtf8().constData());
+		obs_data_set_bool(data, "muted", p.muted);
+	}
+	void operator()(const RpcEvent::RenamePayload &p) const
+	{
+		obs_data_set_string(data, "previousName", p.previous_name.toUtf8().constData());
+		obs_data_set_string(data, "newName", p.new_name.toUtf8().constData());
 	}
+	void operator()(const RpcEvent::ScenePayload &p) const { obs_data_set_string(data, "scene-name", p.scene.toUtf8().constData()); }
+	void operator()(const RpcEvent::TransitionPayload &p) const { obs_data_set_string(data, "transition-name", p.transition.toUtf8().constData()); }
+	void operator()(const RpcEvent::FilterPayload &p) const
+	{
+		obs_data_set_string(data, "sourceName", p.source.toUtf8().constData());
+		obs_data_set_string(data, "filterName", p.filter.toUtf8().constData());
+		obs_data_set_bool(data, "filterEnabled", p.enabled);
+	}
+	void operator()(const RpcEvent::SceneItemPayload &p) const
+	{
+		obs_data_set_string(data, "scene-name", p.scene.toUtf8().constData());
+		obs_data_set_string(data, "item-name", p.item.toUtf8().constData());
+		obs_data_set_int(data, "item-id", p.item_id);
+		obs_data_set_bool(data, "item-visible", p.visible);
+	}
+	void operator()(const RpcEvent::StatePayload &p) const { obs_data_set_bool(data, "new-state", p.state); }
+};
+}
+RpcEvent::RpcEvent()
+{
+	static const std::shared_ptr<const Data> empty = std::make_shared<Data>();
+	d = empty;
+}
+RpcEvent::RpcEvent(Type type, Payload payload)
+{
+	auto data = std::make_shared<Data>();
+	data->type = type;
+	data->payload = std::move(payload);
+	d = std::move(data);
+}
+RpcEvent::RpcEvent(Type type, obs_data_t *fields)
+{
+	auto data = std::make_shared<Data>();
+	data->type = type;
+	data->fields = fields;
+	d = std::move(data);
+}
+RpcEvent::Type RpcEvent::type() const
+{
+	return d->type;
+}
+QString RpcEvent::updateType() const
+{
+	return type_to_string(d->type);
+}
+const RpcEvent::Payload &RpcEvent::payload() const
+{
+	return d->payload;
+}
+std::optional<uint64_t> RpcEvent::streamTime() const
+{
+	std::call_once(d->times_once, [this]() {
+		const auto events = GetEventsSystem();
+		if (!events)
+			return;
+		if (obs_frontend_streaming_active())
+			d->stream_time = events->getStreamingTime();
+		if (obs_frontend_recording_active())
+			d->recording_time = events->getRecordingTime();
+	});
+	return d->stream_time;
+}
+std::optional<uint64_t> RpcEvent::recordingTime() const
+{
+	streamTime();
+	return d->recording_time;
+}
+/*
+ * obs_data view of the event, the raised fields or the payload written out with the usual keys
+ */
+OBSData RpcEvent::additionalFields() const
+{
+	if (d->fields)
+		return d->fields;
+	std::call_once(d->fields_once, [this]() {
+		obs_data_t *data = obs_data_create();
+		std::visit(PayloadFields{data}, d->payload);
+		const OBSDataArray items = sceneItems();
+		if (items)
+			obs_data_set_array(data, "sources", items);
+		d->payload_fields = data;
+		obs_data_release(data);
+	});
+	return d->payload_fields;
+}
+OBSDataArray RpcEvent::sceneItems() const
+{
+	const auto scene = get<ScenePayload>();
+	if (!scene)
+		return nullptr;
+	std::call_once(d->items_once, [this, scene]() {
+		const OBSSource source = OBSGetStrongRef(scene->source);
+		if (!source)
+			return;
+		obs_data_array_t *items = Utils::GetSceneItemArray(source);
+		d->scene_items = items;
+		obs_data_array_release(items);
+	});
+	return d->scene_items;
+}
+QString RpcEvent::type_to_string(Type type)
+{
+	return QString(QMetaEnum::fromType<Type>().valueToKey(type));
 }
-RpcEvent::~RpcEvent()
+std::optional<RpcEvent::Type> RpcEvent::type_from_string(const QString &string)
 {
-	obs_data_release(_additionalFields);
+	bool ok = false;
+	const int value = QMetaEnum::fromType<Type>().keyToValue(string.toUtf8().constData(), &ok);
+	if (!ok)
+		return std::nullopt;
+	return (Type)value;
 }
@@ -18,29 +18,157 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #pragma once
 
+#include <memory>
 #include <optional>
+#include <variant>
 #include <obs-data.h>
+#include <QtCore/QMetaType>
+#include <QtCore/QObject>
 #include <QtCore/QString>
 
 #include "../obs-midi.h"
 
+/*
+ * An OBS event as seen by the plugin.
+ * Events are immutable and shared: copying one only bumps a reference count, so the
+ * same event reaches every receiver (queued or direct) without copying its payload.
+ * The events the plugin reacts to carry a typed payload, the rest keep the obs_data
+ * they were raised with. additionalFields() gives the obs_data view of either kind,
+ * it is meant for logging and debugging, not for the hot path.
+ */
 class RpcEvent {
+	Q_GADGET
 public:
-	explicit RpcEvent(QString updateType, std::optional<uint64_t> streamTime, std::optional<uint64_t> recordingTime,
-			  obs_data_t *additionalFields = nullptr);
-	~RpcEvent();
+	enum Type {
+		None, // default constructed events only
+		SourceDestroyed,
+		SourceRemoved,
+		SceneCollectionChanged,
+		SceneCollectionListChanged,
+		TransitionListChanged,
+		ProfileChanged,
+		ProfileListChanged,
+		StreamStarting,
+		StreamStarted,
+		StreamStopping,
+		StreamStopped,
+		StreamStatus,
+		RecordingStarting,
+		RecordingStarted,
+		RecordingStopping,
+		RecordingStopped,
+		RecordingPaused,
+		RecordingResumed,
+		ReplayStarting,
+		ReplayStarted,
+		ReplayStopping,
+		ReplayStopped,
+		StudioModeSwitched,
+		PreviewSceneChanged,
+		Exiting,
+		LoadingFinished,
+		Heartbeat,
+		TransitionBegin,
+		TransitionEnd,
+		TransitionVideoEnd,
+		SourceCreated,
+		SourceVolumeChanged,
+		SourceMuteStateChanged,
+		SourceAudioSyncOffsetChanged,
+		SourceAudioMixersChanged,
+		SourceRenamed,
+		SourceFilterAdded,
+		SourceFilterRemoved,
+		SourceFilterVisibilityChanged,
+		SourceFiltersReordered,
+		SourceOrderChanged,
+		SceneItemAdded,
+		SceneItemRemoved,
+		SceneItemVisibilityChanged,
+		SceneItemLockChanged,
+		SceneItemTransformChanged,
+		SceneItemSelected,
+		SceneItemDeselected,
+		ScenesChanged,
+		SwitchScenes,
+		SwitchTransition,
+		TransitionDurationChanged,
+		BroadcastCustomMessage
+	};
+	Q_ENUM(Type)
+
+	// SourceCreated, SourceDestroyed, SourceRemoved
+	struct SourcePayload {
+		QString source;
+	};
+	// SourceVolumeChanged
+	struct VolumePayload {
+		QString source;
+		double volume;
+	};
+	// SourceMuteStateChanged
+	struct MutePayload {
+		QString source;
+		bool muted;
+	};
+	// SourceRenamed
+	struct RenamePayload {
+		QString previous_name;
+		QString new_name;
+	};
+	// SwitchScenes, PreviewSceneChanged
+	struct ScenePayload {
+		QString scene;
+		OBSWeakSource source; // for sceneItems(), does not keep the scene alive
+	};
+	// SwitchTransition
+	struct TransitionPayload {
+		QString transition;
+	};
+	// SourceFilterAdded, SourceFilterRemoved, SourceFilterVisibilityChanged
+	struct FilterPayload {
+		QString source;
+		QString filter;
+		bool enabled;
+	};
+	// SceneItemVisibilityChanged
+	struct SceneItemPayload {
+		QString scene;
+		QString item;
+		int64_t item_id;
+		bool visible;
+	};
+	// StudioModeSwitched
+	struct StatePayload {
+		bool state;
+	};
+	typedef std::variant<std::monostate, SourcePayload, VolumePayload, MutePayload, RenamePayload, ScenePayload, TransitionPayload, FilterPayload,
+			     SceneItemPayload, StatePayload>
+		Payload;
+
+	RpcEvent();
+	explicit RpcEvent(Type type, Payload payload = std::monostate());
+	// Keeps a reference to fields, they must not be changed afterwards
+	RpcEvent(Type type, obs_data_t *fields);
 
-	const QString &updateType() const { return _updateType; }
+	Type type() const;
+	QString updateType() const;
+	const Payload &payload() const;
+	template<typename T> const T *get() const { return std::get_if<T>(&payload()); }
 
-	const std::optional<uint64_t> &streamTime() const { return _streamTime; }
+	// Read from the outputs the first time they are asked for, then kept
+	std::optional<uint64_t> streamTime() const;
+	std::optional<uint64_t> recordingTime() const;
 
-	const std::optional<uint64_t> &recordingTime() const { return _recordingTime; }
+	OBSData additionalFields() const;
+	// Items of the scene a scene event is about, built on first call, nullptr for other events
+	OBSDataArray sceneItems() const;
 
-	OBSData additionalFields() const { return OBSData(_additionalFields); }
+	static QString type_to_string(Type type);
+	static std::optional<Type> type_from_string(const QString &string);
 
 private:
-	QString _updateType;
-	std::optional<uint64_t> _streamTime;
-	std::optional<uint64_t> _recordingTime;
-	obs_data_t *_additionalFields;
+	struct Data;
+	std::shared_ptr<const Data> d;
 };
+Q_DECLARE_METATYPE(RpcEvent);
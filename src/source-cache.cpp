@@ -0,0 +1,206 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#include <cstring>
+
+#if __has_include(<obs-frontend-api.h>)
+#include <obs-frontend-api.h>
+#else
+#include <obs-frontend-api/obs-frontend-api.h>
+#endif
+
+#include "source-cache.h"
+#include "events.h"
+
+static bool name_matches(obs_source_t *source, const char *name)
+{
+	const char *current = obs_source_get_name(source);
+	return current && strcmp(current, name) == 0;
+}
+SourceCache::SourceCache()
+{
+	// Direct, so entries are gone before the event reaches anything queued behind it
+	connect(GetEventsSystem().get(), &Events::obsEvent, this, &SourceCache::handle_obs_event, Qt::DirectConnection);
+}
+/*
+ * Returns the source (or scene) with that name, or nullptr
+ */
+OBSSource SourceCache::get_source(const char *name)
+{
+	if (!name || !*name)
+		return nullptr;
+	const OBSSource cached = lookup(sources, name);
+	if (cached && !obs_source_removed(cached) && name_matches(cached, name)) {
+		hits.fetch_add(1, std::memory_order_relaxed);
+		return cached;
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	const OBSSourceAutoRelease source = obs_get_source_by_name(name);
+	if (!source)
+		return nullptr;
+	const OBSWeakSource weak = OBSGetWeakRef(source);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		sources.insert(QByteArray(name), weak);
+	}
+	return OBSSource(source);
+}
+/*
+ * Returns the filter called filter_name on the source called source_name, or nullptr
+ */
+OBSSource SourceCache::get_filter(const char *source_name, const char *filter_name)
+{
+	if (!source_name || !*source_name || !filter_name || !*filter_name)
+		return nullptr;
+	const FilterKey key(QByteArray::fromRawData(source_name, (int)strlen(source_name)), QByteArray::fromRawData(filter_name, (int)strlen(filter_name)));
+	OBSWeakSource weak;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		weak = filters.value(key);
+	}
+	const OBSSource cached = OBSGetStrongRef(weak);
+	if (cached && !obs_source_removed(cached) && name_matches(cached, filter_name)) {
+		obs_source_t *parent = obs_filter_get_parent(cached);
+		if (parent && name_matches(parent, source_name)) {
+			hits.fetch_add(1, std::memory_order_relaxed);
+			return cached;
+		}
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	const OBSSource parent = get_source(source_name);
+	if (!parent)
+		return nullptr;
+	const OBSSourceAutoRelease filter = obs_source_get_filter_by_name(parent, filter_name);
+	if (!filter)
+		return nullptr;
+	const OBSWeakSource filter_weak = OBSGetWeakRef(filter);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		filters.insert(FilterKey(QByteArray(source_name), QByteArray(filter_name)), filter_weak);
+	}
+	return OBSSource(filter);
+}
+/*
+ * Returns the frontend transition with that name, or nullptr.
+ * A miss walks the transition list once and caches all of them.
+ */
+OBSSource SourceCache::get_transition(const char *name)
+{
+	if (!name || !*name)
+		return nullptr;
+	const OBSSource cached = lookup(transitions, name);
+	if (cached && name_matches(cached, name)) {
+		hits.fetch_add(1, std::memory_order_relaxed);
+		return cached;
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	OBSSource found;
+	QHash<QByteArray, OBSWeakSource> found_transitions;
+	obs_frontend_source_list transition_list = {};
+	obs_frontend_get_transitions(&transition_list);
+	for (size_t i = 0; i < transition_list.sources.num; i++) {
+		obs_source_t *transition = transition_list.sources.array[i];
+		const char *transition_name = obs_source_get_name(transition);
+		if (!transition_name)
+			continue;
+		found_transitions.insert(QByteArray(transition_name), OBSGetWeakRef(transition));
+		if (strcmp(transition_name, name) == 0)
+			found = transition;
+	}
+	obs_frontend_source_list_free(&transition_list);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		transitions.swap(found_transitions);
+	}
+	return found;
+}
+/*
+ * Copies the weak reference out under the lock, the strong reference is taken outside it
+ * because dropping the last reference to a source fires events that come back here.
+ */
+OBSSource SourceCache::lookup(QHash<QByteArray, OBSWeakSource> &cache, const char *name)
+{
+	OBSWeakSource weak;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		weak = cache.value(QByteArray::fromRawData(name, (int)strlen(name)));
+	}
+	return OBSGetStrongRef(weak);
+}
+void SourceCache::invalidate_source(const QByteArray &name)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	sources.remove(name);
+	transitions.remove(name);
+	for (auto it = filters.begin(); it != filters.end();) {
+		if (it.key().first == name || it.key().second == name)
+			it = filters.erase(it);
+		else
+			++it;
+	}
+}
+void SourceCache::invalidate_filter(const QByteArray &source_name, const QByteArray &filter_name)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	filters.remove(FilterKey(source_name, filter_name));
+}
+void SourceCache::invalidate_transitions()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	transitions.clear();
+}
+void SourceCache::clear()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	sources.clear();
+	filters.clear();
+	transitions.clear();
+}
+uint64_t SourceCache::get_hits() const
+{
+	return hits.load(std::memory_order_relaxed);
+}
+uint64_t SourceCache::get_misses() const
+{
+	return misses.load(std::memory_order_relaxed);
+}
+/*
+ * Runs on whichever thread libobs raised the event on
+ */
+void SourceCache::handle_obs_event(const RpcEvent &event)
+{
+	switch (event.type()) {
+	case RpcEvent::SourceRenamed:
+		invalidate_source(event.get<RpcEvent::RenamePayload>()->previous_name.toUtf8());
+		break;
+	case RpcEvent::SourceCreated:
+	case RpcEvent::SourceDestroyed:
+	case RpcEvent::SourceRemoved:
+		invalidate_source(event.get<RpcEvent::SourcePayload>()->source.toUtf8());
+		break;
+	case RpcEvent::SourceFilterAdded:
+	case RpcEvent::SourceFilterRemoved: {
+		const auto filter = event.get<RpcEvent::FilterPayload>();
+		invalidate_filter(filter->source.toUtf8(), filter->filter.toUtf8());
+		break;
+	}
+	case RpcEvent::TransitionListChanged:
+		invalidate_transitions();
+		break;
+	case RpcEvent::SceneCollectionChanged:
+		clear();
+		break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,59 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <atomic>
+#include <mutex>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+
+#include <obs.hpp>
+
+#include "rpc/RpcEvent.h"
+
+/*
+ * Source Cache
+ * Name to weak reference cache for sources (scenes included), filters and transitions,
+ * so actions do not take the libobs name lookup locks on every trigger.
+ * Entries are dropped on the matching OBS events, and every hit is checked against the
+ * current name of the source so a missed event costs a lookup, never a wrong source.
+ */
+class SourceCache : public QObject {
+	Q_OBJECT
+public:
+	SourceCache();
+	OBSSource get_source(const char *name);
+	OBSSource get_filter(const char *source_name, const char *filter_name);
+	OBSSource get_transition(const char *name);
+	void clear();
+	uint64_t get_hits() const;
+	uint64_t get_misses() const;
+public slots:
+	void handle_obs_event(const RpcEvent &event);
+
+private:
+	typedef QPair<QByteArray, QByteArray> FilterKey;
+	void invalidate_source(const QByteArray &name);
+	void invalidate_filter(const QByteArray &source_name, const QByteArray &filter_name);
+	void invalidate_transitions();
+	OBSSource lookup(QHash<QByteArray, OBSWeakSource> &cache, const char *name);
+	std::mutex cache_mutex;
+	QHash<QByteArray, OBSWeakSource> sources;
+	QHash<FilterKey, OBSWeakSource> filters;
+	QHash<QByteArray, OBSWeakSource> transitions;
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> misses{0};
+};
@@ -0,0 +1,60 @@
+/*
+obs-midi
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/*
+ * Bounded lock free single producer / single consumer ring buffer.
+ * push() may only be called from one thread and pop() from one other thread.
+ * Capacity must be a power of two, items must be trivially copyable.
+ */
+template<typename T, size_t Capacity> class SpscQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+	static_assert(std::is_trivially_copyable_v<T>, "SpscQueue items must be trivially copyable");
+
+public:
+	/* Producer side, returns false when the queue is full */
+	bool push(const T &item)
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+		slots[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+	/* Consumer side, copies up to max items into out and returns how many were taken */
+	size_t pop(T *out, size_t max)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		const size_t available = head.load(std::memory_order_acquire) - t;
+		const size_t count = (available < max) ? available : max;
+		for (size_t i = 0; i < count; i++)
+			out[i] = slots[(t + i) & (Capacity - 1)];
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+	/* Approximate when called while the other side is running */
+	size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+	bool empty() const { return size() == 0; }
+	static constexpr size_t capacity() { return Capacity; }
+
+private:
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+	alignas(64) std::array<T, Capacity> slots{};
+};
@@ -1,7 +1,18 @@
 #include <cinttypes>
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
 #include <QtWidgets/QMainWindow>
 #include <QtCore/QDir>
 #include <QtCore/QUrl>
+#include <QtCore/QMetaEnum>
 #include <util/platform.h>
 #include <QObject>
 #if __has_include(<obs-frontend-api.h>)
@@ -10,6 +21,7 @@
 #include <obs-frontend-api/obs-frontend-api.h>
 #endif
 #include "utils.h"
+#include "source-cache.h"
 
 #include <QMessageBox>
 #include <QLabel>
@@ -99,36 +111,38 @@ obs_data_array_t *Utils::StringListToArray(char **strings, const char *key)
 	} while (value != nullptr);
 	return list;
 }
-QString Utils::GetSceneItems(obs_source_t *source)
+/*
+ * Scene items of a scene as an obs_data array, built directly without going through JSON.
+ * The caller owns the returned array, nullptr if source is not a scene.
+ */
+obs_data_array_t *Utils::GetSceneItemArray(obs_source_t *source)
 {
 	const OBSScene scene = obs_scene_from_source(source);
 	if (!scene) {
 		return nullptr;
 	}
-	struct Pass {
-		int iterator;
-		obs_data_array_t *items;
-	};
-	Pass pass;
-	pass.iterator = 0;
-	pass.items = obs_data_array_create();
+	obs_data_array_t *items = obs_data_array_create();
 	obs_scene_enum_items(
 		scene,
 		[](obs_scene_t *scene, obs_sceneitem_t *currentItem, void *param) {
-			Pass *search = reinterpret_cast<Pass *>(param);
+			auto *items = reinterpret_cast<obs_data_array_t *>(param);
 			const OBSDataAutoRelease itemData = GetSceneItemData(currentItem);
-			obs_data_array_insert(search->items, search->iterator, itemData);
+			obs_data_array_push_back(items, itemData);
 			UNUSED_PARAMETER(scene);
-			search->iterator++;
 			return true;
 		},
-		&pass);
-	const auto x = obs_data_create();
-	obs_data_set_array(x, "array", pass.items);
-	obs_data_array_release(pass.items);
-	QString y(obs_data_get_json(x));
-	obs_data_release(x);
-	return y;
+		items);
+	return items;
+}
+QString Utils::GetSceneItems(obs_source_t *source)
+{
+	const OBSDataArrayAutoRelease items = GetSceneItemArray(source);
+	if (!items) {
+		return nullptr;
+	}
+	const OBSDataAutoRelease x = obs_data_create();
+	obs_data_set_array(x, "array", items);
+	return QString(obs_data_get_json(x));
 }
 QStringList Utils::GetSceneItemsBySource(obs_source_t *source)
 {
@@ -227,11 +241,15 @@ obs_data_t *Utils::GetSceneItemData(obs_sceneitem_t *item)
 }
 obs_sceneitem_t *Utils::GetSceneItemFromName(obs_scene_t *scene, const QString &name)
 {
-	if (!scene) {
+	return GetSceneItemFromName(scene, name.toUtf8().constData());
+}
+obs_sceneitem_t *Utils::GetSceneItemFromName(obs_scene_t *scene, const char *name)
+{
+	if (!scene || !name) {
 		return nullptr;
 	}
 	struct current_search {
-		QString query;
+		const char *query;
 		OBSSceneItemAutoRelease result;
 		bool (*enumCallback)(obs_scene_t *, obs_sceneitem_t *, void *);
 	};
@@ -246,8 +264,8 @@ obs_sceneitem_t *Utils::GetSceneItemFromName(obs_scene_t *scene, const QString &
 				return false;
 			}
 		}
-		const QString currentItemName = obs_source_get_name(obs_sceneitem_get_source(currentItem));
-		if (currentItemName == search->query) {
+		const char *currentItemName = obs_source_get_name(obs_sceneitem_get_source(currentItem));
+		if (currentItemName && strcmp(currentItemName, search->query) == 0) {
 			search->result = currentItem;
 			obs_sceneitem_addref(search->result);
 			return false;
@@ -343,30 +361,29 @@ bool Utils::IsValidAlignment(const uint32_t alignment)
 }
 obs_source_t *Utils::GetTransitionFromName(const QString &searchName)
 {
-	obs_source_t *foundTransition = nullptr;
-	obs_frontend_source_list transition_list = {};
-	obs_frontend_get_transitions(&transition_list);
-	for (size_t i = 0; i < transition_list.sources.num; i++) {
-		obs_source_t *transition = transition_list.sources.array[i];
-		QString transitionName = obs_source_get_name(transition);
-		if (transitionName == searchName) {
-			foundTransition = transition;
-			obs_source_addref(foundTransition);
-			break;
-		}
-	}
-	obs_frontend_source_list_free(&transition_list);
-	return foundTransition;
+	return GetTransitionFromName(searchName.toUtf8().constData());
+}
+obs_source_t *Utils::GetTransitionFromName(const char *searchName)
+{
+	// The caller owns the returned reference
+	const OBSSource transition = GetSourceCache()->get_transition(searchName);
+	obs_source_addref(transition);
+	return transition;
 }
 obs_scene_t *Utils::GetSceneFromNameOrCurrent(const QString &sceneName)
 {
-	// Both obs_frontend_get_current_scene() and obs_get_source_by_name()
-	// increase the returned source's refcount
-	obs_source_t *sceneSource = (sceneName.isEmpty() || sceneName.isNull()) ? sceneSource = obs_frontend_get_current_scene()
-										: sceneSource = obs_get_source_by_name(sceneName.toUtf8());
-	obs_scene_t *scene = obs_scene_from_source(sceneSource);
-	obs_source_release(sceneSource);
-	return scene;
+	return GetSceneFromNameOrCurrent(sceneName.toUtf8().constData());
+}
+obs_scene_t *Utils::GetSceneFromNameOrCurrent(const char *sceneName)
+{
+	if (!sceneName || !*sceneName) {
+		// obs_frontend_get_current_scene() increases the returned source's refcount
+		obs_source_t *sceneSource = obs_frontend_get_current_scene();
+		obs_scene_t *scene = obs_scene_from_source(sceneSource);
+		obs_source_release(sceneSource);
+		return scene;
+	}
+	return obs_scene_from_source(GetSourceCache()->get_source(sceneName));
 }
 obs_data_array_t *Utils::GetScenes()
 {
@@ -483,6 +500,10 @@ int Utils::GetTransitionDuration(obs_source_t *transition)
 	return duration;
 }
 bool Utils::SetTransitionByName(const QString &transitionName)
+{
+	return SetTransitionByName(transitionName.toUtf8().constData());
+}
+bool Utils::SetTransitionByName(const char *transitionName)
 {
 	const OBSSourceAutoRelease transition = GetTransitionFromName(transitionName);
 	if (transition) {
@@ -951,7 +972,35 @@ QStringList Utils::get_hotkeys_list()
 
 QString Utils::untranslate(const QString &tstring)
 {
-	return ActionsClass::action_to_string(AllActions_raw.at(TranslateActions().indexOf(tstring)));
+	const auto action = action_from_string(tstring);
+	return action ? ActionsClass::action_to_string(*action) : QString();
+}
+/*
+ * Resolves an action as stored in a config. Current configs store the enum name,
+ * older ones stored the label in the UI language they were saved with (or the old
+ * "Trigger Hotkey" name), those set migrated so the caller can write them back.
+ */
+std::optional<ActionsClass::Actions> Utils::action_from_string(const QString &string, bool *migrated)
+{
+	if (migrated)
+		*migrated = false;
+	if (string.isEmpty())
+		return std::nullopt;
+	bool ok = false;
+	const int value = QMetaEnum::fromType<ActionsClass::Actions>().keyToValue(string.toUtf8().constData(), &ok);
+	if (ok)
+		return (ActionsClass::Actions)value;
+	std::optional<ActionsClass::Actions> action;
+	if (string == "Trigger Hotkey") {
+		action = ActionsClass::Actions::Trigger_Hotkey_By_Name;
+	} else {
+		const int position = TranslateActions().indexOf(string);
+		if (position != -1)
+			action = AllActions_raw.at(position);
+	}
+	if (action && migrated)
+		*migrated = true;
+	return action;
 }
 QStringList Utils::get_browser_sources()
 {
@@ -1053,3 +1102,41 @@ QLabel *Utils::make_label(QString label)
 	w_label->setSizePolicy(pol);
 	return w_label;
 }
+/**
+ * Raises the calling thread to realtime priority.
+ * SCHED_FIFO on Linux and macOS (needs rtprio rights on Linux), TIME_CRITICAL on Windows.
+ * Returns false when the platform refused.
+ */
+bool Utils::set_thread_realtime_priority()
+{
+#ifdef _WIN32
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+	sched_param param{};
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+/**
+ * Pins the calling thread to one CPU.
+ * Not supported on macOS, returns false there and when the platform refused.
+ */
+bool Utils::set_thread_affinity(int cpu)
+{
+	if (cpu < 0)
+		return false;
+#if defined(_WIN32)
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+	if (cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
@@ -14,6 +14,10 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #pragma once
 
+#include <functional>
+#include <utility>
+
+#include <QtCore/QRunnable>
 #include <QtCore/QString>
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QLayout>
@@ -28,6 +32,18 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 #define qtocs() toStdString().c_str()
 
+/*
+ * Runs a function on a QThreadPool (QRunnable::create needs Qt 5.15)
+ */
+class FunctionTask : public QRunnable {
+public:
+	explicit FunctionTask(std::function<void()> function) : function(std::move(function)) {}
+	void run() override { function(); }
+
+private:
+	std::function<void()> function;
+};
+
 typedef void (*PauseRecordingFunction)(bool);
 typedef bool (*RecordingPausedFunction)();
 enum class Pairs { Scene, Source, Item, Transition, Audio, Media, Filter, String, Integer, Boolean, Range, Hotkey };
@@ -132,16 +148,19 @@ QStringList GetAudioSourceNames();
 QString nsToTimestamp(uint64_t ns);
 obs_data_array_t *StringListToArray(char **strings, const char *key);
 QString GetSceneItems(obs_source_t *source);
+obs_data_array_t *GetSceneItemArray(obs_source_t *source);
 QStringList GetSceneItemsBySource(obs_source_t *source);
 obs_data_t *GetSceneItemData(obs_sceneitem_t *item);
 QString GetSourceArray();
 QString GetSceneArray(const QString &name = "");
 // These functions support nested lookup into groups
 obs_sceneitem_t *GetSceneItemFromName(obs_scene_t *scene, const QString &name);
+obs_sceneitem_t *GetSceneItemFromName(obs_scene_t *scene, const char *name);
 obs_sceneitem_t *GetSceneItemFromId(obs_scene_t *scene, int64_t id);
 obs_sceneitem_t *GetSceneItemFromItem(obs_scene_t *scene, obs_data_t *item);
 obs_sceneitem_t *GetSceneItemFromRequestField(obs_scene_t *scene, obs_data_item_t *dataItem);
 obs_scene_t *GetSceneFromNameOrCurrent(const QString &sceneName);
+obs_scene_t *GetSceneFromNameOrCurrent(const char *sceneName);
 obs_data_t *GetSceneItemPropertiesData(obs_sceneitem_t *item);
 obs_data_t *GetSourceFilterInfo(obs_source_t *filter, bool includeSettings);
 obs_data_array_t *GetSourceFiltersList(obs_source_t *source, bool includeSettings);
@@ -151,7 +170,9 @@ QString GetSceneData(obs_source_t *source);
 // TODO contribute a proper frontend API method for this to OBS and remove this hack
 int GetTransitionDuration(obs_source_t *transition);
 obs_source_t *GetTransitionFromName(const QString &transitionName);
+obs_source_t *GetTransitionFromName(const char *transitionName);
 bool SetTransitionByName(const QString &transitionName);
+bool SetTransitionByName(const char *transitionName);
 obs_data_t *GetTransitionData(obs_source_t *transition);
 QString OBSVersionString();
 const char *GetRecordingFolder();
@@ -176,7 +197,10 @@ QComboBox *make_combo(QStringList items);
 QLabel *make_label(QString label);
 QStringList get_transition_names();
 QString untranslate(const QString &tstring);
+std::optional<ActionsClass::Actions> action_from_string(const QString &string, bool *migrated = nullptr);
 QStringList get_browser_sources();
+bool set_thread_realtime_priority();
+bool set_thread_affinity(int cpu);
 const QList<ActionsClass::Actions> AllActions_raw = {
 	ActionsClass::Actions::Do_Transition,
 	ActionsClass::Actions::Set_Volume,